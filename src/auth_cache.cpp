@@ -0,0 +1,109 @@
+// Copyright 2017 Hunter L. Allen
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "auth_cache.hpp"
+
+/**
+ * @brief Construct an auth_cache.
+ *
+ * @param _capacity Most users remembered at once.
+ * @param _ttl Time (in ms) an entry is trusted for.
+ */
+auth_cache::auth_cache(const int & _capacity, const qint64 & _ttl)
+: m_p_mutex(new QMutex()),
+  m_entries(_capacity),
+  m_ttl(_ttl)
+{ /* entries are added as logins succeed */}
+
+auth_cache::~auth_cache()
+{
+  delete m_p_mutex;
+}
+
+/**
+ * @brief Check credentials against the cache.
+ *
+ * @param _user The username.
+ * @param _password The password.
+ * @return True if these credentials were accepted within the
+ *   time to live; false means the database must be asked.
+ */
+bool auth_cache::contains(const QString & _user, const QString & _password)
+{
+  QByteArray given = digest(_password);
+  qint64 now = QDateTime::currentMSecsSinceEpoch();
+  m_p_mutex->lock();
+  entry * p = m_entries.object(key(_user));
+  bool hit = p != NULL && p->expires > now && p->digest == given;
+  if (p != NULL && p->expires <= now) {m_entries.remove(key(_user));}
+  m_p_mutex->unlock();
+  (hit) ? m_hits.ref() : m_misses.ref();
+  return hit;
+}
+
+/**
+ * @brief Remember credentials the database accepted.
+ *
+ * @param _user The username.
+ * @param _password The password.
+ * @param _generation generation() from before the database was asked.
+ */
+void auth_cache::insert(const QString & _user, const QString & _password, const quint64 & _generation)
+{
+  entry * p = new entry{digest(_password), QDateTime::currentMSecsSinceEpoch() + m_ttl};
+  m_p_mutex->lock();
+  if (_generation == m_generation.load()) {m_entries.insert(key(_user), p);} else {delete p;}
+  m_p_mutex->unlock();
+}
+
+/**
+ * @brief Forget a user, e.g. because their password changed.
+ *
+ * @param _user The username.
+ */
+void auth_cache::invalidate(const QString & _user)
+{
+  m_p_mutex->lock();
+  m_generation.ref();
+  m_entries.remove(key(_user));
+  m_p_mutex->unlock();
+}
+
+/**
+ * @brief Forget everyone.
+ */
+void auth_cache::clear()
+{
+  m_p_mutex->lock();
+  m_generation.ref();
+  m_entries.clear();
+  m_p_mutex->unlock();
+}
+
+/**
+ * @brief Count the remembered users.
+ */
+int auth_cache::size()
+{
+  m_p_mutex->lock();
+  int size = m_entries.size();
+  m_p_mutex->unlock();
+  return size;
+}
+
+QByteArray auth_cache::digest(const QString & _password)
+{
+  /* keep no passwords in memory longer than the request */
+  return QCryptographicHash::hash(_password.toUtf8(), QCryptographicHash::Sha256);
+}
@@ -0,0 +1,70 @@
+// Copyright 2017 Hunter L. Allen
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __AUTH_CACHE_HPP__
+#define __AUTH_CACHE_HPP__
+#pragma once
+#include <QtCore>
+
+/**
+ * Remembers credentials the database recently accepted.
+ *
+ * Holds a digest of the password per username, so a login
+ * repeated within the time to live does not query the users
+ * table. The cache is bounded; the least recently used entries
+ * go first. Changing a user's password must invalidate() them.
+ *
+ * A lookup that misses takes the generation() before it asks the
+ * database, and hands it back to insert(); if anything was
+ * invalidated in between, the (possibly stale) answer is not cached.
+ *
+ * Safe to use from several threads.
+ */
+class auth_cache
+{
+public:
+  explicit auth_cache(const int & _capacity, const qint64 & _ttl);
+  virtual ~auth_cache();
+
+  bool contains(const QString & _user, const QString & _password);
+  void insert(const QString & _user, const QString & _password, const quint64 & _generation);
+  void invalidate(const QString & _user);
+  void clear();
+
+  quint64 generation() const {return m_generation.load();}
+  void set_ttl(const qint64 & _ttl) {m_ttl = _ttl;}
+
+  quint64 hits() const {return m_hits.load();}
+  quint64 misses() const {return m_misses.load();}
+  int size();
+
+private:
+  struct entry
+  {
+    QByteArray digest;
+    qint64 expires;
+  };
+
+  static QByteArray digest(const QString & _password);
+  /* MySQL matches user names case-insensitively, so we do too */
+  static QString key(const QString & _user) {return _user.toCaseFolded();}
+
+  QMutex * m_p_mutex;
+  QCache<QString, entry> m_entries;   /* guarded by m_p_mutex */
+  qint64 m_ttl;                       /* in ms */
+  QAtomicInteger<quint64> m_generation;
+  QAtomicInteger<quint64> m_hits;
+  QAtomicInteger<quint64> m_misses;
+};
+#endif
@@ -0,0 +1,198 @@
+// Copyright 2017 Hunter L. Allen
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "availability.hpp"
+
+#include <algorithm>
+
+const qint64 availability::MINUTES_PER_DAY;
+const int availability::GRAIN;
+
+/**
+ * @brief Construct an availability.
+ *
+ * @param _from First minute an event may start.
+ * @param _until Minute every event must be over by.
+ */
+availability::availability(const qint64 & _from, const qint64 & _until)
+: m_first((_from + GRAIN - 1) / GRAIN * GRAIN),
+  m_slots(int(qMax(qint64(0), (_until - m_first) / GRAIN)))
+{ /* busy times are added with add_busy */}
+
+availability::~availability()
+{ /* nothing to free */}
+
+/**
+ * @brief Only suggest times within working hours.
+ *
+ * @param _open Minute of the day the working day starts.
+ * @param _close Minute of the day the working day ends.
+ */
+void availability::set_hours(const int & _open, const int & _close)
+{
+  m_open = _open;
+  m_close = _close;
+}
+
+/**
+ * @brief Mark a time as taken by a member of the group.
+ *
+ * @param _member Index of the member, from 0.
+ * @param _start First minute of the event.
+ * @param _end First minute after the event.
+ */
+void availability::add_busy(const int & _member, const qint64 & _start, const qint64 & _end)
+{
+  qint64 first = (_start - m_first) / GRAIN - (_start < m_first ? 1 : 0);
+  qint64 last = (_end - m_first + GRAIN - 1) / GRAIN;
+  /* nothing outside the window matters */
+  if (_end <= _start || last <= 0 || first >= m_slots) {return;}
+  while (m_members.size() <= _member) {m_members.append(slot_bitset(m_slots));}
+  m_members[_member].set_range(int(qMax(first, qint64(0))), int(qMin(last, qint64(m_slots))));
+  ++m_busy_count;
+}
+
+/**
+ * @brief Count members that have no busy times.
+ *
+ * Members only appear through add_busy; a group whose
+ * members are not all busy at some point says how big it is.
+ *
+ * @param _count Number of members in the group.
+ */
+void availability::set_members(const int & _count)
+{
+  while (m_members.size() < _count) {m_members.append(slot_bitset(m_slots));}
+}
+
+/**
+ * @brief Find the slots everyone is free for.
+ *
+ * @param _duration Length of the event, in minutes.
+ * @return Every free stretch of at least _duration minutes, in order.
+ */
+QVector<availability::slot> availability::free(const int & _duration) const
+{
+  slot_bitset busy = closed();
+  for (const slot_bitset & member : m_members) {busy.or_with(member);}
+
+  int needed = qMax(1, (_duration + GRAIN - 1) / GRAIN);
+  QVector<slot> slots;
+  for (int x = busy.next_clear(0); x < m_slots; ) {
+    int end = busy.next_set(x);
+    if (end - x >= needed) {slots.append(slot{minute_of(x), minute_of(end)});}
+    x = busy.next_clear(end);
+  }
+  return slots;
+}
+
+/**
+ * @brief Find the times enough of the group is free for.
+ *
+ * Each member's busy slots are spread back over the length of
+ * the event, so a set bit means "busy somewhere during an event
+ * starting here", and summed in a slot_counter. Consecutive
+ * starts with the same attendance come back as one choice.
+ *
+ * @param _duration Length of the event, in minutes.
+ * @param _minimum Fewest members that must be free.
+ * @param _limit Most choices to return.
+ * @return The best choices: most attendance first, then earliest.
+ */
+QVector<availability::choice> availability::quorum(
+  const int & _duration,
+  const int & _minimum,
+  const int & _limit) const
+{
+  int needed = qMax(1, (_duration + GRAIN - 1) / GRAIN);
+  int most_busy = members() - qMax(_minimum, 1);
+  QVector<choice> choices;
+  if (most_busy < 0 || needed > m_slots) {return choices;}
+
+  /* starts that would run into closed hours or past the window */
+  slot_bitset blocked = closed();
+  blocked.spread(needed);
+  blocked.set_range(m_slots - needed + 1, m_slots);
+
+  slot_counter busy(m_slots);
+  for (const slot_bitset & member : m_members) {
+    slot_bitset taken = member;
+    taken.spread(needed);
+    busy.add(taken);
+  }
+
+  for (int x = blocked.next_clear(0); x < m_slots; ) {
+    int end = blocked.next_set(x);
+    for (int start = x; start < end; ) {
+      int count = busy.count(start), next = start + 1;
+      for (; next < end && busy.count(next) == count; ++next) {}
+      if (count <= most_busy) {
+        choices.append(choice{minute_of(start), minute_of(next - 1 + needed), members() - count});
+      }
+      start = next;
+    }
+    x = blocked.next_clear(end);
+  }
+
+  std::stable_sort(choices.begin(), choices.end(),
+    [](const choice & a, const choice & b) {return a.attendance > b.attendance;});
+  if (choices.size() > _limit) {choices.resize(qMax(_limit, 0));}
+  return choices;
+}
+
+/* the slots outside working hours */
+slot_bitset availability::closed() const
+{
+  slot_bitset nights(m_slots);
+  if (m_open <= 0 && m_close >= MINUTES_PER_DAY) {return nights;}
+  qint64 last = minute_of(m_slots);
+  for (qint64 day = calendar_event::day_of(m_first) * MINUTES_PER_DAY; day < last;
+    day += MINUTES_PER_DAY)
+  {
+    /* the slots from midnight to opening, and from closing to midnight */
+    nights.set_range(int((day - m_first) / GRAIN),
+      int((day + m_open - m_first + GRAIN - 1) / GRAIN));
+    nights.set_range(int((day + m_close - m_first) / GRAIN),
+      int((day + MINUTES_PER_DAY - m_first) / GRAIN));
+  }
+  return nights;
+}
+
+/**
+ * @brief Count the minutes up to a date and time.
+ *
+ * @param _date The date.
+ * @param _time The time of day.
+ * @return Minutes since 2000-01-01, as in calendar_event.
+ */
+qint64 availability::minute(const QDate & _date, const QTime & _time)
+{
+  return calendar_event::from(_date, _time, 0).start;
+}
+
+/**
+ * @brief Get the date of a minute from minute().
+ */
+QDate availability::date_of(const qint64 & _minute)
+{
+  return calendar_event{qint32(_minute), 0}.date();
+}
+
+/**
+ * @brief Get the time of day of a minute from minute().
+ */
+QTime availability::time_of(const qint64 & _minute)
+{
+  return calendar_event{qint32(_minute), 0}.time();
+}
@@ -0,0 +1,90 @@
+// Copyright 2017 Hunter L. Allen
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __AVAILABILITY_HPP__
+#define __AVAILABILITY_HPP__
+#pragma once
+#include <QtCore>
+
+#include "slot_bitset.hpp"
+#include "slot_counter.hpp"
+#include "event_struct.hpp"
+
+/**
+ * Finds the times a whole group is free.
+ *
+ * The window is cut into GRAIN minute slots, and each member's
+ * events are marked on a busy bitset of their own, in any order.
+ * free() ORs the members' bitsets together (see slot_bitset for
+ * the SIMD kernels) and scans the result for runs of free slots
+ * long enough for the event. Hours outside the working day
+ * (set_hours) count as busy.
+ *
+ * When the whole group cannot make it, quorum() counts, per
+ * start, how many members would be busy (see slot_counter) and
+ * ranks the starts that enough members are free for.
+ *
+ * Times are in minutes, counted with minute(). Slots are aligned
+ * to GRAIN minutes, so suggestions are too, and an event that
+ * covers part of a slot takes all of it.
+ */
+class availability
+{
+public:
+  struct slot
+  {
+    qint64 start;   /* first minute */
+    qint64 end;     /* first minute after */
+  };
+
+  struct choice
+  {
+    qint64 start;     /* first minute */
+    qint64 end;       /* first minute after the latest finish */
+    int attendance;   /* members free for all of it */
+  };
+
+  explicit availability(const qint64 & _from, const qint64 & _until);
+  virtual ~availability();
+
+  void set_hours(const int & _open, const int & _close);
+  void add_busy(const qint64 & _start, const qint64 & _end) {add_busy(0, _start, _end);}
+  void add_busy(const int & _member, const qint64 & _start, const qint64 & _end);
+  int busy_count() const {return m_busy_count;}
+  int members() const {return m_members.size();}
+  void set_members(const int & _count);
+
+  QVector<slot> free(const int & _duration) const;
+  QVector<choice> quorum(const int & _duration, const int & _minimum,
+    const int & _limit) const;
+
+  static qint64 minute(const QDate & _date, const QTime & _time);
+  static QDate date_of(const qint64 & _minute);
+  static QTime time_of(const qint64 & _minute);
+
+  static const qint64 MINUTES_PER_DAY = 24 * 60;
+  static const int GRAIN = 5;   /* minutes per slot */
+
+private:
+  slot_bitset closed() const;
+  qint64 minute_of(const int & _slot) const {return m_first + qint64(_slot) * GRAIN;}
+
+  qint64 m_first;   /* start of slot 0: the window start, rounded up */
+  int m_slots;
+  int m_open = 0;                  /* minute of the day */
+  int m_close = MINUTES_PER_DAY;   /* minute of the day */
+  int m_busy_count = 0;
+  QVector<slot_bitset> m_members;   /* busy slots, by member */
+};
+#endif
@@ -33,7 +33,12 @@ public:
   void add_worker(worker_connection * w);
   const QString & get_paired_hostname() {return m_paired_host;}
 
+  /* empty unless the client sent "REQUEST_WORKER <username>" */
+  void set_username(const QString & _username) {m_username = _username;}
+  const QString & get_username() const {return m_username;}
+
 private:
   QString m_paired_host;
+  QString m_username;
 };
 #endif
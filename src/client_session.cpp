@@ -0,0 +1,71 @@
+// Copyright 2017 Hunter L. Allen
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "client_session.hpp"
+
+/**
+ * @brief Construct a client_session.
+ *
+ * The idle timer is started right away, so a client
+ * that connects and never speaks is dropped.
+ *
+ * @param _p_socket Socket of the connected client.
+ * @param _idle_timeout Idle time (in ms) before we hang up.
+ * @param _p_parent Parent QObject.
+ */
+client_session::client_session(
+  QTcpSocket * _p_socket,
+  const int & _idle_timeout,
+  QObject * _p_parent)
+: QObject(_p_parent),
+  m_p_socket(_p_socket),
+  m_p_idle_timer(new QTimer(this))
+{
+  m_p_idle_timer->setSingleShot(true);
+  m_p_idle_timer->setInterval(_idle_timeout);
+  connect(m_p_idle_timer, &QTimer::timeout, this, &client_session::idle_timeout);
+  m_p_idle_timer->start();
+}
+
+/**
+ * @brief destruct a client_session
+ *
+ * The socket is not ours, so it is left alone.
+ */
+client_session::~client_session()
+{ /* the timer is a child of ours */}
+
+/**
+ * @brief Restart the idle timer.
+ *
+ * Called whenever a reply goes out on a
+ * persistent session.
+ */
+void client_session::touch()
+{
+  m_p_idle_timer->start();
+}
+
+/**
+ * @brief Stop the idle timer while a request is in progress.
+ */
+void client_session::stop_timer()
+{
+  m_p_idle_timer->stop();
+}
+
+void client_session::idle_timeout()
+{
+  Q_EMIT (timed_out(this));
+}
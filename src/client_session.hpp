@@ -0,0 +1,75 @@
+// Copyright 2017 Hunter L. Allen
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __CLIENT_SESSION_HPP__
+#define __CLIENT_SESSION_HPP__
+#pragma once
+#include <QtNetwork>
+#include <QObject>
+#include <QtCore>
+
+/**
+ * State kept by a worker for one connected client.
+ *
+ * By default a client is served a single request and then
+ * disconnected. A client that sends BEGIN_SESSION is marked
+ * persistent, and may keep issuing requests on the same socket
+ * until it sends END_SESSION or sits idle for too long.
+ * A client that sends "FRAMING BINARY" also gets a persistent
+ * session, and talks in frames (see frame_codec) from then on.
+ */
+class client_session : public QObject
+{
+  Q_OBJECT
+
+public:
+  explicit client_session(
+    QTcpSocket * _p_socket,
+    const int & _idle_timeout,
+    QObject * _p_parent = NULL
+  );
+  virtual ~client_session();
+
+  QTcpSocket * get_socket() {return m_p_socket;}
+
+  bool is_persistent() {return m_persistent;}
+  void set_persistent(const bool & _persistent) {m_persistent = _persistent;}
+
+  bool is_binary() {return m_binary;}
+  void set_binary(const bool & _binary) {m_binary = _binary;}
+
+  /* a request has been read; FRAMING is only taken before that */
+  bool has_served() {return m_served;}
+  void set_served(const bool & _served) {m_served = _served;}
+
+  /* a request is running on the executor; later ones wait for it */
+  bool is_busy() {return m_busy;}
+  void set_busy(const bool & _busy) {m_busy = _busy;}
+
+  void touch();
+  void stop_timer();
+
+  Q_SIGNAL void timed_out(client_session * _p_session);
+
+private:
+  Q_SLOT void idle_timeout();
+
+  QTcpSocket * m_p_socket;
+  QTimer * m_p_idle_timer;
+  bool m_persistent = false;
+  bool m_binary = false;
+  bool m_served = false;
+  bool m_busy = false;
+};
+#endif
@@ -0,0 +1,82 @@
+// Copyright 2017 Hunter L. Allen
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "command_table.hpp"
+
+command_table::command_table()
+{ /* handlers are added with register_command */}
+
+command_table::~command_table()
+{ /* nothing to free */}
+
+/**
+ * @brief Register the handler for a verb.
+ *
+ * Registering a verb twice replaces the old handler.
+ *
+ * @param _verb Leading token of the request line.
+ * @param _handler Called with the payload and the client socket.
+ */
+void command_table::register_command(const QByteArray & _verb, const handler & _handler)
+{
+  m_handlers.insert(_verb, _handler);
+}
+
+/**
+ * @brief Hand a request line to its handler.
+ *
+ * The verb is everything up to the first space; the rest
+ * of the line is the payload. Only the payload is converted
+ * to a QString, and only once the verb is known.
+ *
+ * @param _line Request line, without the line terminator.
+ * @param _p_socket Socket the request arrived on.
+ * @return False if no handler is registered for the verb.
+ */
+bool command_table::dispatch(const QByteArray & _line, QTcpSocket * _p_socket) const
+{
+  int space = _line.indexOf(' ');
+  QByteArray verb = (space < 0) ? _line : _line.left(space);
+
+  QHash<QByteArray, handler>::const_iterator it = m_handlers.constFind(verb);
+  if (it == m_handlers.constEnd()) {return false;}
+
+  QString * p_payload = new QString(
+    (space < 0) ? QString() : QString::fromUtf8(_line.constData() + space + 1,
+    _line.size() - space - 1));
+  it.value()(p_payload, _p_socket);
+  return true;
+}
+
+/**
+ * @brief Hand an already split request to its handler.
+ *
+ * Used for binary frames, where the verb arrives on its own.
+ *
+ * @param _verb Request verb.
+ * @param _payload Request payload (UTF-8).
+ * @param _p_socket Socket the request arrived on.
+ * @return False if no handler is registered for the verb.
+ */
+bool command_table::dispatch(
+  const QByteArray & _verb,
+  const QByteArray & _payload,
+  QTcpSocket * _p_socket) const
+{
+  QHash<QByteArray, handler>::const_iterator it = m_handlers.constFind(_verb);
+  if (it == m_handlers.constEnd()) {return false;}
+
+  it.value()(new QString(QString::fromUtf8(_payload)), _p_socket);
+  return true;
+}
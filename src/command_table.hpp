@@ -0,0 +1,49 @@
+// Copyright 2017 Hunter L. Allen
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __COMMAND_TABLE_HPP__
+#define __COMMAND_TABLE_HPP__
+#pragma once
+#include <QtNetwork>
+#include <QtCore>
+
+#include <functional>
+
+/**
+ * Maps the leading verb of a request line to its handler.
+ *
+ * Handlers are registered once at startup. A request line
+ * looks like "VERB payload"; the verb is looked up in a
+ * hash, so dispatch costs the same for every command.
+ */
+class command_table
+{
+public:
+  typedef std::function<void(QString *, QTcpSocket *)> handler;
+
+  command_table();
+  virtual ~command_table();
+
+  void register_command(const QByteArray & _verb, const handler & _handler);
+  bool contains(const QByteArray & _verb) const {return m_handlers.contains(_verb);}
+  int size() const {return m_handlers.size();}
+
+  bool dispatch(const QByteArray & _line, QTcpSocket * _p_socket) const;
+  bool dispatch(const QByteArray & _verb, const QByteArray & _payload,
+    QTcpSocket * _p_socket) const;
+
+private:
+  QHash<QByteArray, handler> m_handlers;
+};
+#endif
@@ -0,0 +1,109 @@
+// Copyright 2017 Hunter L. Allen
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "consistent_hash_ring.hpp"
+
+/**
+ * @brief Construct a consistent_hash_ring.
+ *
+ * @param _replicas Points each node gets on the ring.
+ */
+consistent_hash_ring::consistent_hash_ring(const int & _replicas)
+: m_replicas(_replicas)
+{ /* nodes are added with add_node */}
+
+consistent_hash_ring::~consistent_hash_ring()
+{ /* nothing to free */}
+
+/**
+ * @brief Place a node on the ring.
+ *
+ * @param _node Name of the node; adding it twice does nothing.
+ */
+void consistent_hash_ring::add_node(const QString & _node)
+{
+  if (m_nodes.contains(_node)) {return;}
+  m_nodes.insert(_node);
+  for (int x = 0; x < m_replicas; ++x) {
+    quint32 point = hash(_node.toUtf8() + '#' + QByteArray::number(x));
+    /* on a collision the first node keeps the point */
+    if (!m_ring.contains(point)) {m_ring.insert(point, _node);}
+  }
+}
+
+/**
+ * @brief Take a node off the ring.
+ *
+ * @param _node Name of the node.
+ */
+void consistent_hash_ring::remove_node(const QString & _node)
+{
+  if (!m_nodes.remove(_node)) {return;}
+  for (int x = 0; x < m_replicas; ++x) {
+    quint32 point = hash(_node.toUtf8() + '#' + QByteArray::number(x));
+    QMap<quint32, QString>::iterator it = m_ring.find(point);
+    if (it != m_ring.end() && it.value() == _node) {m_ring.erase(it);}
+  }
+}
+
+/**
+ * @brief Find the node a key belongs to.
+ *
+ * @param _key The key.
+ * @return The node, or an empty string if the ring is empty.
+ */
+QString consistent_hash_ring::find(const QString & _key) const
+{
+  return find(_key, [](const QString &) {return true;});
+}
+
+/**
+ * @brief Find the first node from a key's position that will take it.
+ *
+ * Nodes are offered in ring order, each one once, until
+ * _accept says yes. This is how load is bounded: a node
+ * that is full is passed over for the next one.
+ *
+ * @param _key The key.
+ * @param _accept Returns true if the node will take the key.
+ * @return The node, or an empty string if none would take it.
+ */
+QString consistent_hash_ring::find(
+  const QString & _key,
+  const std::function<bool(const QString &)> & _accept) const
+{
+  if (m_ring.isEmpty()) {return QString();}
+  QSet<QString> offered;
+  QMap<quint32, QString>::const_iterator it = m_ring.lowerBound(hash(_key.toUtf8()));
+  for (int x = 0; x < m_ring.size() && offered.size() < m_nodes.size(); ++x, ++it) {
+    /* wrap around */
+    if (it == m_ring.constEnd()) {it = m_ring.constBegin();}
+    if (offered.contains(it.value())) {continue;}
+    if (_accept(it.value())) {return it.value();}
+    offered.insert(it.value());
+  }
+  return QString();
+}
+
+/**
+ * @brief Position of some data on the ring.
+ *
+ * @param _data Node point or key.
+ * @return The first four bytes of the data's MD5.
+ */
+quint32 consistent_hash_ring::hash(const QByteArray & _data)
+{
+  QByteArray digest = QCryptographicHash::hash(_data, QCryptographicHash::Md5);
+  return qFromBigEndian<quint32>(reinterpret_cast<const uchar *>(digest.constData()));
+}
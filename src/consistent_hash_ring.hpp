@@ -0,0 +1,53 @@
+// Copyright 2017 Hunter L. Allen
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __CONSISTENT_HASH_RING_HPP__
+#define __CONSISTENT_HASH_RING_HPP__
+#pragma once
+#include <QtCore>
+
+#include <functional>
+
+/**
+ * Maps keys onto a changing set of nodes.
+ *
+ * Every node is placed on a ring of 32-bit hashes at several
+ * points (virtual nodes). A key belongs to the first node found
+ * walking clockwise from the key's own hash, so adding or removing
+ * a node only moves the keys next to it. Hashes are MD5 based, so
+ * the mapping is the same from one run to the next.
+ */
+class consistent_hash_ring
+{
+public:
+  explicit consistent_hash_ring(const int & _replicas = 64);
+  virtual ~consistent_hash_ring();
+
+  void add_node(const QString & _node);
+  void remove_node(const QString & _node);
+  bool contains_node(const QString & _node) const {return m_nodes.contains(_node);}
+  int size() const {return m_nodes.size();}
+
+  QString find(const QString & _key) const;
+  QString find(const QString & _key,
+    const std::function<bool(const QString &)> & _accept) const;
+
+  static quint32 hash(const QByteArray & _data);
+
+private:
+  int m_replicas;
+  QMap<quint32, QString> m_ring;   /* hash -> node */
+  QSet<QString> m_nodes;
+};
+#endif
@@ -0,0 +1,220 @@
+// Copyright 2017 Hunter L. Allen
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "db_pool.hpp"
+
+#include <iostream>
+
+const qint64 db_pool::PING_AFTER_IDLE;
+const qint64 db_pool::FIRST_BACKOFF;
+const qint64 db_pool::MAX_BACKOFF;
+
+/* the server went away, as opposed to refusing the statement */
+static bool lost_connection(const QSqlError & _error)
+{
+  /* MySQL's "server has gone away" and "lost connection during query" */
+  return _error.type() == QSqlError::ConnectionError ||
+    _error.nativeErrorCode() == "2006" || _error.nativeErrorCode() == "2013";
+}
+
+/* running it twice gives the same answer, and changes nothing */
+static bool read_only(const QString & _sql)
+{
+  return _sql.trimmed().startsWith("SELECT", Qt::CaseInsensitive);
+}
+
+/**
+ * @brief Construct a db_pool.
+ *
+ * @param _factory Makes a (closed) connection with the given name.
+ */
+db_pool::db_pool(const factory & _factory)
+: m_factory(_factory),
+  m_p_mutex(new QMutex())
+{ /* connections are made as threads ask for them */}
+
+/**
+ * @brief destruct a db_pool
+ *
+ * The connections stay registered with QSqlDatabase; their
+ * threads may not have finished with them yet.
+ */
+db_pool::~db_pool()
+{
+  for (connection * p : m_connections) {delete p->statements;}
+  qDeleteAll(m_connections);
+  delete m_p_mutex;
+}
+
+/**
+ * @brief Define a statement to prepare on every connection.
+ *
+ * Must be called before any thread acquires a connection.
+ *
+ * @param _name Name the statement is looked up by.
+ * @param _sql The SQL, with "?" placeholders.
+ */
+void db_pool::define_statement(const QByteArray & _name, const QString & _sql)
+{
+  m_statements.insert(_name, _sql);
+}
+
+/**
+ * @brief Hand out the calling thread's connection.
+ *
+ * @return The connection, open unless the server is unreachable.
+ */
+QSqlDatabase db_pool::acquire()
+{
+  connection * p = local();
+  p->checkouts.ref();
+  qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+  bool healthy = p->db.isOpen();
+  if (healthy && now - p->last_used > PING_AFTER_IDLE) {
+    /* the server may have hung up on us while we were idle */
+    p->pings.ref();
+    QSqlQuery ping(p->db);
+    healthy = ping.exec("SELECT 1");
+  }
+  if (!healthy) {reconnect(p, now);}
+  p->last_used = now;
+  return p->db;
+}
+
+/**
+ * @brief Get a prepared statement on the calling thread's connection.
+ *
+ * Call acquire() first, so the connection is known to be open.
+ *
+ * @param _name Name given to define_statement().
+ * @return The statement, or NULL if it could not be prepared.
+ */
+QSqlQuery * db_pool::statement(const QByteArray & _name)
+{
+  connection * p = local();
+  return p->statements->get(_name, p->db);
+}
+
+/**
+ * @brief Execute a statement from statement() with its bound values.
+ *
+ * If the link to the server went down since acquire(), or goes
+ * down during the statement, the connection is reopened. A SELECT
+ * is then run once more, with the same values. Anything else fails:
+ * the server may have applied it before the link went, and running
+ * it again could apply it twice.
+ *
+ * @param _p_query The statement.
+ * @return True if it executed.
+ */
+bool db_pool::exec(QSqlQuery * _p_query)
+{
+  connection * p = local();
+  if (p->statements->exec(_p_query)) {return true;}
+  if (!lost_connection(_p_query->lastError())) {return false;}
+
+  /* reopening prepares the statement again, in place, without its values */
+  bool retry = read_only(_p_query->lastQuery());
+  QVariantList values;
+  int bound = _p_query->boundValues().size();
+  for (int x = 0; x < bound; ++x) {values.append(_p_query->boundValue(x));}
+  std::cerr << "database connection " << p->name.toStdString() <<
+    " lost; reconnecting" << std::endl;
+  if (!reconnect(p, QDateTime::currentMSecsSinceEpoch()) || !retry) {return false;}
+  for (int x = 0; x < values.size(); ++x) {_p_query->bindValue(x, values[x]);}
+  return p->statements->exec(_p_query);
+}
+
+/**
+ * @brief Count the connections in the pool.
+ */
+int db_pool::size()
+{
+  m_p_mutex->lock();
+  int connections = m_connections.size();
+  m_p_mutex->unlock();
+  return connections;
+}
+
+/**
+ * @brief Get the statistics of every connection.
+ */
+QList<db_pool::connection_stats> db_pool::stats()
+{
+  QList<connection_stats> all;
+  m_p_mutex->lock();
+  for (connection * p : m_connections) {
+    all.append(connection_stats{p->name, p->checkouts.load(), p->pings.load(),
+      p->connects.load(), p->failures.load(),
+      p->statements->prepares(), p->statements->executes()});
+  }
+  m_p_mutex->unlock();
+  return all;
+}
+
+/**
+ * @brief Find (or make) the calling thread's connection.
+ */
+db_pool::connection * db_pool::local()
+{
+  Qt::HANDLE thread = QThread::currentThreadId();
+  m_p_mutex->lock();
+  connection * p = m_connections.value(thread, NULL);
+  m_p_mutex->unlock();
+  if (p != NULL) {return p;}
+
+  /* only this thread adds its own entry, so nobody else can race us to it */
+  p = new connection();
+  p->name = "timefuse-" + QString::number((quintptr) thread);
+  p->statements = new statement_registry(&m_statements);
+  p->db = QSqlDatabase::contains(p->name) ?
+    QSqlDatabase::database(p->name, false) : m_factory(p->name);
+  if (p->db.isOpen()) {p->statements->prepare_all(p->db);}
+  m_p_mutex->lock();
+  m_connections.insert(thread, p);
+  m_p_mutex->unlock();
+  return p;
+}
+
+/**
+ * @brief (Re)open a connection, unless we are backing off.
+ *
+ * @param _p_connection The connection.
+ * @param _now Current time, in ms since the epoch.
+ * @return True if the connection is open.
+ */
+bool db_pool::reconnect(connection * _p_connection, const qint64 & _now)
+{
+  /* still waiting out the last failure */
+  if (_now < _p_connection->retry_at) {return false;}
+
+  /* statements do not survive the old connection; prepare_all redoes them */
+  _p_connection->statements->release();
+  _p_connection->db.close();
+  _p_connection->connects.ref();
+  if (_p_connection->db.open()) {
+    _p_connection->backoff = 0;
+    _p_connection->statements->prepare_all(_p_connection->db);
+    return true;
+  }
+
+  _p_connection->failures.ref();
+  _p_connection->backoff = (_p_connection->backoff == 0) ?
+    FIRST_BACKOFF : qMin(_p_connection->backoff * 2, MAX_BACKOFF);
+  _p_connection->retry_at = _now + _p_connection->backoff;
+  std::cerr << "database connection " << _p_connection->name.toStdString() << " failed: " <<
+    _p_connection->db.lastError().text().toStdString() << std::endl;
+  return false;
+}
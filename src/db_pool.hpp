@@ -0,0 +1,103 @@
+// Copyright 2017 Hunter L. Allen
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __DB_POOL_HPP__
+#define __DB_POOL_HPP__
+#pragma once
+#include <QtCore>
+#include <QtSql>
+
+#include <functional>
+
+#include "statement_registry.hpp"
+
+/**
+ * The worker's database connections, one per thread.
+ *
+ * A QSqlDatabase may only be used by the thread that made it,
+ * so rather than passing connections between threads, each
+ * thread that serves requests owns one connection from the
+ * pool. The executor opens them when it starts, so requests
+ * never pay for the connection setup.
+ *
+ * A connection that has sat idle is pinged before it is handed
+ * out, and reopened if the ping fails, so a link the server
+ * dropped in the meantime does not fail the request. If the link
+ * goes down under a statement anyway, the connection is reopened;
+ * a SELECT is then run once more, but a write is not, since the
+ * server may already have applied it. While the server stays
+ * unreachable, reconnects back off exponentially.
+ *
+ * Statements defined with define_statement() are prepared on each
+ * connection as it opens; see statement_registry.
+ */
+class db_pool
+{
+public:
+  typedef std::function<QSqlDatabase(const QString &)> factory;
+
+  struct connection_stats
+  {
+    QString name;
+    quint64 checkouts;    /* times the connection was handed out */
+    quint64 pings;        /* idle checks */
+    quint64 connects;     /* times it was (re)opened */
+    quint64 failures;     /* failed opens */
+    quint64 prepares;     /* statements prepared */
+    quint64 executes;     /* prepared statements executed */
+  };
+
+  explicit db_pool(const factory & _factory);
+  virtual ~db_pool();
+
+  void define_statement(const QByteArray & _name, const QString & _sql);
+  QSqlDatabase acquire();
+  QSqlQuery * statement(const QByteArray & _name);
+  bool exec(QSqlQuery * _p_query);
+
+  int size();
+  QList<connection_stats> stats();
+
+  /* a connection idle this long (in ms) is pinged before use */
+  static const qint64 PING_AFTER_IDLE = 5000;
+  /* wait after the first failed reconnect (in ms), doubled up to MAX_BACKOFF */
+  static const qint64 FIRST_BACKOFF = 100;
+  static const qint64 MAX_BACKOFF = 10000;
+
+private:
+  struct connection
+  {
+    QString name;
+    QSqlDatabase db;
+    statement_registry * statements;
+    /* only touched by the owning thread */
+    qint64 last_used = 0;
+    qint64 retry_at = 0;
+    qint64 backoff = 0;
+    /* read by stats() from any thread */
+    QAtomicInteger<quint64> checkouts;
+    QAtomicInteger<quint64> pings;
+    QAtomicInteger<quint64> connects;
+    QAtomicInteger<quint64> failures;
+  };
+
+  connection * local();
+  bool reconnect(connection * _p_connection, const qint64 & _now);
+
+  factory m_factory;
+  statement_registry::definitions m_statements;
+  QMutex * m_p_mutex;
+  QHash<Qt::HANDLE, connection *> m_connections;   /* by owning thread */
+};
+#endif
@@ -18,48 +18,65 @@
 #include <QTime>
 #include <QSet>
 
+#include <type_traits>
+
+/**
+ * An event on a calendar, packed into two integers.
+ *
+ * The start is counted in minutes from 2000-01-01 00:00, so
+ * comparing, hashing and overlap checks are integer work; date()
+ * and time() only build a QDate and QTime when one is needed.
+ * The same minute count is used by availability and
+ * interval_timeline.
+ */
 struct calendar_event
 {
-  QDate date;
-  QTime time;
-  int duration;   /* in minutes */
+  qint32 start;      /* minutes since EPOCH_DAY began */
+  qint32 duration;   /* in minutes */
 
-  calendar_event get_midpoint(
-    const calendar_event & e1,
-    const calendar_event & e2);
+  static const qint64 EPOCH_DAY = 2451545;   /* julian day of 2000-01-01 */
+  static const qint32 MINUTES_PER_DAY = 24 * 60;
 
-  QTime get_finish_time()
+  static calendar_event from(const QDate & _date, const QTime & _time, const int & _duration)
   {
-    QTime ret = time;
-    return ret.addSecs(duration * 60);
+    return calendar_event{
+      minute(_date.toJulianDay(), _time.msecsSinceStartOfDay() / 60000), _duration};
   }
 
-  bool operator<(const calendar_event & e)
+  static constexpr qint32 minute(const qint64 & _julian_day, const int & _minute_of_day)
   {
-    return date < e.date && time < e.time;
+    return qint32((_julian_day - EPOCH_DAY) * MINUTES_PER_DAY + _minute_of_day);
   }
 
-  bool operator==(const calendar_event & e)
+  /* rounds down, before the epoch too */
+  static constexpr qint64 day_of(const qint64 & _minute)
   {
-    return date == e.date && time == e.time;
+    return (_minute >= 0 ? _minute : _minute - (MINUTES_PER_DAY - 1)) / MINUTES_PER_DAY;
   }
-};
 
-calendar_event schedule_between(
-  const QList<calendar_event> & events,
-  const size_t & index_1,
-  const size_t & index_2,
-  const int & d, bool * ok);
+  constexpr qint32 end() const {return start + duration;}
+  constexpr qint64 julian_day() const {return EPOCH_DAY + day_of(start);}
+  constexpr int minute_of_day() const {return int(start - day_of(start) * MINUTES_PER_DAY);}
+
+  constexpr bool overlaps(const calendar_event & _other) const
+  {
+    return start < _other.end() && _other.start < end();
+  }
+
+  QDate date() const {return QDate::fromJulianDay(julian_day());}
+  QTime time() const {return QTime(minute_of_day() / 60, minute_of_day() % 60);}
+};
+Q_DECLARE_TYPEINFO(calendar_event, Q_PRIMITIVE_TYPE);
+static_assert(std::is_trivially_copyable<calendar_event>::value && sizeof(calendar_event) == 8,
+  "calendar_event must stay two packed integers");
 
 bool check_overlap(
-  calendar_event e1,
-  calendar_event e2);
+  const calendar_event & e1,
+  const calendar_event & e2);
 
 /**
  * Equal to operator for calendar events.
  *
- * Was QSet really worth it?
- *
  * @param e1 first event
  * @param e2 second event
  *
@@ -68,20 +85,31 @@ bool check_overlap(
 inline bool operator==(
   const calendar_event & e1,
   const calendar_event & e2)
-{return e1.date == e2.date && e1.time == e2.time;}
+{return e1.start == e2.start;}
+
+/**
+ * Less than operator for calendar events.
+ *
+ * @return True if e1 starts before e2.
+ */
+inline bool operator<(
+  const calendar_event & e1,
+  const calendar_event & e2)
+{return e1.start < e2.start;}
 
 /**
  * Overloaded qHash function for a calendar_event.
  *
+ * Events that compare equal start together, so only
+ * the start is hashed.
+ *
  * @param e Event to hash.
- * @param seed Idk. Maybe it's gonna be a tree.
+ * @param seed Hash seed.
  *
- * @return Whatever qHash usually returns?
+ * @return The hash.
  */
 inline uint qHash(const calendar_event & e, uint seed)
 {
-  return qHash(e.date.toString("yyyy-M-d"), seed) ^
-         qHash(e.time.toString("hh:mm"), seed) ^
-         qHash(e.duration, seed);
+  return qHash(e.start, seed);
 }
 #endif
@@ -0,0 +1,138 @@
+// Copyright 2017 Hunter L. Allen
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "frame_codec.hpp"
+
+#include <QtEndian>
+
+/**
+ * @brief Read one request frame from a device.
+ *
+ * The length header is peeked at first; the frame is only
+ * consumed once all of it is buffered.
+ *
+ * @param _p_device Device to read from (usually a QTcpSocket).
+ * @param _verb Set to the request verb.
+ * @param _fields Set to the request fields, ints as decimal text.
+ * @return INCOMPLETE if more data is needed, MALFORMED if the frame
+ *   is invalid or too large, otherwise COMPLETE.
+ */
+frame_codec::status frame_codec::read_request(
+  QIODevice * _p_device,
+  QByteArray & _verb,
+  QList<QByteArray> & _fields)
+{
+  if (_p_device->bytesAvailable() < HEADER_SIZE) {return INCOMPLETE;}
+
+  QByteArray header = _p_device->peek(HEADER_SIZE);
+  quint32 length = qFromBigEndian<quint32>(
+    reinterpret_cast<const uchar *>(header.constData()));
+  if (length > MAX_FRAME) {return MALFORMED;}
+  if (_p_device->bytesAvailable() < HEADER_SIZE + (qint64) length) {return INCOMPLETE;}
+
+  _p_device->read(HEADER_SIZE);
+  return decode_request(_p_device->read(length), _verb, _fields) ? COMPLETE : MALFORMED;
+}
+
+/**
+ * @brief Decode the body of a request frame.
+ *
+ * @param _body Frame body, without the length header.
+ * @param _verb Set to the request verb.
+ * @param _fields Set to the request fields, ints as decimal text.
+ * @return False if the body is not a valid request.
+ */
+bool frame_codec::decode_request(
+  const QByteArray & _body,
+  QByteArray & _verb,
+  QList<QByteArray> & _fields)
+{
+  const uchar * p = reinterpret_cast<const uchar *>(_body.constData());
+  const uchar * end = p + _body.size();
+  _fields.clear();
+
+  /* verb */
+  if (end - p < 2) {return false;}
+  quint16 verb_length = qFromBigEndian<quint16>(p); p += 2;
+  if (end - p < verb_length) {return false;}
+  _verb = QByteArray(reinterpret_cast<const char *>(p), verb_length); p += verb_length;
+
+  /* fields */
+  if (end - p < 2) {return false;}
+  quint16 count = qFromBigEndian<quint16>(p); p += 2;
+  for (quint16 x = 0; x < count; ++x) {
+    if (end - p < 5) {return false;}
+    quint8 type = *p; p += 1;
+    quint32 length = qFromBigEndian<quint32>(p); p += 4;
+    if ((quint64) (end - p) < length) {return false;}
+    if (type == FIELD_STRING) {
+      _fields.append(QByteArray(reinterpret_cast<const char *>(p), length));
+    } else if (type == FIELD_INT && length == 8) {
+      _fields.append(QByteArray::number(qFromBigEndian<qint64>(p)));
+    } else {
+      return false;
+    }
+    p += length;
+  }
+  /* trailing garbage means the lengths are off */
+  return p == end;
+}
+
+/**
+ * @brief Build a request frame.
+ *
+ * Integer variants are sent as 'i' fields; everything else
+ * is converted to a string.
+ *
+ * @param _verb Request verb.
+ * @param _fields Request fields.
+ * @return The frame, length header included.
+ */
+QByteArray frame_codec::encode_request(const QByteArray & _verb, const QVariantList & _fields)
+{
+  QByteArray frame;
+  QDataStream out(&frame, QIODevice::WriteOnly);
+  out.setByteOrder(QDataStream::BigEndian);
+
+  out << (quint32) 0;
+  out << (quint16) _verb.size();
+  out.writeRawData(_verb.constData(), _verb.size());
+  out << (quint16) _fields.size();
+  for (const QVariant & field : _fields) {
+    if (field.type() == QVariant::Int || field.type() == QVariant::LongLong) {
+      out << FIELD_INT << (quint32) 8 << (qint64) field.toLongLong();
+    } else {
+      QByteArray bytes = field.toString().toUtf8();
+      out << FIELD_STRING << (quint32) bytes.size();
+      out.writeRawData(bytes.constData(), bytes.size());
+    }
+  }
+  qToBigEndian<quint32>(frame.size() - HEADER_SIZE, reinterpret_cast<uchar *>(frame.data()));
+  return frame;
+}
+
+/**
+ * @brief Build a reply frame.
+ *
+ * @param _reply Reply text; a trailing "\r\n" is dropped.
+ * @return The frame, length header included.
+ */
+QByteArray frame_codec::encode_reply(const QByteArray & _reply)
+{
+  int length = _reply.endsWith("\r\n") ? _reply.size() - 2 : _reply.size();
+  QByteArray frame(HEADER_SIZE, '\0');
+  qToBigEndian<quint32>(length, reinterpret_cast<uchar *>(frame.data()));
+  frame.append(_reply.constData(), length);
+  return frame;
+}
@@ -0,0 +1,61 @@
+// Copyright 2017 Hunter L. Allen
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __FRAME_CODEC_HPP__
+#define __FRAME_CODEC_HPP__
+#pragma once
+#include <QtCore>
+
+/**
+ * Encoder/decoder for the binary client protocol.
+ *
+ * A client that sends "FRAMING BINARY" as a text line switches
+ * its connection to length-prefixed frames. All integers are
+ * big-endian.
+ *
+ * Request frame:
+ *   quint32 body length (not counting these 4 bytes)
+ *   quint16 verb length, verb (ASCII)
+ *   quint16 field count, then for each field:
+ *     quint8 type ('s' = UTF-8 string, 'i' = qint64),
+ *     quint32 field length, field bytes
+ *
+ * Reply frame:
+ *   quint32 body length, reply (UTF-8, no line terminator)
+ *
+ * Frames are read straight out of the device's buffer: nothing
+ * is consumed until the whole frame has arrived, so a frame
+ * split over several TCP segments is only looked at once.
+ */
+class frame_codec
+{
+public:
+  enum status {INCOMPLETE, COMPLETE, MALFORMED};
+
+  static const quint8 FIELD_STRING = 's';
+  static const quint8 FIELD_INT = 'i';
+
+  static const int HEADER_SIZE = 4;
+  /* largest body we accept (1 MiB) */
+  static const quint32 MAX_FRAME = 1024 * 1024;
+
+  static status read_request(QIODevice * _p_device,
+    QByteArray & _verb, QList<QByteArray> & _fields);
+  static bool decode_request(const QByteArray & _body,
+    QByteArray & _verb, QList<QByteArray> & _fields);
+
+  static QByteArray encode_request(const QByteArray & _verb, const QVariantList & _fields);
+  static QByteArray encode_reply(const QByteArray & _reply);
+};
+#endif
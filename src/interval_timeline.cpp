@@ -0,0 +1,100 @@
+// Copyright 2017 Hunter L. Allen
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "interval_timeline.hpp"
+
+#include <algorithm>
+
+interval_timeline::interval_timeline()
+{ /* spans are added with insert */}
+
+interval_timeline::~interval_timeline()
+{ /* nothing to free */}
+
+/**
+ * @brief Mark a span as busy.
+ *
+ * @param _start First minute of the span.
+ * @param _end First minute after the span.
+ */
+void interval_timeline::insert(const qint64 & _start, const qint64 & _end)
+{
+  if (_end <= _start) {return;}
+  /* the usual case: after everything so far */
+  if (m_bounds.isEmpty() || _start > m_bounds.last()) {
+    m_bounds.append(_start);
+    m_bounds.append(_end);
+    return;
+  }
+
+  /* bounds [first, last) are swallowed by the new span */
+  int first = int(std::lower_bound(m_bounds.constBegin(), m_bounds.constEnd(), _start) -
+    m_bounds.constBegin());
+  int last = int(std::upper_bound(m_bounds.constBegin(), m_bounds.constEnd(), _end) -
+    m_bounds.constBegin());
+  /* an odd index is inside a span, which then keeps its own start or end */
+  qint64 kept[2];
+  int count = 0;
+  if (!(first & 1)) {kept[count++] = _start;}
+  if (!(last & 1)) {kept[count++] = _end;}
+
+  int swallowed = last - first;
+  if (swallowed > count) {
+    m_bounds.remove(first + count, swallowed - count);
+  } else if (swallowed < count) {
+    m_bounds.insert(first, count - swallowed, 0);
+  }
+  for (int x = 0; x < count; ++x) {m_bounds[first + x] = kept[x];}
+}
+
+/**
+ * @brief Check whether any of a span is busy.
+ *
+ * @param _start First minute of the span.
+ * @param _end First minute after the span.
+ * @return True if the span overlaps a busy one.
+ */
+bool interval_timeline::overlaps(const qint64 & _start, const qint64 & _end) const
+{
+  if (_end <= _start) {return false;}
+  int x = int(std::upper_bound(m_bounds.constBegin(), m_bounds.constEnd(), _start) -
+    m_bounds.constBegin());
+  /* inside a span, or the next one starts before the end */
+  return (x & 1) || (x < m_bounds.size() && m_bounds[x] < _end);
+}
+
+/**
+ * @brief Find the free time between two minutes.
+ *
+ * @param _from First minute to look at.
+ * @param _until First minute after the last one to look at.
+ * @return The free spans, in order.
+ */
+QVector<interval_timeline::span> interval_timeline::gaps(
+  const qint64 & _from,
+  const qint64 & _until) const
+{
+  QVector<span> free;
+  int x = int(std::upper_bound(m_bounds.constBegin(), m_bounds.constEnd(), _from) -
+    m_bounds.constBegin());
+  /* starting inside a span means starting at its end */
+  qint64 cursor = (x & 1) ? m_bounds[x++] : _from;
+  for (; cursor < _until; x += 2) {
+    qint64 next = (x < m_bounds.size()) ? qMin(m_bounds[x], _until) : _until;
+    if (next > cursor) {free.append(span{cursor, next});}
+    if (x >= m_bounds.size()) {break;}
+    cursor = m_bounds[x + 1];
+  }
+  return free;
+}
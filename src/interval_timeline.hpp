@@ -0,0 +1,56 @@
+// Copyright 2017 Hunter L. Allen
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __INTERVAL_TIMELINE_HPP__
+#define __INTERVAL_TIMELINE_HPP__
+#pragma once
+#include <QtCore>
+
+/**
+ * The busy times on a schedule, sorted and merged.
+ *
+ * Kept as one flat vector of bounds: start, end, start, end, ...
+ * in increasing order, so spans never overlap or touch. A minute
+ * t is busy when an odd number of bounds are <= t, which makes
+ * every lookup a binary search. Inserting merges with whatever the
+ * new span overlaps; inserting in time order only appends.
+ *
+ * Times are in minutes, as counted by availability::minute().
+ */
+class interval_timeline
+{
+public:
+  struct span
+  {
+    qint64 start;   /* first minute */
+    qint64 end;     /* first minute after */
+  };
+
+  interval_timeline();
+  virtual ~interval_timeline();
+
+  void insert(const qint64 & _start, const qint64 & _end);
+  void reserve(const int & _spans) {m_bounds.reserve(_spans * 2);}
+  void clear() {m_bounds.clear();}
+
+  int size() const {return m_bounds.size() / 2;}
+  span at(const int & _index) const {return span{m_bounds[2 * _index], m_bounds[2 * _index + 1]};}
+
+  bool overlaps(const qint64 & _start, const qint64 & _end) const;
+  QVector<span> gaps(const qint64 & _from, const qint64 & _until) const;
+
+private:
+  QVector<qint64> m_bounds;
+};
+#endif
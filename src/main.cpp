@@ -34,6 +34,11 @@ int main(int argc, char ** argv)
     quint16 master_port = 3224;
     QString worker_host = "localhost";
     quint16 worker_port = 3442;
+    int idle_timeout = 30000;
+    int max_clients = 1;
+    int db_pool_size = QThread::idealThreadCount();
+    qint64 token_ttl = 3600;
+    qint64 auth_ttl = 30000;
 
     if (args.filter("--mhost").size()) {
       master_host = args.filter("--mhost")[0];
@@ -57,10 +62,45 @@ int main(int argc, char ** argv)
       worker_port = port.toUShort(&ok);
       if (!ok) {goto error;}
     }
+    if (args.filter("--idle").size()) {
+      QString idle = args.filter("--idle")[0];
+      idle.replace("--idle=", ""); bool ok;
+      idle_timeout = idle.toInt(&ok) * 1000;
+      if (!ok || idle_timeout <= 0) {goto error;}
+    }
+    if (args.filter("--max-clients").size()) {
+      QString clients = args.filter("--max-clients")[0];
+      clients.replace("--max-clients=", ""); bool ok;
+      max_clients = clients.toInt(&ok);
+      if (!ok || max_clients <= 0) {goto error;}
+    }
+    if (args.filter("--db-pool").size()) {
+      QString pool = args.filter("--db-pool")[0];
+      pool.replace("--db-pool=", ""); bool ok;
+      db_pool_size = pool.toInt(&ok);
+      if (!ok || db_pool_size <= 0) {goto error;}
+    }
+    if (args.filter("--token-ttl").size()) {
+      QString ttl = args.filter("--token-ttl")[0];
+      ttl.replace("--token-ttl=", ""); bool ok;
+      token_ttl = ttl.toLongLong(&ok);
+      if (!ok || token_ttl <= 0) {goto error;}
+    }
+    if (args.filter("--auth-ttl").size()) {
+      QString ttl = args.filter("--auth-ttl")[0];
+      ttl.replace("--auth-ttl=", ""); bool ok;
+      auth_ttl = ttl.toLongLong(&ok) * 1000;
+      if (!ok || auth_ttl < 0) {goto error;}
+    }
 
     worker_node worker(worker_host, worker_port);
     worker.set_master_hostname(master_host);
     worker.set_master_port(master_port);
+    worker.set_idle_timeout(idle_timeout);
+    worker.set_max_clients(max_clients);
+    worker.set_db_pool_size(db_pool_size);
+    worker.set_token_ttl(token_ttl);
+    worker.set_auth_cache_ttl(auth_ttl);
     worker.init();
     return app.exec();
   } else if (!strcmp(argv[1], "--master")) {
@@ -80,6 +120,13 @@ int main(int argc, char ** argv)
     }
 
     master_node master(master_host, master_port);
+    if (args.filter("--policy").size()) {
+      QString policy = args.filter("--policy")[0];
+      policy.replace("--policy=", "");
+      worker_selection_policy * p_policy = worker_selection_policy::create(policy);
+      if (p_policy == NULL) {goto error;}
+      master.set_policy(p_policy);
+    }
     master.init();
     return app.exec();
   } else {goto error;}
@@ -93,5 +140,11 @@ error:
   std::cerr << "\t[--whost=<worker>]" << std::endl;
   std::cerr << "\t[--mport=<master port>]" << std::endl;
   std::cerr << "\t[--wport=<worker port]" << std::endl;
+  std::cerr << "\t[--idle=<worker session idle timeout, in seconds>]" << std::endl;
+  std::cerr << "\t[--max-clients=<clients a worker serves at once>]" << std::endl;
+  std::cerr << "\t[--db-pool=<database connections (and threads) a worker uses>]" << std::endl;
+  std::cerr << "\t[--token-ttl=<seconds a worker's session tokens stay valid>]" << std::endl;
+  std::cerr << "\t[--auth-ttl=<seconds a worker remembers a login, 0 to not>]" << std::endl;
+  std::cerr << "\t[--policy=fifo|least-outstanding|latency|p2c|affinity]" << std::endl;
   return 1;
 }
@@ -14,6 +14,8 @@
 
 #include "master_node.hpp"
 
+const size_t master_node::QUEUE_CAPACITY;
+
 /**
  * Construct the master node for the timefuse-server.
  *
@@ -26,15 +28,15 @@
 master_node::master_node(const QString & _hostname, const quint16 & _port, QObject * _p_parent)
 : QObject(_p_parent),
   m_hostname(_hostname),
-  m_port(_port)
+  m_port(_port),
+  m_client_connections(QUEUE_CAPACITY),
+  m_worker_connections(QUEUE_CAPACITY)
 {
-  /* create mutexes */
-  m_p_client_mutex = new QMutex();
-  m_p_worker_mutex = new QMutex();
-
-  /* create semaphores */
-  m_p_client_sema = new QSemaphore();
-  m_p_worker_sema = new QSemaphore();
+  /* released once per enqueue */
+  m_p_enqueued = new QSemaphore();
+  /* first come, first served unless told otherwise */
+  m_p_policy = new fifo_policy();
+  m_p_routes_lock = new QReadWriteLock();
 }
 
 master_node::~master_node()
@@ -80,9 +82,6 @@ bool master_node::init()
 
   connect(this, &master_node::send_info,
     m_p_tcp_thread, &tcp_thread::send_pair_info);
-  connect(m_p_tcp_thread, &tcp_thread::dropped_connection,
-    this, &master_node::handle_disconnect,
-    Qt::DirectConnection);
   return m_p_thread->isRunning();
 }
 
@@ -90,138 +89,236 @@ bool master_node::init()
  * @brief Handler for client connection.
  *
  * This function enqueue's the incoming
- * client connection in a thread-safe
- * manner.
+ * client connection. The queue is lock-free,
+ * so this never waits on the pairing thread.
  *
  * @param _client Newly connected client.
+ * @return False if the queue is full.
  */
-void master_node::handle_client_connect(client_connection * _client)
+bool master_node::handle_client_connect(client_connection * _client)
 {
   std::cerr << "caught client connect" << std::endl;
-  /* lock the mutex guarding our semaphore */
-  m_p_client_mutex->lock();
-  /* release resources in the semaphore */
-  m_p_client_sema->release();
   /* enqueue the client */
-  m_client_connections.enqueue(_client);
-  /* unlock the mutex */
-  m_p_client_mutex->unlock();
+  if (!m_client_connections.enqueue(_client)) {return false;}
+  /* wake the pairing loop */
+  m_p_enqueued->release();
   std::cerr << "added new client" << std::endl;
+  return true;
 }
 
 /**
  * @brief Handler for worker connection.
  *
  * This function enqueue's the incoming
- * worker connection in a thread-safe
- * manner.
+ * worker connection. The queue is lock-free,
+ * so this never waits on the pairing thread.
  *
  * @param _worker Newly connected worker.
+ * @return False if the queue is full.
  */
-void master_node::handle_worker_connect(worker_connection * _worker)
+bool master_node::handle_worker_connect(worker_connection * _worker)
 {
   std::cerr << "caught worker connect" << std::endl;
-  /* lock the mutex guarding our semaphore */
-  m_p_worker_mutex->lock();
-  /* release resources in the semaphore */
-  m_p_worker_sema->release();
   /* enqueue the worker */
-  m_worker_connections.enqueue(_worker);
-  /* unlock the mutex */
-  m_p_worker_mutex->unlock();
+  if (!m_worker_connections.enqueue(_worker)) {return false;}
+  /* wake the pairing loop */
+  m_p_enqueued->release();
   std::cerr << "added new worker" << std::endl;
+  return true;
+}
+
+/**
+ * @brief Handler for worker load reports.
+ *
+ * A report can free up slots, so the pairing
+ * loop is woken to look at waiting clients.
+ *
+ * @param _worker Worker that reported.
+ */
+void master_node::handle_worker_load(worker_connection *)
+{
+  m_p_enqueued->release();
+}
+
+/**
+ * @brief Choose how workers are picked for clients.
+ *
+ * Must be called before init().
+ *
+ * @param _p_policy The policy (we take ownership).
+ */
+void master_node::set_policy(worker_selection_policy * _p_policy)
+{
+  delete m_p_policy;
+  m_p_policy = _p_policy;
+  std::cout << "worker selection policy: " << m_p_policy->name() << std::endl;
+}
+
+/**
+ * @brief Build the reply to ROUTING_TABLE.
+ *
+ * Clients may cache the table and connect to the workers
+ * directly, coming back when a worker fails them or the
+ * version changes. Called from the tcp thread.
+ *
+ * @return "<version>:::<count>\r\n" followed by one
+ *   "<host:port>:::<weight>\r\n" line per worker, where
+ *   weight is how many more clients the worker has room for.
+ */
+QByteArray master_node::routing_table()
+{
+  m_p_routes_lock->lockForRead();
+  QByteArray table = QByteArray::number(m_routes_version) + ":::" +
+    QByteArray::number(m_routes.size()) + "\r\n";
+  for (const route & r : m_routes) {
+    table += r.location.toUtf8() + ":::" + QByteArray::number(r.weight) + "\r\n";
+  }
+  m_p_routes_lock->unlock();
+  return table;
+}
+
+/**
+ * @brief Publish the workers that are safe to hand out.
+ *
+ * Only registered workers that have reported lately are
+ * listed; one-shot workers are left to the master. The
+ * version goes up whenever the set of workers changes,
+ * but not when only their weights do.
+ */
+void master_node::publish_routes()
+{
+  qint64 now = QDateTime::currentMSecsSinceEpoch();
+  QList<route> routes;
+  for (worker_connection * w : m_idle_workers) {
+    if (!w->is_persistent() || w->is_dropped()) {continue;}
+    if (now - w->get_last_report() > WORKER_TIMEOUT) {continue;}
+    routes.append(route{w->get_hostname(), qMax(0, w->get_free_slots())});
+  }
+
+  m_p_routes_lock->lockForWrite();
+  bool changed = routes.size() != m_routes.size();
+  for (int x = 0; !changed && x < routes.size(); ++x) {
+    changed = routes[x].location != m_routes[x].location;
+  }
+  if (changed) {++m_routes_version;}
+  m_routes = routes;
+  m_p_routes_lock->unlock();
+}
+
+/**
+ * @brief Stop the pairing loop.
+ */
+void master_node::stop()
+{
+  m_continue = false;
+  m_p_enqueued->release();
+}
+
+/**
+ * @brief Take the next live entry off a queue.
+ *
+ * The entry is claimed for pairing. Entries whose
+ * connection dropped while they were queued are
+ * thrown away.
+ *
+ * @param _queue Queue to take from.
+ * @param _p_entry Set to the entry.
+ * @return False if the queue has no live entries.
+ */
+template <typename T>
+static bool next_live(mpmc_queue<T *> & _queue, T * & _p_entry)
+{
+  while (_queue.dequeue(_p_entry)) {
+    if (_p_entry->claim()) {return true;}
+    _p_entry->deleteLater();
+  }
+  _p_entry = NULL;
+  return false;
 }
 
 /**
  * @brief run function for this thread
  *
  * This is the main run loop for the master
- * thread. The master loops through resources,
- * while necessary and pairs a client to
- * a worker when both are available.
+ * thread. It sleeps until a client or worker
+ * is enqueued, then pairs off as many clients
+ * and workers as are waiting. Each pass ends
+ * by publishing the routing table.
+ *
+ * Newly registered workers are moved into a pool
+ * that only this thread touches. For each client
+ * the selection policy picks one of the workers
+ * in the pool that has a free slot (by the
+ * client's username, if it gave one). A client
+ * taken off the queue while no worker has room
+ * is held on to until one does.
+ *
+ * Workers with a control connection stay in the
+ * pool until they disconnect; a worker that sent
+ * REQUEST_CLIENT leaves it once it is paired.
  */
 void master_node::run()
 {
-  const quint16 sleep_time = 100;
-
   std::cout << "Master Thread started" << std::endl;
 
-  for (; m_continue; m_p_thread->msleep(sleep_time)) {
-    /* lock client mutex */
-    m_p_client_mutex->lock();
-    /* lock worker mutex */
-    m_p_worker_mutex->lock();
+  while (m_continue) {
+    /* sleep until something is enqueued, or it is time to look at the workers */
+    m_p_enqueued->tryAcquire(1, ROUTES_INTERVAL);
+    /* this pass picks up everything enqueued since */
+    m_p_enqueued->tryAcquire(m_p_enqueued->available());
 
-    /* check that our queue is non-empty */
-    if (!(m_client_connections.size() && m_worker_connections.size())) {
-      /* unlock mutexes and continue */
-
-      m_p_client_mutex->unlock();
-      m_p_worker_mutex->unlock();
-      continue;
+    /* move new workers into the pool, and clear out any that left */
+    worker_connection * w;
+    while (m_worker_connections.dequeue(w)) {
+      m_idle_workers.append(w);
+      m_p_policy->worker_added(w);
+    }
+    for (int x = m_idle_workers.size() - 1; x >= 0; --x) {
+      if (m_idle_workers[x]->is_dropped()) {
+        m_p_policy->worker_removed(m_idle_workers[x]);
+        m_idle_workers.takeAt(x)->deleteLater();
+      }
     }
-    m_p_worker_mutex->unlock();               /* unlock the worker mutex */
-
-    /* now try to acquire a client */
-    m_p_client_sema->acquire();
-    /* dequeue the client */
-    client_connection * c = m_client_connections.dequeue();
-    /* unlock client mutex */
-    m_p_client_mutex->unlock();
-
-    /* lock worker mutex */
-    m_p_worker_mutex->lock();
 
-    /* try to acquire a worker */
-    m_p_worker_sema->acquire();
-    worker_connection * w = m_worker_connections.dequeue();
-    /* unlock the worker mutex */
-    m_p_worker_mutex->unlock();
+    for (;;) {
+      /* a client we held on to may have left in the meantime */
+      if (m_p_held_client != NULL && m_p_held_client->is_dropped()) {
+        m_p_held_client->deleteLater(); m_p_held_client = NULL;
+      }
+      if (m_p_held_client == NULL && !next_live(m_client_connections, m_p_held_client)) {break;}
 
-    /* send client to worker */
-    w->add_client(c);
+      /* workers that can take a client */
+      qint64 now = QDateTime::currentMSecsSinceEpoch();
+      QList<worker_connection *> candidates;
+      for (worker_connection * x : m_idle_workers) {
+        if (x->get_free_slots() <= 0 || x->is_dropped()) {continue;}
+        /* a registered worker that stopped reporting is not to be trusted */
+        if (x->is_persistent() && now - x->get_last_report() > WORKER_TIMEOUT) {continue;}
+        candidates.append(x);
+      }
+      if (candidates.isEmpty()) {break;}
 
-    /* send worker to client */
-    c->add_worker(w);
+      client_connection * c = m_p_held_client;
+      w = candidates[m_p_policy->select_for(candidates, c->get_username())];
+      if (!w->is_persistent()) {
+        /* a one-shot worker is used up */
+        m_idle_workers.removeOne(w);
+        m_p_policy->worker_removed(w);
+        if (!w->claim()) {w->deleteLater(); continue;}
+      }
+      w->note_paired();
+      m_p_held_client = NULL;
 
-    /* send pair info */
-    Q_EMIT (send_info(w));
-    Q_EMIT (send_info(c));
-  }
-}
+      /* send client to worker */
+      w->add_client(c);
 
-void master_node::handle_disconnect(tcp_connection * _dropped)
-{
-  QString dropped_host = _dropped->get_hostname();
-  /* lock both mutexes, as we could have either */
-  m_p_worker_mutex->lock();
-  m_p_client_mutex->lock();
-
-  /* find a worker */
-  for (const auto & x : m_worker_connections) {
-    if (*_dropped == *x) {
-      /* found the worker */
-      std::cout << "worker dropped" << std::endl;
-      m_worker_connections.removeAt(m_worker_connections.indexOf(x));
-      m_p_worker_mutex->unlock();
-      m_p_client_mutex->unlock();
-      delete _dropped; return;
-    }
-  }
+      /* send worker to client */
+      c->add_worker(w);
 
-  for (const auto & x : m_client_connections) {
-    if (*_dropped == *((tcp_connection *)x)) {
-      /* found the client */
-      std::cout << "client dropped" << std::endl;
-      m_client_connections.removeAt(m_client_connections.indexOf(x));
-      m_p_worker_mutex->unlock();
-      m_p_client_mutex->unlock();
-      delete _dropped; return;
+      /* send pair info */
+      Q_EMIT (send_info(w));
+      Q_EMIT (send_info(c));
     }
+    publish_routes();
   }
-
-  std::cerr << "warning: could not find dropped connection" << std::endl;
-  m_p_worker_mutex->unlock();
-  m_p_client_mutex->unlock();
-  delete _dropped;
 }
@@ -22,6 +22,8 @@
 
 /* File Includes */
 #include "tcp_thread.hpp"
+#include "mpmc_queue.hpp"
+#include "worker_selection_policy.hpp"
 /* #include "slave.hpp" */
 
 class tcp_thread;
@@ -56,13 +58,19 @@ public:
   Q_SIGNAL void send_info(tcp_connection * receiver);
 
   /* Callback functions for tcp connections */
-  Q_SLOT void handle_client_connect(client_connection * _client);
-  Q_SLOT void handle_worker_connect(worker_connection * _worker);
-  Q_SLOT void handle_disconnect(tcp_connection * _dropped);
+  Q_SLOT bool handle_client_connect(client_connection * _client);
+  Q_SLOT bool handle_worker_connect(worker_connection * _worker);
+  Q_SLOT void handle_worker_load(worker_connection * _worker);
 
-  Q_SLOT void stop() {m_continue = false;}
+  Q_SLOT void stop();
+
+  void set_policy(worker_selection_policy * _p_policy);
+
+  QByteArray routing_table();
 
 private:
+  void publish_routes();
+
   volatile bool m_continue = true;
 
   QString m_hostname;
@@ -71,10 +79,30 @@ private:
   tcp_thread * m_p_tcp_thread;
   QThread * m_p_thread;
 
-  QQueue<worker_connection *> m_worker_connections;
-  QQueue<client_connection *> m_client_connections;
-
-  QSemaphore * m_p_client_sema; QMutex * m_p_client_mutex;
-  QSemaphore * m_p_worker_sema; QMutex * m_p_worker_mutex;
+  /* room for this many waiting clients (and workers) */
+  static const size_t QUEUE_CAPACITY = 4096;
+  /* a registered worker silent for this long (in ms) gets no clients */
+  static const qint64 WORKER_TIMEOUT = 5000;
+  /* the pairing thread looks over the workers at least this often (in ms) */
+  static const int ROUTES_INTERVAL = 1000;
+
+  mpmc_queue<client_connection *> m_client_connections;
+  mpmc_queue<worker_connection *> m_worker_connections;
+  QSemaphore * m_p_enqueued;
+
+  /* only touched by the pairing thread */
+  client_connection * m_p_held_client = NULL;
+  QList<worker_connection *> m_idle_workers;     /* registered workers */
+  worker_selection_policy * m_p_policy;
+
+  /* healthy workers, written by the pairing thread and read by the tcp thread */
+  struct route
+  {
+    QString location;
+    int weight;
+  };
+  QReadWriteLock * m_p_routes_lock;
+  QList<route> m_routes;
+  quint64 m_routes_version = 0;
 };
 #endif
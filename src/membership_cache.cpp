@@ -0,0 +1,159 @@
+// Copyright 2017 Hunter L. Allen
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "membership_cache.hpp"
+
+/**
+ * @brief Construct a membership_cache.
+ *
+ * @param _capacity Most groups remembered at once.
+ * @param _ttl Time (in ms) a group is trusted for.
+ */
+membership_cache::membership_cache(const int & _capacity, const qint64 & _ttl)
+: m_p_mutex(new QMutex()),
+  m_groups(_capacity),
+  m_ttl(_ttl)
+{ /* groups are loaded as they are asked about */}
+
+membership_cache::~membership_cache()
+{
+  m_groups.clear();
+  delete m_p_mutex;
+}
+
+/**
+ * @brief Get the members of a group.
+ *
+ * @param _group The group.
+ * @param _members Filled with the members, in the order they were loaded.
+ * @return False if the group is not cached; ask the database.
+ */
+bool membership_cache::members(const QString & _group, QStringList & _members)
+{
+  m_p_mutex->lock();
+  group_entry * p = lookup(key(_group));
+  if (p != NULL) {_members = p->members;}
+  m_p_mutex->unlock();
+  return p != NULL;
+}
+
+/**
+ * @brief Check whether a user is in a group.
+ *
+ * @param _group The group.
+ * @param _user The user.
+ * @param _member Set to the answer, if there is one.
+ * @return False if the group is not cached; ask the database.
+ */
+bool membership_cache::find(const QString & _group, const QString & _user, bool & _member)
+{
+  m_p_mutex->lock();
+  group_entry * p = lookup(key(_group));
+  if (p != NULL) {_member = p->keys.contains(key(_user));}
+  m_p_mutex->unlock();
+  return p != NULL;
+}
+
+/**
+ * @brief Remember the members of a group, as just loaded.
+ *
+ * @param _group The group.
+ * @param _members Its members.
+ * @param _generation generation() from before the members were loaded.
+ */
+void membership_cache::insert(
+  const QString & _group,
+  const QStringList & _members,
+  const quint64 & _generation)
+{
+  group_entry * p = new group_entry();
+  p->key = key(_group);
+  p->members = _members;
+  p->expires = QDateTime::currentMSecsSinceEpoch() + m_ttl;
+  p->p_index = &m_groups_of;
+  for (const QString & member : _members) {p->keys.insert(key(member));}
+
+  m_p_mutex->lock();
+  if (_generation != m_generation.load()) {
+    /* not indexed yet, so there is nothing to unhook */
+    p->keys.clear(); delete p;
+  } else {
+    /* replaces (and unhooks) any older entry before we hook the new one */
+    m_groups.remove(p->key);
+    for (const QString & member : p->keys) {m_groups_of[member].insert(p->key);}
+    m_groups.insert(p->key, p);
+  }
+  m_p_mutex->unlock();
+}
+
+/**
+ * @brief Forget a group, because its members changed.
+ *
+ * @param _group The group.
+ */
+void membership_cache::invalidate_group(const QString & _group)
+{
+  m_p_mutex->lock();
+  m_generation.ref();
+  m_groups.remove(key(_group));
+  m_p_mutex->unlock();
+}
+
+/**
+ * @brief Forget every group a user is in, e.g. because they were renamed.
+ *
+ * @param _user The user.
+ */
+void membership_cache::invalidate_user(const QString & _user)
+{
+  m_p_mutex->lock();
+  m_generation.ref();
+  /* copied, since each removal edits the index */
+  QSet<QString> groups = m_groups_of.value(key(_user));
+  for (const QString & group : groups) {m_groups.remove(group);}
+  m_p_mutex->unlock();
+}
+
+/**
+ * @brief Count the remembered groups.
+ */
+int membership_cache::size()
+{
+  m_p_mutex->lock();
+  int size = m_groups.size();
+  m_p_mutex->unlock();
+  return size;
+}
+
+/* call with m_p_mutex held */
+membership_cache::group_entry * membership_cache::lookup(const QString & _key)
+{
+  group_entry * p = m_groups.object(_key);
+  if (p != NULL && p->expires <= QDateTime::currentMSecsSinceEpoch()) {
+    m_groups.remove(_key);
+    p = NULL;
+  }
+  (p != NULL) ? m_hits.ref() : m_misses.ref();
+  return p;
+}
+
+membership_cache::group_entry::~group_entry()
+{
+  for (const QString & member : keys) {
+    user_index::iterator it = p_index->find(member);
+    if (it == p_index->end()) {continue;}
+    it->remove(key);
+    if (it->isEmpty()) {p_index->erase(it);}
+  }
+}
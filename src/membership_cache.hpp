@@ -0,0 +1,81 @@
+// Copyright 2017 Hunter L. Allen
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __MEMBERSHIP_CACHE_HPP__
+#define __MEMBERSHIP_CACHE_HPP__
+#pragma once
+#include <QtCore>
+
+/**
+ * Remembers who is in which group.
+ *
+ * Groups are loaded whole, the first time one is asked about,
+ * and indexed both ways: group -> members and user -> groups.
+ * Membership checks are then hash lookups. Names are compared
+ * case-insensitively, as the database does.
+ *
+ * Changes made through this worker must invalidate the group
+ * (or, on a rename, the user); entries also expire, so changes
+ * made through other workers show up after the time to live.
+ * As with auth_cache, a load passes the generation() from before
+ * its query to insert(), so it can not undo an invalidation.
+ *
+ * Safe to use from several threads.
+ */
+class membership_cache
+{
+public:
+  explicit membership_cache(const int & _capacity, const qint64 & _ttl);
+  virtual ~membership_cache();
+
+  bool members(const QString & _group, QStringList & _members);
+  bool find(const QString & _group, const QString & _user, bool & _member);
+  void insert(const QString & _group, const QStringList & _members, const quint64 & _generation);
+  void invalidate_group(const QString & _group);
+  void invalidate_user(const QString & _user);
+
+  quint64 generation() const {return m_generation.load();}
+
+  quint64 hits() const {return m_hits.load();}
+  quint64 misses() const {return m_misses.load();}
+  int size();
+
+private:
+  typedef QHash<QString, QSet<QString> > user_index;
+
+  /* unhooks itself from the user index when QCache drops it */
+  struct group_entry
+  {
+    QString key;
+    QStringList members;
+    QSet<QString> keys;     /* members, case folded */
+    qint64 expires;
+    user_index * p_index;
+    ~group_entry();
+  };
+
+  group_entry * lookup(const QString & _key);
+
+  static QString key(const QString & _name) {return _name.toCaseFolded();}
+
+  QMutex * m_p_mutex;
+  /* guarded by m_p_mutex */
+  QCache<QString, group_entry> m_groups;
+  user_index m_groups_of;
+  qint64 m_ttl;   /* in ms */
+  QAtomicInteger<quint64> m_generation;
+  QAtomicInteger<quint64> m_hits;
+  QAtomicInteger<quint64> m_misses;
+};
+#endif
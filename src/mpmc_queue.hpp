@@ -0,0 +1,133 @@
+// Copyright 2017 Hunter L. Allen
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __MPMC_QUEUE_HPP__
+#define __MPMC_QUEUE_HPP__
+#pragma once
+#include <QtGlobal>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Bounded, lock-free, multi-producer multi-consumer queue.
+ *
+ * This is Dmitry Vyukov's array queue: every cell carries a
+ * sequence number that tells producers and consumers whose
+ * turn it is, so the only shared writes are one CAS on the
+ * enqueue or dequeue position. Enqueue and dequeue never
+ * block; they fail when the queue is full or empty.
+ *
+ * The capacity must be a power of two.
+ */
+template <typename T>
+class mpmc_queue
+{
+public:
+  explicit mpmc_queue(const size_t & _capacity)
+  : m_mask(_capacity - 1),
+    m_p_cells(new cell[_capacity])
+  {
+    Q_ASSERT(_capacity >= 2 && (_capacity & (_capacity - 1)) == 0);
+    for (size_t x = 0; x < _capacity; ++x) {
+      m_p_cells[x].sequence.store(x, std::memory_order_relaxed);
+    }
+    m_enqueue_pos.store(0, std::memory_order_relaxed);
+    m_dequeue_pos.store(0, std::memory_order_relaxed);
+  }
+  virtual ~mpmc_queue() {delete [] m_p_cells;}
+
+  mpmc_queue(const mpmc_queue &) = delete;
+  mpmc_queue & operator=(const mpmc_queue &) = delete;
+
+  size_t capacity() const {return m_mask + 1;}
+
+  /**
+   * @brief Add an element to the back of the queue.
+   * @return False if the queue is full.
+   */
+  bool enqueue(const T & _data)
+  {
+    cell * p_cell;
+    size_t pos = m_enqueue_pos.load(std::memory_order_relaxed);
+    for (;;) {
+      p_cell = &m_p_cells[pos & m_mask];
+      size_t seq = p_cell->sequence.load(std::memory_order_acquire);
+      intptr_t dif = (intptr_t) seq - (intptr_t) pos;
+      if (dif == 0) {
+        /* the cell is free; try to claim it */
+        if (m_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {break;}
+      } else if (dif < 0) {
+        /* the cell still holds an element from the last lap */
+        return false;
+      } else {
+        /* another producer got here first */
+        pos = m_enqueue_pos.load(std::memory_order_relaxed);
+      }
+    }
+    p_cell->data = _data;
+    p_cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Take the element at the front of the queue.
+   * @return False if the queue is empty.
+   */
+  bool dequeue(T & _data)
+  {
+    cell * p_cell;
+    size_t pos = m_dequeue_pos.load(std::memory_order_relaxed);
+    for (;;) {
+      p_cell = &m_p_cells[pos & m_mask];
+      size_t seq = p_cell->sequence.load(std::memory_order_acquire);
+      intptr_t dif = (intptr_t) seq - (intptr_t) (pos + 1);
+      if (dif == 0) {
+        /* the cell is full; try to claim it */
+        if (m_dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {break;}
+      } else if (dif < 0) {
+        /* nothing has been written here yet */
+        return false;
+      } else {
+        /* another consumer got here first */
+        pos = m_dequeue_pos.load(std::memory_order_relaxed);
+      }
+    }
+    _data = p_cell->data;
+    /* hand the cell to the producer one lap ahead */
+    p_cell->sequence.store(pos + m_mask + 1, std::memory_order_release);
+    return true;
+  }
+
+private:
+  struct cell
+  {
+    std::atomic<size_t> sequence;
+    T data;
+  };
+
+  /* keep the two positions on separate cache lines */
+  static const size_t CACHE_LINE = 64;
+
+  char m_pad0[CACHE_LINE];
+  const size_t m_mask;
+  cell * const m_p_cells;
+  char m_pad1[CACHE_LINE];
+  std::atomic<size_t> m_enqueue_pos;
+  char m_pad2[CACHE_LINE];
+  std::atomic<size_t> m_dequeue_pos;
+  char m_pad3[CACHE_LINE];
+};
+#endif
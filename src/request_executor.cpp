@@ -0,0 +1,126 @@
+// Copyright 2017 Hunter L. Allen
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "request_executor.hpp"
+
+#include <iostream>
+
+/**
+ * @brief Construct a request_executor and start its threads.
+ *
+ * @param _threads Threads to run tasks on (at least one).
+ * @param _max_queued Tasks that may wait for a thread.
+ * @param _thread_init Run by each thread when it starts, if set.
+ */
+request_executor::request_executor(
+  const int & _threads,
+  const int & _max_queued,
+  const task & _thread_init)
+: m_p_mutex(new QMutex()),
+  m_p_ready(new QWaitCondition()),
+  m_thread_init(_thread_init),
+  m_max_queued(_max_queued)
+{
+  for (int x = 0; x < qMax(1, _threads); ++x) {
+    executor_thread * p_thread = new executor_thread(this);
+    m_threads.append(p_thread);
+    p_thread->start();
+  }
+}
+
+/**
+ * @brief destruct a request_executor
+ *
+ * Tasks still waiting are run before the threads exit.
+ */
+request_executor::~request_executor()
+{
+  stop();
+  qDeleteAll(m_threads);
+  delete m_p_ready;
+  delete m_p_mutex;
+}
+
+/**
+ * @brief Queue a task for the next free thread.
+ *
+ * @param _task The task.
+ * @return False if the queue is full (or we are stopping).
+ */
+bool request_executor::submit(const task & _task)
+{
+  m_p_mutex->lock();
+  if (m_stopping || m_tasks.size() >= m_max_queued) {
+    m_p_mutex->unlock();
+    return false;
+  }
+  m_tasks.enqueue(_task);
+  m_p_ready->wakeOne();
+  m_p_mutex->unlock();
+  return true;
+}
+
+/**
+ * @brief Finish the queued tasks and wait for the threads.
+ */
+void request_executor::stop()
+{
+  m_p_mutex->lock();
+  m_stopping = true;
+  m_p_ready->wakeAll();
+  m_p_mutex->unlock();
+  for (executor_thread * p_thread : m_threads) {p_thread->wait();}
+}
+
+/**
+ * @brief Count the tasks waiting for a thread.
+ */
+int request_executor::queued()
+{
+  m_p_mutex->lock();
+  int size = m_tasks.size();
+  m_p_mutex->unlock();
+  return size;
+}
+
+/**
+ * @brief Run tasks until we are stopped and the queue is empty.
+ */
+void request_executor::work()
+{
+  if (m_thread_init) {
+    try {
+      m_thread_init();
+    } catch (...) {
+      std::cerr << "executor thread failed to start up" << std::endl;
+    }
+  }
+  for (;;) {
+    m_p_mutex->lock();
+    while (m_tasks.isEmpty() && !m_stopping) {m_p_ready->wait(m_p_mutex);}
+    if (m_tasks.isEmpty()) {
+      m_p_mutex->unlock();
+      return;
+    }
+    task next = m_tasks.dequeue();
+    m_p_mutex->unlock();
+
+    /* an exception must not take the thread down with it */
+    try {
+      next();
+    } catch (...) {
+      std::cerr << "request handler threw an exception" << std::endl;
+    }
+  }
+}
@@ -0,0 +1,74 @@
+// Copyright 2017 Hunter L. Allen
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __REQUEST_EXECUTOR_HPP__
+#define __REQUEST_EXECUTOR_HPP__
+#pragma once
+#include <QtCore>
+
+#include <functional>
+
+/**
+ * A fixed set of threads that run blocking request handlers.
+ *
+ * The worker's event loop hands each database bound request to
+ * the executor, so a slow query only holds up its own client.
+ * At most max_queued tasks wait for a thread; submit() refuses
+ * anything past that, so a flood of requests cannot pile up
+ * without bound.
+ */
+class request_executor
+{
+public:
+  typedef std::function<void()> task;
+
+  explicit request_executor(
+    const int & _threads = QThread::idealThreadCount(),
+    const int & _max_queued = 1024,
+    const task & _thread_init = task());
+  virtual ~request_executor();
+
+  bool submit(const task & _task);
+  void stop();
+
+  int thread_count() const {return m_threads.size();}
+  int queued();
+
+private:
+  /* runs the executor's work loop */
+  class executor_thread : public QThread
+  {
+  public:
+    explicit executor_thread(request_executor * _p_executor)
+    : m_p_executor(_p_executor)
+    { /* started by the executor */}
+
+  protected:
+    void run() override {m_p_executor->work();}
+
+  private:
+    request_executor * m_p_executor;
+  };
+
+  void work();
+
+  QMutex * m_p_mutex;
+  QWaitCondition * m_p_ready;
+  QQueue<task> m_tasks;
+  QList<executor_thread *> m_threads;
+  task m_thread_init;
+  int m_max_queued;
+  bool m_stopping = false;
+};
+#endif
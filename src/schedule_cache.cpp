@@ -0,0 +1,263 @@
+// Copyright 2017 Hunter L. Allen
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "schedule_cache.hpp"
+
+#include <algorithm>
+
+/* orders items by date, the only key ranges are asked by */
+static bool before_day(const schedule_cache::item & _item, const QDate & _date)
+{
+  return _item.date < _date;
+}
+
+static bool after_day(const QDate & _date, const schedule_cache::item & _item)
+{
+  return _date < _item.date;
+}
+
+/**
+ * @brief Construct a schedule_cache.
+ *
+ * @param _budget Most bytes (roughly) spent on events.
+ * @param _ttl Time (in ms) a schedule is trusted for.
+ */
+schedule_cache::schedule_cache(const int & _budget, const qint64 & _ttl)
+: m_p_mutex(new QMutex()),
+  m_schedules(_budget),
+  m_ttl(_ttl)
+{ /* schedules are loaded as they are asked about */}
+
+schedule_cache::~schedule_cache()
+{
+  delete m_p_mutex;
+}
+
+/**
+ * @brief Get the events of a schedule between two days.
+ *
+ * @param _owner Owner of the schedule.
+ * @param _from First day wanted.
+ * @param _until Last day wanted; if null, every day from _from on.
+ * @param _items Filled with the events, in order.
+ * @return False if the schedule is not cached; ask the database.
+ */
+bool schedule_cache::range(
+  const QString & _owner,
+  const QDate & _from,
+  const QDate & _until,
+  items & _items)
+{
+  m_p_mutex->lock();
+  schedule * p = lookup(key(_owner));
+  bool hit = p != NULL && p->complete;
+  if (hit) {select(p->events, _from, _until, _items);}
+  m_p_mutex->unlock();
+  (hit) ? m_hits.ref() : m_misses.ref();
+  return hit;
+}
+
+/**
+ * @brief Get the days of a month that have events on them.
+ *
+ * @param _owner Owner of the schedule.
+ * @param _year The year.
+ * @param _month The month (1-12).
+ * @param _days Set to the busy days, bit d standing for day d.
+ * @return False if the month is not cached; ask the database.
+ */
+bool schedule_cache::month(const QString & _owner, const int & _year, const int & _month, quint32 & _days)
+{
+  int month = month_key(_year, _month);
+  m_p_mutex->lock();
+  schedule * p = lookup(key(_owner));
+  bool hit = p != NULL && (p->complete || p->months.contains(month));
+  if (hit) {_days = p->months.value(month, 0);}
+  m_p_mutex->unlock();
+  (hit) ? m_hits.ref() : m_misses.ref();
+  return hit;
+}
+
+/**
+ * @brief Remember a schedule, as just loaded.
+ *
+ * @param _owner Owner of the schedule.
+ * @param _items Every event on it, sorted by date and start time.
+ * @param _generation generation() from before the schedule was loaded.
+ */
+void schedule_cache::insert(const QString & _owner, const items & _items, const quint64 & _generation)
+{
+  schedule * p = new schedule{_items, QHash<int, quint32>(),
+    QDateTime::currentMSecsSinceEpoch() + m_ttl, true};
+  for (const item & i : _items) {
+    p->months[month_key(i.date.year(), i.date.month())] |= 1u << i.date.day();
+  }
+  m_p_mutex->lock();
+  /* QCache deletes it at once if it is over budget */
+  if (_generation == m_generation.load()) {m_schedules.insert(key(_owner), p, cost(p));} else {delete p;}
+  m_p_mutex->unlock();
+}
+
+/**
+ * @brief Remember the busy days of one month, as just read.
+ *
+ * Kept alongside the other months known for the owner, unless
+ * the whole schedule is cached already.
+ *
+ * @param _owner Owner of the schedule.
+ * @param _year The year.
+ * @param _month The month (1-12).
+ * @param _days The busy days, bit d standing for day d.
+ * @param _generation generation() from before the month was read.
+ */
+void schedule_cache::insert_month(
+  const QString & _owner,
+  const int & _year,
+  const int & _month,
+  const quint32 & _days,
+  const quint64 & _generation)
+{
+  QString owner = key(_owner);
+  m_p_mutex->lock();
+  schedule * p = lookup(owner);
+  if (_generation == m_generation.load() && (p == NULL || !p->complete)) {
+    schedule * p_months = (p != NULL) ? new schedule(*p) : new schedule{items(),
+      QHash<int, quint32>(), QDateTime::currentMSecsSinceEpoch() + m_ttl, false};
+    p_months->months.insert(month_key(_year, _month), _days);
+    m_schedules.insert(owner, p_months, cost(p_months));
+  }
+  m_p_mutex->unlock();
+}
+
+/**
+ * @brief Replace one day of a cached schedule, after an event was added to it.
+ *
+ * Does nothing if the schedule is not cached. If the schedule
+ * changed since _generation, it is forgotten instead, since we
+ * can not tell which of the two is newer.
+ *
+ * @param _owner Owner of the schedule.
+ * @param _day The day.
+ * @param _items Every event on that day, sorted by start time.
+ * @param _generation generation() from before the day was loaded.
+ */
+void schedule_cache::update_day(
+  const QString & _owner,
+  const QDate & _day,
+  const items & _items,
+  const quint64 & _generation)
+{
+  QString owner = key(_owner);
+  m_p_mutex->lock();
+  schedule * p = m_schedules.object(owner);
+  if (p == NULL) {
+    m_generation.ref();
+  } else if (_generation != m_generation.fetchAndAddOrdered(1)) {
+    m_schedules.remove(owner);
+  } else {
+    if (p->complete) {
+      items & events = p->events;
+      items::iterator first = std::lower_bound(events.begin(), events.end(), _day, before_day);
+      items::iterator last = std::upper_bound(first, events.end(), _day, after_day);
+      int at = first - events.begin();
+      events.erase(first, last);
+      for (int x = 0; x < _items.size(); ++x) {events.insert(at + x, _items[x]);}
+    }
+    /* a partial entry only follows the months it has */
+    int month = month_key(_day.year(), _day.month());
+    if (p->complete || p->months.contains(month)) {
+      quint32 & days = p->months[month];
+      days = _items.isEmpty() ? (days & ~(1u << _day.day())) : (days | (1u << _day.day()));
+    }
+    /* re-insert, so the new cost counts against the budget */
+    schedule * p_copy = new schedule(*p);
+    m_schedules.insert(owner, p_copy, cost(p_copy));
+  }
+  m_p_mutex->unlock();
+}
+
+/**
+ * @brief Forget a schedule, because it changed.
+ *
+ * @param _owner Owner of the schedule.
+ */
+void schedule_cache::invalidate(const QString & _owner)
+{
+  m_p_mutex->lock();
+  m_generation.ref();
+  m_schedules.remove(key(_owner));
+  m_p_mutex->unlock();
+}
+
+/**
+ * @brief Count the remembered schedules.
+ */
+int schedule_cache::size()
+{
+  m_p_mutex->lock();
+  int size = m_schedules.size();
+  m_p_mutex->unlock();
+  return size;
+}
+
+/**
+ * @brief Pick the events between two days out of a sorted list.
+ *
+ * @param _all Events, sorted by date.
+ * @param _from First day wanted.
+ * @param _until Last day wanted; if null, every day from _from on.
+ * @param _items The events picked are appended here.
+ */
+void schedule_cache::select(
+  const items & _all,
+  const QDate & _from,
+  const QDate & _until,
+  items & _items)
+{
+  items::const_iterator first = std::lower_bound(_all.begin(), _all.end(), _from, before_day);
+  items::const_iterator last = _until.isNull() ? _all.end() :
+    std::upper_bound(first, _all.end(), _until, after_day);
+  for (; first < last; ++first) {_items.append(*first);}
+}
+
+/**
+ * @brief Make the busy day bitmap of a month's events.
+ *
+ * @param _items Events, all in the same month.
+ * @return The bitmap, bit d standing for day d.
+ */
+quint32 schedule_cache::days(const items & _items)
+{
+  quint32 days = 0;
+  for (const item & i : _items) {days |= 1u << i.date.day();}
+  return days;
+}
+
+/* call with m_p_mutex held */
+schedule_cache::schedule * schedule_cache::lookup(const QString & _key)
+{
+  schedule * p = m_schedules.object(_key);
+  if (p != NULL && p->expires <= QDateTime::currentMSecsSinceEpoch()) {
+    m_schedules.remove(_key);
+    p = NULL;
+  }
+  return p;
+}
+
+int schedule_cache::cost(const schedule * _p)
+{
+  int bytes = sizeof(schedule) + _p->months.size() * (sizeof(int) + sizeof(quint32));
+  for (const item & i : _p->events) {bytes += sizeof(item) + i.text.size() * sizeof(QChar);}
+  return bytes;
+}
@@ -0,0 +1,104 @@
+// Copyright 2017 Hunter L. Allen
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __SCHEDULE_CACHE_HPP__
+#define __SCHEDULE_CACHE_HPP__
+#pragma once
+#include <QtCore>
+
+/**
+ * Remembers the events on each schedule.
+ *
+ * A schedule is loaded whole, by its owner (a user or a group;
+ * each owns exactly one schedule), the first time a request needs
+ * it. Its events are kept sorted by date and start time, so a date
+ * range is found by binary search rather than a query.
+ *
+ * The cache holds at most a budget of bytes; the least recently
+ * used schedules go first. A new event is written to the database
+ * and then the day it landed on is reloaded into the cache
+ * (update_day). Anything else that changes a schedule invalidates
+ * it. Entries also expire, so changes made through other workers
+ * show up after the time to live.
+ *
+ * Each schedule also keeps a bitmap per month of the days that
+ * have events on them (bit d for day d), kept up to date along
+ * with the events, so a month view of a cached schedule is a
+ * single hash lookup. A month view of a schedule that is not
+ * cached reads just that month, and keeps its bitmap
+ * (insert_month) without the events; such a partial entry answers
+ * month() for the months it has, but not range(). As with
+ * auth_cache, writers bump generation(), and a load or update
+ * that started before a later change is dropped rather than
+ * applied.
+ *
+ * Safe to use from several threads.
+ */
+class schedule_cache
+{
+public:
+  struct item
+  {
+    QDate date;
+    QTime start;
+    int duration;   /* in minutes */
+    QString text;   /* "<date>:::<start>:::<duration>:::<location>:::<name>" */
+  };
+  typedef QVector<item> items;
+
+  explicit schedule_cache(const int & _budget, const qint64 & _ttl);
+  virtual ~schedule_cache();
+
+  bool range(const QString & _owner, const QDate & _from, const QDate & _until, items & _items);
+  bool month(const QString & _owner, const int & _year, const int & _month, quint32 & _days);
+  void insert(const QString & _owner, const items & _items, const quint64 & _generation);
+  void insert_month(const QString & _owner, const int & _year, const int & _month,
+    const quint32 & _days, const quint64 & _generation);
+  void update_day(const QString & _owner, const QDate & _day, const items & _items,
+    const quint64 & _generation);
+  void invalidate(const QString & _owner);
+
+  quint64 generation() const {return m_generation.load();}
+  static void select(const items & _all, const QDate & _from, const QDate & _until,
+    items & _items);
+  static quint32 days(const items & _items);
+
+  quint64 hits() const {return m_hits.load();}
+  quint64 misses() const {return m_misses.load();}
+  int size();
+
+private:
+  struct schedule
+  {
+    items events;   /* sorted by date, then start */
+    QHash<int, quint32> months;   /* busy days, by month_key() */
+    qint64 expires;
+    bool complete;   /* false if only some months' bitmaps are known */
+  };
+
+  schedule * lookup(const QString & _key);
+
+  /* MySQL matches owners case-insensitively, so we do too */
+  static QString key(const QString & _owner) {return _owner.toCaseFolded();}
+  static int month_key(const int & _year, const int & _month) {return _year * 12 + _month - 1;}
+  static int cost(const schedule * _p);
+
+  QMutex * m_p_mutex;
+  QCache<QString, schedule> m_schedules;   /* guarded by m_p_mutex */
+  qint64 m_ttl;                            /* in ms */
+  QAtomicInteger<quint64> m_generation;
+  QAtomicInteger<quint64> m_hits;
+  QAtomicInteger<quint64> m_misses;
+};
+#endif
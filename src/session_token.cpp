@@ -0,0 +1,179 @@
+// Copyright 2017 Hunter L. Allen
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "session_token.hpp"
+
+const QString session_token::PREFIX = "TOKEN:";
+const int session_token::STAMP_CAPACITY;
+const qint64 session_token::STAMP_TTL;
+
+/**
+ * @brief Construct a session_token.
+ *
+ * @param _secret Key the tokens are signed with.
+ * @param _ttl Seconds a token stays valid.
+ */
+session_token::session_token(const QByteArray & _secret, const qint64 & _ttl)
+: m_secret(_secret),
+  m_ttl(_ttl),
+  m_p_mutex(new QMutex()),
+  m_stamps(STAMP_CAPACITY)
+{ /* stamps are added as tokens are checked */}
+
+session_token::~session_token()
+{
+  delete m_p_mutex;
+}
+
+/**
+ * @brief Issue a token for a user who just logged in.
+ *
+ * @param _user The username.
+ * @param _stamp The user's credential stamp.
+ * @return The token.
+ */
+QString session_token::issue(const QString & _user, const QByteArray & _stamp) const
+{
+  return issue(_user, _stamp, now());
+}
+
+/**
+ * @brief Issue a token as of the given time.
+ *
+ * @param _user The username.
+ * @param _stamp The user's credential stamp.
+ * @param _now Current time, in seconds since the epoch.
+ * @return The token.
+ */
+QString session_token::issue(const QString & _user, const QByteArray & _stamp, const qint64 & _now) const
+{
+  qint64 expiry = _now + m_ttl;
+  return PREFIX + QString::number(expiry) + "." + QString::fromLatin1(mac(_user, expiry, _stamp));
+}
+
+/**
+ * @brief Check a token against the user presenting it.
+ *
+ * @param _user The username.
+ * @param _token The token.
+ * @param _stamp The user's current credential stamp.
+ * @return True if the token was issued to this user, under the
+ *   password they still have, and has not expired.
+ */
+bool session_token::verify(const QString & _user, const QString & _token, const QByteArray & _stamp) const
+{
+  return verify(_user, _token, _stamp, now());
+}
+
+/**
+ * @brief Check a token as of the given time.
+ *
+ * @param _user The username.
+ * @param _token The token.
+ * @param _stamp The user's current credential stamp.
+ * @param _now Current time, in seconds since the epoch.
+ * @return True if the token was issued to this user, under the
+ *   password they still have, and has not expired.
+ */
+bool session_token::verify(
+  const QString & _user, const QString & _token,
+  const QByteArray & _stamp, const qint64 & _now) const
+{
+  if (!is_token(_token)) {return false;}
+  int dot = _token.indexOf('.', PREFIX.size());
+  if (dot < 0) {return false;}
+
+  bool ok = false;
+  qint64 expiry = _token.mid(PREFIX.size(), dot - PREFIX.size()).toLongLong(&ok);
+  if (!ok || expiry <= _now) {return false;}
+
+  QByteArray given = _token.mid(dot + 1).toLatin1();
+  QByteArray expected = mac(_user, expiry, _stamp);
+  if (given.size() != expected.size()) {return false;}
+  /* look at every byte, so the time taken does not give the mac away */
+  char diff = 0;
+  for (int x = 0; x < expected.size(); ++x) {diff |= given[x] ^ expected[x];}
+  return diff == 0;
+}
+
+/**
+ * @brief Look up a user's remembered credential stamp.
+ *
+ * @param _user The username.
+ * @param _stamp Set to the stamp, if it is known.
+ * @return False if the stamp must be read from the database.
+ */
+bool session_token::known_stamp(const QString & _user, QByteArray & _stamp)
+{
+  qint64 now = QDateTime::currentMSecsSinceEpoch();
+  m_p_mutex->lock();
+  stamp_entry * p = m_stamps.object(key(_user));
+  bool hit = p != NULL && p->expires > now;
+  if (hit) {_stamp = p->stamp;} else if (p != NULL) {m_stamps.remove(key(_user));}
+  m_p_mutex->unlock();
+  return hit;
+}
+
+/**
+ * @brief Remember a credential stamp read from the database.
+ *
+ * @param _user The username.
+ * @param _stamp The stamp.
+ * @param _generation generation() from before the database was asked.
+ */
+void session_token::remember_stamp(const QString & _user, const QByteArray & _stamp, const quint64 & _generation)
+{
+  stamp_entry * p = new stamp_entry{_stamp, QDateTime::currentMSecsSinceEpoch() + STAMP_TTL};
+  m_p_mutex->lock();
+  if (_generation == m_generation.load()) {m_stamps.insert(key(_user), p);} else {delete p;}
+  m_p_mutex->unlock();
+}
+
+/**
+ * @brief Forget a user's stamp, because their password changed.
+ *
+ * Their old tokens stop working once the new stamp is read.
+ *
+ * @param _user The username.
+ */
+void session_token::revoke(const QString & _user)
+{
+  m_p_mutex->lock();
+  m_generation.ref();
+  m_stamps.remove(key(_user));
+  m_p_mutex->unlock();
+}
+
+/**
+ * @brief Work out the credential stamp of a stored password.
+ *
+ * @param _stored_password The password as the users table has it.
+ * @return The stamp.
+ */
+QByteArray session_token::stamp(const QString & _stored_password)
+{
+  /* enough to tell passwords apart, without keeping them around */
+  return QCryptographicHash::hash(_stored_password.toUtf8(), QCryptographicHash::Sha256).left(8);
+}
+
+QByteArray session_token::mac(const QString & _user, const qint64 & _expiry, const QByteArray & _stamp) const
+{
+  QMessageAuthenticationCode code(QCryptographicHash::Sha256, m_secret);
+  code.addData(key(_user).toUtf8());
+  code.addData("\n", 1);
+  code.addData(QByteArray::number(_expiry));
+  code.addData("\n", 1);
+  code.addData(_stamp);
+  return code.result().toHex();
+}
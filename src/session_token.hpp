@@ -0,0 +1,87 @@
+// Copyright 2017 Hunter L. Allen
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __SESSION_TOKEN_HPP__
+#define __SESSION_TOKEN_HPP__
+#pragma once
+#include <QtCore>
+
+/**
+ * Issues and checks signed, expiring session tokens.
+ *
+ * A token looks like "TOKEN:<expiry>.<mac>", where expiry is in
+ * seconds since the epoch and mac is the hex HMAC-SHA256 of the
+ * username, expiry and the user's credential stamp under a secret.
+ * A client that logged in may send its token in place of its
+ * password. Workers that share the secret accept each other's
+ * tokens.
+ *
+ * The stamp is a few bytes of a hash of the stored password, so
+ * changing the password revokes every token issued before. The
+ * stamps themselves are remembered for a short while, so a token
+ * is usually checked without asking the database; revoke() must
+ * be called when a password changes. A stamp read from the
+ * database is only remembered if the generation() taken before
+ * the read is still current.
+ */
+class session_token
+{
+public:
+  explicit session_token(const QByteArray & _secret, const qint64 & _ttl);
+  virtual ~session_token();
+
+  QString issue(const QString & _user, const QByteArray & _stamp) const;
+  QString issue(const QString & _user, const QByteArray & _stamp, const qint64 & _now) const;
+  bool verify(const QString & _user, const QString & _token, const QByteArray & _stamp) const;
+  bool verify(
+    const QString & _user, const QString & _token,
+    const QByteArray & _stamp, const qint64 & _now) const;
+
+  bool known_stamp(const QString & _user, QByteArray & _stamp);
+  void remember_stamp(const QString & _user, const QByteArray & _stamp, const quint64 & _generation);
+  void revoke(const QString & _user);
+  quint64 generation() const {return m_generation.load();}
+
+  qint64 ttl() const {return m_ttl;}
+  void set_ttl(const qint64 & _ttl) {m_ttl = _ttl;}
+
+  static bool is_token(const QString & _text) {return _text.startsWith(PREFIX);}
+  static qint64 now() {return QDateTime::currentMSecsSinceEpoch() / 1000;}
+  static QByteArray stamp(const QString & _stored_password);
+
+  /* users whose stamps are remembered at once */
+  static const int STAMP_CAPACITY = 10000;
+  /* time (in ms) a stamp is trusted for; changes on other workers show up after this */
+  static const qint64 STAMP_TTL = 60000;
+
+private:
+  struct stamp_entry
+  {
+    QByteArray stamp;
+    qint64 expires;
+  };
+
+  QByteArray mac(const QString & _user, const qint64 & _expiry, const QByteArray & _stamp) const;
+  /* MySQL matches user names case-insensitively, so we do too */
+  static QString key(const QString & _user) {return _user.toCaseFolded();}
+
+  static const QString PREFIX;
+
+  QByteArray m_secret;
+  qint64 m_ttl;
+  QMutex * m_p_mutex;
+  QCache<QString, stamp_entry> m_stamps;   /* guarded by m_p_mutex */
+  QAtomicInteger<quint64> m_generation;
+};
+#endif
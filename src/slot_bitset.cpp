@@ -0,0 +1,257 @@
+// Copyright 2017 Hunter L. Allen
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "slot_bitset.hpp"
+
+#if defined(__GNUC__) && defined(__SSE2__) && (defined(__x86_64__) || defined(__i386__))
+/* the AVX2 kernel is built alongside SSE2 and picked at run time */
+#include <immintrin.h>
+#define SLOT_BITSET_SSE2
+#define SLOT_BITSET_AVX2
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SLOT_BITSET_SSE2
+#endif
+
+/* the word operations the kernels are built from */
+struct or_op
+{
+  static quint64 word(const quint64 & _a, const quint64 & _b) {return _a | _b;}
+#if defined(SLOT_BITSET_SSE2)
+  static __m128i sse2(const __m128i & _a, const __m128i & _b) {return _mm_or_si128(_a, _b);}
+#endif
+#if defined(SLOT_BITSET_AVX2)
+  __attribute__((target("avx2")))
+  static __m256i avx2(const __m256i & _a, const __m256i & _b) {return _mm256_or_si256(_a, _b);}
+#endif
+};
+
+struct and_op
+{
+  static quint64 word(const quint64 & _a, const quint64 & _b) {return _a & _b;}
+#if defined(SLOT_BITSET_SSE2)
+  static __m128i sse2(const __m128i & _a, const __m128i & _b) {return _mm_and_si128(_a, _b);}
+#endif
+#if defined(SLOT_BITSET_AVX2)
+  __attribute__((target("avx2")))
+  static __m256i avx2(const __m256i & _a, const __m256i & _b) {return _mm256_and_si256(_a, _b);}
+#endif
+};
+
+struct xor_op
+{
+  static quint64 word(const quint64 & _a, const quint64 & _b) {return _a ^ _b;}
+#if defined(SLOT_BITSET_SSE2)
+  static __m128i sse2(const __m128i & _a, const __m128i & _b) {return _mm_xor_si128(_a, _b);}
+#endif
+#if defined(SLOT_BITSET_AVX2)
+  __attribute__((target("avx2")))
+  static __m256i avx2(const __m256i & _a, const __m256i & _b) {return _mm256_xor_si256(_a, _b);}
+#endif
+};
+
+#if defined(SLOT_BITSET_AVX2)
+static bool has_avx2()
+{
+  static const bool avx2 = (__builtin_cpu_init(), __builtin_cpu_supports("avx2"));
+  return avx2;
+}
+
+/* combine four words at a time; returns how many words were done */
+template <class op>
+__attribute__((target("avx2")))
+static int combine_avx2(quint64 * _p_dst, const quint64 * _p_src, const int & _count)
+{
+  int x = 0;
+  for (; x + 4 <= _count; x += 4) {
+    __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(_p_dst + x));
+    __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(_p_src + x));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(_p_dst + x), op::avx2(a, b));
+  }
+  return x;
+}
+#endif
+
+/* _p_dst[x] = op(_p_dst[x], _p_src[x]), as wide as the CPU allows */
+template <class op>
+static void combine(quint64 * _p_dst, const quint64 * _p_src, const int & _count)
+{
+  int x = 0;
+#if defined(SLOT_BITSET_AVX2)
+  if (has_avx2()) {x = combine_avx2<op>(_p_dst, _p_src, _count);}
+#endif
+#if defined(SLOT_BITSET_SSE2)
+  for (; x + 2 <= _count; x += 2) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(_p_dst + x));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(_p_src + x));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(_p_dst + x), op::sse2(a, b));
+  }
+#endif
+  for (; x < _count; ++x) {_p_dst[x] = op::word(_p_dst[x], _p_src[x]);}
+}
+
+/**
+ * @brief Construct a slot_bitset, all clear.
+ *
+ * @param _size Number of bits.
+ */
+slot_bitset::slot_bitset(const int & _size)
+: m_size(_size),
+  m_words((_size + 63) / 64, 0)
+{ /* nothing else to set up */}
+
+slot_bitset::~slot_bitset()
+{ /* nothing to free */}
+
+/**
+ * @brief Set a run of bits.
+ *
+ * @param _first First bit to set; clamped to the row.
+ * @param _last One past the last bit to set; clamped to the row.
+ */
+void slot_bitset::set_range(const int & _first, const int & _last)
+{
+  int first = qMax(_first, 0), last = qMin(_last, m_size);
+  if (first >= last) {return;}
+  quint64 * p_words = m_words.data();
+  int w1 = first >> 6, w2 = (last - 1) >> 6;
+  quint64 head = ~quint64(0) << (first & 63);
+  quint64 tail = ~quint64(0) >> (63 - ((last - 1) & 63));
+  if (w1 == w2) {p_words[w1] |= head & tail; return;}
+  p_words[w1] |= head;
+  for (int w = w1 + 1; w < w2; ++w) {p_words[w] = ~quint64(0);}
+  p_words[w2] |= tail;
+}
+
+/**
+ * @brief Set every bit set in another row of the same size.
+ */
+void slot_bitset::or_with(const slot_bitset & _other)
+{
+  Q_ASSERT(_other.m_size == m_size);
+  combine<or_op>(m_words.data(), _other.m_words.constData(), m_words.size());
+}
+
+/**
+ * @brief Clear every bit clear in another row of the same size.
+ */
+void slot_bitset::and_with(const slot_bitset & _other)
+{
+  Q_ASSERT(_other.m_size == m_size);
+  combine<and_op>(m_words.data(), _other.m_words.constData(), m_words.size());
+}
+
+/**
+ * @brief Flip every bit set in another row of the same size.
+ */
+void slot_bitset::xor_with(const slot_bitset & _other)
+{
+  Q_ASSERT(_other.m_size == m_size);
+  combine<xor_op>(m_words.data(), _other.m_words.constData(), m_words.size());
+}
+
+/**
+ * @brief Set each bit that has a set bit close after it.
+ *
+ * Afterwards bit i is set if any of bits i to i + _width - 1
+ * were: a row of busy slots becomes the row of starts that an
+ * event _width slots long would collide at. Takes about
+ * log2(_width) passes.
+ *
+ * @param _width Number of bits each set bit reaches back over.
+ */
+void slot_bitset::spread(const int & _width)
+{
+  for (int covered = 1; covered < _width; ) {
+    int shift = qMin(covered, _width - covered);
+    or_shifted(shift);
+    covered += shift;
+  }
+}
+
+/**
+ * @brief Check whether any bit is set.
+ */
+bool slot_bitset::any() const
+{
+  for (const quint64 & word : m_words) {
+    if (word) {return true;}
+  }
+  return false;
+}
+
+/* set bit i wherever bit i + _shift is set */
+void slot_bitset::or_shifted(const int & _shift)
+{
+  quint64 * p_words = m_words.data();
+  int count = m_words.size(), skip = _shift >> 6, bits = _shift & 63;
+  /* going up, the words read from have not been written yet */
+  for (int w = 0; w + skip < count; ++w) {
+    quint64 moved = p_words[w + skip] >> bits;
+    if (bits && w + skip + 1 < count) {moved |= p_words[w + skip + 1] << (64 - bits);}
+    p_words[w] |= moved;
+  }
+}
+
+/**
+ * @brief Find the first set bit at or after a position.
+ *
+ * @param _from Position to start at.
+ * @return The bit, or size() if there is none.
+ */
+int slot_bitset::next_set(const int & _from) const
+{
+  if (_from >= m_size) {return m_size;}
+  int w = _from >> 6;
+  quint64 word = m_words[w] & (~quint64(0) << (_from & 63));
+  for (;;) {
+    if (word) {return qMin(m_size, (w << 6) + int(qCountTrailingZeroBits(word)));}
+    if (++w == m_words.size()) {return m_size;}
+    word = m_words[w];
+  }
+}
+
+/**
+ * @brief Find the first clear bit at or after a position.
+ *
+ * @param _from Position to start at.
+ * @return The bit, or size() if there is none.
+ */
+int slot_bitset::next_clear(const int & _from) const
+{
+  if (_from >= m_size) {return m_size;}
+  int w = _from >> 6;
+  quint64 word = ~m_words[w] & (~quint64(0) << (_from & 63));
+  for (;;) {
+    /* the bits past the end read as clear, so clamp */
+    if (word) {return qMin(m_size, (w << 6) + int(qCountTrailingZeroBits(word)));}
+    if (++w == m_words.size()) {return m_size;}
+    word = ~m_words[w];
+  }
+}
+
+/**
+ * @brief Name the kernels rows are combined with on this CPU.
+ */
+const char * slot_bitset::kernel()
+{
+#if defined(SLOT_BITSET_AVX2)
+  if (has_avx2()) {return "avx2";}
+#endif
+#if defined(SLOT_BITSET_SSE2)
+  return "sse2";
+#else
+  return "scalar";
+#endif
+}
@@ -0,0 +1,58 @@
+// Copyright 2017 Hunter L. Allen
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __SLOT_BITSET_HPP__
+#define __SLOT_BITSET_HPP__
+#pragma once
+#include <QtCore>
+
+/**
+ * A fixed-size row of bits, one per time slot.
+ *
+ * Whole rows are combined a word at a time. On x86-64 the kernels
+ * handle 256 bits per step when the CPU has AVX2 (checked once at
+ * run time) and 128 with SSE2 otherwise; elsewhere they fall back
+ * to plain 64-bit words. kernel() names the one in use.
+ */
+class slot_bitset
+{
+public:
+  explicit slot_bitset(const int & _size = 0);
+  virtual ~slot_bitset();
+
+  int size() const {return m_size;}
+  bool test(const int & _bit) const
+  {
+    return (m_words[_bit >> 6] >> (_bit & 63)) & 1;
+  }
+  void set_range(const int & _first, const int & _last);
+
+  void or_with(const slot_bitset & _other);
+  void and_with(const slot_bitset & _other);
+  void xor_with(const slot_bitset & _other);
+  void spread(const int & _width);
+  bool any() const;
+
+  int next_set(const int & _from) const;
+  int next_clear(const int & _from) const;
+
+  static const char * kernel();
+
+private:
+  void or_shifted(const int & _shift);
+
+  int m_size;
+  QVector<quint64> m_words;   /* bits past m_size are always clear */
+};
+#endif
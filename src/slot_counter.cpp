@@ -0,0 +1,62 @@
+// Copyright 2017 Hunter L. Allen
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "slot_counter.hpp"
+
+/**
+ * @brief Construct a slot_counter, every count zero.
+ *
+ * @param _size Number of slots.
+ */
+slot_counter::slot_counter(const int & _size)
+: m_size(_size)
+{ /* planes are added as the counts grow */}
+
+slot_counter::~slot_counter()
+{ /* nothing to free */}
+
+/**
+ * @brief Add one to the count of every slot set in a row.
+ *
+ * @param _row Row of the same size as the counter.
+ */
+void slot_counter::add(const slot_bitset & _row)
+{
+  Q_ASSERT(_row.size() == m_size);
+  ++m_rows;
+  slot_bitset carry = _row;
+  for (slot_bitset & plane : m_planes) {
+    if (!carry.any()) {return;}
+    slot_bitset next = plane;
+    next.and_with(carry);
+    plane.xor_with(carry);
+    carry = next;
+  }
+  if (carry.any()) {m_planes.append(carry);}
+}
+
+/**
+ * @brief Get the count of a slot.
+ *
+ * @param _bit The slot.
+ * @return How many of the added rows had it set.
+ */
+int slot_counter::count(const int & _bit) const
+{
+  int total = 0;
+  for (int x = 0; x < m_planes.size(); ++x) {
+    total |= int(m_planes[x].test(_bit)) << x;
+  }
+  return total;
+}
@@ -0,0 +1,45 @@
+// Copyright 2017 Hunter L. Allen
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __SLOT_COUNTER_HPP__
+#define __SLOT_COUNTER_HPP__
+#pragma once
+#include <QtCore>
+
+#include "slot_bitset.hpp"
+
+/**
+ * Counts, for every slot, how many rows had it set.
+ *
+ * The counts are kept bit-sliced: plane i holds bit i of every
+ * slot's count, so adding a row is a ripple-carry add done with
+ * slot_bitset's word kernels, a whole row of slots per step.
+ * N rows take about log2(N) planes.
+ */
+class slot_counter
+{
+public:
+  explicit slot_counter(const int & _size);
+  virtual ~slot_counter();
+
+  void add(const slot_bitset & _row);
+  int count(const int & _bit) const;
+  int rows() const {return m_rows;}
+
+private:
+  int m_size;
+  int m_rows = 0;
+  QVector<slot_bitset> m_planes;   /* bit i of every count in plane i */
+};
+#endif
@@ -0,0 +1,126 @@
+// Copyright 2017 Hunter L. Allen
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "statement_registry.hpp"
+
+#include <iostream>
+
+/**
+ * @brief Construct a statement_registry.
+ *
+ * @param _p_definitions SQL of each statement, by name (not ours).
+ */
+statement_registry::statement_registry(const definitions * _p_definitions)
+: m_p_definitions(_p_definitions)
+{ /* statements are prepared once the connection is open */}
+
+statement_registry::~statement_registry()
+{
+  clear();
+}
+
+/**
+ * @brief Prepare every statement on a freshly opened connection.
+ *
+ * Statements prepared on an earlier connection are prepared
+ * again, in place.
+ *
+ * @param _db The open connection.
+ * @return False if a statement failed to prepare.
+ */
+bool statement_registry::prepare_all(const QSqlDatabase & _db)
+{
+  bool ok = true;
+  for (definitions::const_iterator it = m_p_definitions->constBegin();
+    it != m_p_definitions->constEnd(); ++it)
+  {
+    ok = (prepare(it.key(), _db) != NULL) && ok;
+  }
+  return ok;
+}
+
+/**
+ * @brief Get a prepared statement.
+ *
+ * @param _name Name of the statement.
+ * @param _db Connection the statement belongs to.
+ * @return The statement, ready to bind; NULL if the name is
+ *   unknown or the statement does not prepare.
+ */
+QSqlQuery * statement_registry::get(const QByteArray & _name, const QSqlDatabase & _db)
+{
+  QSqlQuery * p_query = m_prepared.value(_name, NULL);
+  if (p_query != NULL && m_ready.contains(_name)) {return p_query;}
+  /* prepare_all failed on it, or it was defined late */
+  return prepare(_name, _db);
+}
+
+/**
+ * @brief Execute a prepared statement with its bound values.
+ *
+ * @param _p_query Statement from get().
+ * @return True if it executed.
+ */
+bool statement_registry::exec(QSqlQuery * _p_query)
+{
+  m_executes.ref();
+  return _p_query->exec();
+}
+
+/**
+ * @brief Let go of the connection, before it is closed.
+ *
+ * The statements are kept, unprepared, until prepare_all()
+ * or get() prepares them on the new connection.
+ */
+void statement_registry::release()
+{
+  for (QSqlQuery * p_query : m_prepared) {*p_query = QSqlQuery();}
+  m_ready.clear();
+}
+
+/**
+ * @brief Throw away the prepared statements.
+ */
+void statement_registry::clear()
+{
+  qDeleteAll(m_prepared);
+  m_prepared.clear();
+  m_ready.clear();
+}
+
+QSqlQuery * statement_registry::prepare(const QByteArray & _name, const QSqlDatabase & _db)
+{
+  definitions::const_iterator it = m_p_definitions->constFind(_name);
+  if (it == m_p_definitions->constEnd()) {
+    std::cerr << "unknown statement \"" << _name.constData() << "\"" << std::endl;
+    return NULL;
+  }
+  m_prepares.ref();
+  QSqlQuery * p_query = m_prepared.value(_name, NULL);
+  if (p_query == NULL) {
+    p_query = new QSqlQuery(_db);
+    m_prepared.insert(_name, p_query);
+  } else {
+    *p_query = QSqlQuery(_db);
+  }
+  if (!p_query->prepare(it.value())) {
+    std::cerr << "failed to prepare \"" << _name.constData() << "\": " <<
+      p_query->lastError().text().toStdString() << std::endl;
+    m_ready.remove(_name);
+    return NULL;
+  }
+  m_ready.insert(_name);
+  return p_query;
+}
@@ -0,0 +1,61 @@
+// Copyright 2017 Hunter L. Allen
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __STATEMENT_REGISTRY_HPP__
+#define __STATEMENT_REGISTRY_HPP__
+#pragma once
+#include <QtCore>
+#include <QtSql>
+
+/**
+ * The prepared statements of one database connection.
+ *
+ * Statements are defined once by name, with positional
+ * placeholders, and prepared on the connection when it opens.
+ * Callers bind values by position and execute, so the server
+ * parses each statement once per connection rather than once
+ * per request. Prepares and executes are counted to show the
+ * statements really are reused.
+ *
+ * A statement keeps its address for the life of the registry:
+ * after a reconnect it is prepared again in place, so a caller
+ * holding one can still read it.
+ */
+class statement_registry
+{
+public:
+  typedef QHash<QByteArray, QString> definitions;
+
+  explicit statement_registry(const definitions * _p_definitions);
+  virtual ~statement_registry();
+
+  bool prepare_all(const QSqlDatabase & _db);
+  QSqlQuery * get(const QByteArray & _name, const QSqlDatabase & _db);
+  bool exec(QSqlQuery * _p_query);
+  void release();
+  void clear();
+
+  quint64 prepares() const {return m_prepares.load();}
+  quint64 executes() const {return m_executes.load();}
+
+private:
+  QSqlQuery * prepare(const QByteArray & _name, const QSqlDatabase & _db);
+
+  const definitions * m_p_definitions;
+  QHash<QByteArray, QSqlQuery *> m_prepared;
+  QSet<QByteArray> m_ready;   /* prepared on the open connection */
+  QAtomicInteger<quint64> m_prepares;
+  QAtomicInteger<quint64> m_executes;
+};
+#endif
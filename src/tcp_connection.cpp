@@ -14,6 +14,9 @@
 
 #include "tcp_connection.hpp"
 
+/* ids are never reused */
+static QAtomicInteger<quint64> next_id(1);
+
 /**
  * @brief Construct a tcp_connection.
  *
@@ -29,9 +32,11 @@ tcp_connection::tcp_connection(
   QString & _hostname,
   QTcpSocket * _p_socket,
   QObject * _p_parent)
-: m_hostname(_hostname),
+: QObject(_p_parent),
+  m_id(next_id.fetchAndAddRelaxed(1)),
+  m_hostname(_hostname),
   m_p_socket(_p_socket),
-  QObject(_p_parent)
+  m_state(QUEUED)
 { /* Construct a tcp_connection object. */}
 
 /**
@@ -21,11 +21,24 @@
 
 #include <iostream>
 
+/**
+ * A connection queued at the master.
+ *
+ * Each connection gets an id that stays the same for its whole
+ * life, so connections can be compared without asking the socket
+ * for its peer (which it no longer knows once it has hung up).
+ *
+ * A connection starts out QUEUED. The pairing thread claims it
+ * (QUEUED -> PAIRED) before handing it out, and the tcp thread
+ * marks it DROPPED when its socket goes away.
+ */
 class tcp_connection : public QObject
 {
   Q_OBJECT
 
 public:
+  enum state {QUEUED, PAIRED, DROPPED};
+
   explicit tcp_connection(
     QString & _hostname,
     QTcpSocket * _p_socket,
@@ -33,20 +46,24 @@ public:
   );
   virtual ~tcp_connection();
 
-  bool operator==(const tcp_connection & tcp1)
-  {
-    /* compare the socket */
-    return (tcp1.m_p_socket->peerName() == m_p_socket->peerName()) &&
-           (tcp1.m_p_socket->peerPort() == m_p_socket->peerPort());
-  }
+  bool operator==(const tcp_connection & tcp1) {return tcp1.m_id == m_id;}
 
   Q_SLOT void disconnect();       /* @todo replace disconnect with a lambda */
 
+  /* false if the connection was dropped before it could be claimed */
+  bool claim() {return m_state.testAndSetOrdered(QUEUED, PAIRED);}
+  /* set (from the tcp thread) once the socket has gone away */
+  void mark_dropped() {m_state.storeRelease(DROPPED);}
+  bool is_dropped() const {return m_state.loadAcquire() == DROPPED;}
+
+  quint64 get_id() const {return m_id;}
   const QString & get_hostname() {return m_hostname;}
   const QTcpSocket * get_socket() {return m_p_socket;}
 
 private:
+  quint64 m_id;
   QString m_hostname;
   QTcpSocket * m_p_socket;
+  QAtomicInt m_state;
 };
 #endif
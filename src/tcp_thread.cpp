@@ -40,6 +40,16 @@ bool tcp_thread::init()
   /* forward accepted connections to our accept connection */
   connect(m_pServer, &QTcpServer::newConnection, this, &tcp_thread::acceptConnection);
 
+  if (!m_master_mode) {
+    /* session commands are handled here, everything else by the worker */
+    register_command("BEGIN_SESSION",
+      [this](QString * _p_text, QTcpSocket * _p_socket) {begin_session(_p_text, _p_socket);});
+    register_command("END_SESSION",
+      [this](QString * _p_text, QTcpSocket * _p_socket) {end_session(_p_text, _p_socket);});
+    register_command("FRAMING",
+      [this](QString * _p_text, QTcpSocket * _p_socket) {set_framing(_p_text, _p_socket);});
+  }
+
   /* listen for any host on our port */
   if (m_pServer->listen(QHostAddress::Any, m_port)) {
     QString ipAddress = QHostAddress(QHostAddress::LocalHost).toString();
@@ -67,13 +77,25 @@ bool tcp_thread::writeData(QByteArray data, tcp_connection * receiver)
 void tcp_thread::disconnected()
 {
   QTcpSocket * quitter = qobject_cast<QTcpSocket *>(sender());
-  /* convert to tcp_connection */
-  QString _host = quitter->peerName();
-  delete m_p_timer;
   if (m_master_mode) {
-    tcp_connection * to_dequeue = new tcp_connection(_host, quitter);
-    Q_EMIT (dropped_connection(to_dequeue));
-  } else {Q_EMIT (dropped_client());}
+    /* whoever holds the connection now throws it away */
+    tcp_connection * p_dropped = m_connections.take(quitter);
+    if (p_dropped != NULL) {p_dropped->mark_dropped();}
+  } else {
+    client_session * p_session = m_sessions.take(quitter);
+    if (p_session != NULL) {
+      /* a running request still needs the socket; it is freed when that finishes */
+      if (p_session->is_busy()) {
+        m_closing.insert(quitter);
+      } else {
+        quitter->deleteLater();
+      }
+      p_session->deleteLater();
+      Q_EMIT (dropped_client());
+    } else {
+      quitter->deleteLater();
+    }
+  }
   std::cout << "Client " <<
     QHostAddress(quitter->peerAddress().toIPv4Address()).toString().toStdString();
   std::cout << ":" << quitter->peerPort();
@@ -82,20 +104,20 @@ void tcp_thread::disconnected()
 
 void tcp_thread::acceptConnection()
 {
-  QTcpSocket * client = m_pServer->nextPendingConnection();
+  QTcpSocket * client;
 
-  if (client) {
+  /* take everyone who is waiting, not just the first */
+  while ((client = m_pServer->nextPendingConnection()) != NULL) {
     if (!m_master_mode) {
-      currentSocket = client; m_p_timer = new QTimer();
-      connect(m_p_timer, &QTimer::timeout, this, &tcp_thread::timeout_disconnect);
-      m_p_timer->start(30000);                   /* 10 second timeout */
-      // std::cerr<<"starting timer thread..."<<std::endl;
-      // connect(t, &tcp_timer::timeout, this, &tcp_thread::timeout_disconnect,
-      //                Qt::DirectConnection);
-      // if (!t->init()) std::cerr<<"WARNING: failed to construct timeout thread!"<<std::endl;
+      /* track the client, and hang up if it idles */
+      client_session * p_session = new client_session(client, m_idle_timeout);
+      connect(p_session, &client_session::timed_out, this, &tcp_thread::timeout_disconnect);
+      m_sessions.insert(client, p_session);
+      Q_EMIT (accepted_client());
     }
 
-    connect(client, &QAbstractSocket::disconnected, client, &QObject::deleteLater);
+    /* a worker's sockets are freed in disconnected() */
+    if (m_master_mode) {connect(client, &QAbstractSocket::disconnected, client, &QObject::deleteLater);}
     connect(client, &QAbstractSocket::disconnected, this, &tcp_thread::disconnected);
     connect(client, &QIODevice::readyRead, this, &tcp_thread::readFromClient);
   }
@@ -106,12 +128,15 @@ void tcp_thread::echoReceived(QString msg)
   std::cout << "I read \"" << msg.toStdString() << "\" from the client!" << std::endl;
 }
 
-void tcp_thread::timeout_disconnect()
+void tcp_thread::timeout_disconnect(client_session * _p_session)
 {
   std::cout << "Ok... Bye?" << std::endl;
+  QTcpSocket * p_socket = _p_session->get_socket();
+  /* idle sessions are closed regardless of their mode */
+  _p_session->set_persistent(false);
   QString * msg = new QString("ERROR: TIMEOUT\r\n");
-  QString client_host = currentSocket->peerName();
-  disconnect_client(new tcp_connection(client_host, currentSocket), msg);
+  QString client_host = p_socket->peerName();
+  disconnect_client(new tcp_connection(client_host, p_socket), msg);
 }
 
 void tcp_thread::readFromClient()
@@ -119,188 +144,443 @@ void tcp_thread::readFromClient()
   //! Points at the thing that called this member function,
   //! as well as casts it it a QTcpSocket.
   QTcpSocket * pClientSocket = qobject_cast<QTcpSocket *>(sender());
-  QString text;      /* to store the message */
-
-  pClientSocket->waitForBytesWritten(-1);
-  QByteArray bae = pClientSocket->readLine();
-  QString temp = QString(bae);
-  QString hostname = pClientSocket->peerName();
-  text += temp.replace("\r\n", "");
 
   /* this checks if we are a master or a worker */
   if (m_master_mode) {
-    if (text == "REQUEST_CLIENT") {
+    tcp_connection * p_known = m_connections.value(pClientSocket, NULL);
+    if (p_known != NULL) {
+      /* registered workers only ever send load reports */
+      worker_connection * p_worker = qobject_cast<worker_connection *>(p_known);
+      if (p_worker != NULL && p_worker->is_persistent()) {
+        read_load_reports(p_worker, pClientSocket);
+      } else {
+        /* already queued; nothing to say until it is paired */
+        pClientSocket->readAll();
+      }
+      return;
+    }
+    pClientSocket->waitForBytesWritten(-1);
+    QByteArray bae = pClientSocket->readLine();
+    /* strip the line terminator */
+    while (bae.endsWith('\n') || bae.endsWith('\r')) {bae.chop(1);}
+    QString text(bae);      /* to store the message */
+    QString hostname = pClientSocket->peerName();
+    if (text == "REQUEST_CLIENT" || text == "REGISTER_WORKER") {
       /* check for the next line */
       if (!pClientSocket->canReadLine()) {
         std::cerr << "Invalid request" << std::endl;
         pClientSocket->write("BYE\r\n");
         pClientSocket->disconnectFromHost();
+        return;
       }
-      QString worker_host_port = pClientSocket->readLine();
+      /* the location is handed out as is, so no line terminator */
+      QString worker_host_port = QString::fromUtf8(pClientSocket->readLine()).trimmed();
 
       std::cout << "worker connection received." << std::endl;
       try {
         worker_connection * w = new worker_connection(worker_host_port, pClientSocket);
-        m_p_master_node->handle_worker_connect(w);
-        m_tcp_connections.push_back(w);
+        /* newer workers report their load on a third line */
+        if (pClientSocket->canReadLine()) {parse_load(w, pClientSocket->readLine());}
+        /* REGISTER_WORKER keeps the connection open for more pairings */
+        w->set_persistent(text == "REGISTER_WORKER");
+        if (!m_p_master_node->handle_worker_connect(w)) {
+          server_busy(w);
+          return;
+        }
+        m_connections.insert(pClientSocket, w);
+        /* the load report may have come with more behind it */
+        if (w->is_persistent()) {read_load_reports(w, pClientSocket);}
         std::cout << "adding new worker at address " << worker_host_port.toStdString() << std::endl;
       } catch (...) {
         std::cerr << "Exception caught" << std::endl;
       }
 
-    } else if (text == "REQUEST_WORKER") {
+    } else if (text == "REQUEST_WORKER" || text.startsWith("REQUEST_WORKER ")) {
       /* this is a client */
       client_connection * c = new client_connection(hostname, pClientSocket);
+      /* a username lets the master send it to the same worker each time */
+      c->set_username(text.mid(15).trimmed());
 
-      m_p_master_node->handle_client_connect(c);
+      if (!m_p_master_node->handle_client_connect(c)) {
+        server_busy(c);
+        return;
+      }
+      m_connections.insert(pClientSocket, c);
 
       std::cerr << "emmitted client connect" << std::endl;
+    } else if (text == "ROUTING_TABLE") {
+      /* for clients that would rather talk to the workers directly */
+      pClientSocket->write(m_p_master_node->routing_table());
+      pClientSocket->disconnectFromHost();
     } else {
       pClientSocket->write("BYE\r\n");
       pClientSocket->disconnectFromHost();
     }
   } else {
-    m_p_timer->stop();
-    /* check for CREATE_ACCOUNT command */
-    if (text.contains("CREATE_ACCOUNT")) {
-      std::cout << "create account received" << std::endl;
-      /* remove CREATE_ACCOUNT from the string */
-      text.replace("CREATE_ACCOUNT ", "");
-      QString * temp = new QString(text);
-      Q_EMIT (got_create_account(temp, pClientSocket));
-    } else if (text.contains("REQUEST_LOGIN")) {
-      std::cout << "login request received" << std::endl;
-      /* remove the REQUEST_LOGIN from the string */
-      text.replace("REQUEST_LOGIN ", "");
-      QString * temp = new QString(text);
-      Q_EMIT (got_login_request(temp, pClientSocket));
-    } else if (text.contains("CREATE_GROUP_EVENT")) {
-      std::cout << "request create group event received" << std::endl;
-      text.replace("CREATE_GROUP_EVENT ", "");
-      QString * temp = new QString(text);
-      Q_EMIT (got_create_group_event(temp, pClientSocket));
-    } else if (text.contains("CREATE_GROUP")) {
-      std::cout << "create group received" << std::endl;
-      text.replace("CREATE_GROUP ", "");
-      QString * temp = new QString(text);
-      Q_EMIT (got_create_group(temp, pClientSocket));
-    } else if (text.contains("JOIN_GROUP")) {
-      std::cout << "join group received" << std::endl;
-      text.replace("JOIN_GROUP ", "");
-      QString * temp = new QString(text);
-      Q_EMIT (got_join_group(temp, pClientSocket));
-    } else if (text.contains("LEAVE_GROUP")) {
-      std::cout << "leave group received" << std::endl;
-      text.replace("LEAVE_GROUP ", "");
-      QString * temp = new QString(text);
-      Q_EMIT (got_leave_group(temp, pClientSocket));
-    } else if (text.contains("UPDATE_ACCOUNT")) {
-      std::cout << "update user received" << std::endl;
-      text.replace("UPDATE_ACCOUNT ", "");
-      QString * temp = new QString(text);
-      Q_EMIT (got_update_user(temp, pClientSocket));
-    } else if (text.contains("REQUEST_GROUPS")) {
-      std::cout << "update user received" << std::endl;
-      text.replace("REQUEST_GROUPS ", "");
-      QString * temp = new QString(text);
-      Q_EMIT (got_request_groups(temp, pClientSocket));
-    } else if (text.contains("REQUEST_ACCOUNT")) {
-      std::cout << "update user received" << std::endl;
-      text.replace("REQUEST_ACCOUNT ", "");
-      QString * temp = new QString(text);
-      Q_EMIT (got_request_account(temp, pClientSocket));
-    } else if (text.contains("DELETE_GROUP")) {
-      std::cout << "delete group received" << std::endl;
-      text.replace("DELETE_GROUP ", "");
-      QString * temp = new QString(text);
-      Q_EMIT (got_delete_group(temp, pClientSocket));
-    } else if (text.contains("REQUEST_USERS")) {
-      std::cout << "request group users received" << std::endl;
-      text.replace("REQUEST_USERS ", "");
-      QString * temp = new QString(text);
-      Q_EMIT (got_list_group_users(temp, pClientSocket));
-    } else if (text.contains("CREATE_USER_EVENT")) {
-      std::cout << "request create user event received" << std::endl;
-      text.replace("CREATE_USER_EVENT ", "");
-      QString * temp = new QString(text);
-      Q_EMIT (got_create_user_event(temp, pClientSocket));
-    } else if (text.contains("REQUEST_RESET")) {
-      std::cout << "request reset password received" << std::endl;
-      text.replace("REQUEST_RESET ", "");
-      QString * temp = new QString(text);
-      Q_EMIT (got_reset_password(temp, pClientSocket));
-    } else if (text.contains("REQUEST_EVENTS")) {
-      std::cout << "request user events received" << std::endl;
-      text.replace("REQUEST_EVENTS ", "");
-      QString * temp = new QString(text);
-      Q_EMIT (got_request_events(temp, pClientSocket));
-    } else if (text.contains("REQUEST_GROUP_EVENTS")) {
-      std::cout << "request group events received" << std::endl;
-      text.replace("REQUEST_GROUP_EVENTS ", "");
-      QString * temp = new QString(text);
-      Q_EMIT (got_request_group_events(temp, pClientSocket));
-    } else if (text.contains("REQUEST_PERSONAL_MONTH_EVENTS")) {
-      std::cout << "request personal month events received" << std::endl;
-      text.replace("REQUEST_PERSONAL_MONTH_EVENTS ", "");
-      QString * temp = new QString(text);
-      Q_EMIT (got_request_month_events(temp, pClientSocket));
-    } else if (text.contains("REQUEST_GROUP_MONTH_EVENTS")) {
-      std::cout << "request group month events received" << std::endl;
-      text.replace("REQUEST_GROUP_MONTH_EVENTS ", "");
-      QString * temp = new QString(text);
-      Q_EMIT (got_request_group_month_events(temp, pClientSocket));
-    } else if (text.contains("CREATE_FRIENDSHIP")) {
-      std::cout << "request create friendship" << std::endl;
-      text.replace("CREATE_FRIENDSHIP ", "");
-      QString * temp = new QString(text);
-      Q_EMIT (got_create_friendship(temp, pClientSocket));
-    } else if (text.contains("ACCEPT_FRIEND")) {
-      std::cout << "request accept friend" << std::endl;
-      text.replace("ACCEPT_FRIEND ", "");
-      QString * temp = new QString(text);
-      Q_EMIT (got_accept_friend(temp, pClientSocket));
-    } else if (text.contains("REQUEST_FRIENDS")) {
-      std::cout << "request friends" << std::endl;
-      text.replace("REQUEST_FRIENDS ", "");
-      QString * temp = new QString(text);
-      Q_EMIT (got_request_friends(temp, pClientSocket));
-    } else if (text.contains("DELETE_FRIEND")) {
-      std::cout << "request delete friend" << std::endl;
-      text.replace("DELETE_FRIEND ", "");
-      QString * temp = new QString(text);
-      Q_EMIT (got_delete_friend(temp, pClientSocket));
-    } else if (text.contains("FRIEND_REQUESTS")) {
-      std::cout << "request friend requests" << std::endl;
-      text.replace("FRIEND_REQUESTS ", "");
-      QString * temp = new QString(text);
-      Q_EMIT (got_friend_requests(temp, pClientSocket));
-    } else if (text.contains("ABSENT")) {
-      std::cout << "request friend requests" << std::endl;
-      text.replace("ABSENT ", "");
-      QString * temp = new QString(text);
-      Q_EMIT (got_absent(temp, pClientSocket));
-    } else if (text.contains("PRESENT")) {
-      std::cout << "request friend requests" << std::endl;
-      text.replace("PRESENT ", "");
-      QString * temp = new QString(text);
-      Q_EMIT (got_present(temp, pClientSocket));
-    } else if (text.contains("SUGGEST_TIMES ")) {
-      std::cout << "request time suggestions" << std::endl;
-      text.replace("SUGGEST_TIMES ", "");
-      QString * temp = new QString(text);
-      Q_EMIT (got_suggest_user_time(temp, pClientSocket));
-    } else if (text.contains("REQUEST_TIMES ")) {
-      std::cout << "request group time suggestions" << std::endl;
-      text.replace("REQUEST_TIMES ", "");
-      QString * temp = new QString(text);
-      Q_EMIT (got_suggest_group_times(temp, pClientSocket));
-    } else {
-      std::cout << "client request: \"" << text.toStdString() << "\"" << std::endl;
-      QString * msg = new QString("ERROR: INVALID COMMAND\r\n");
-      QString client_host = pClientSocket->peerName();
-      disconnect_client(new tcp_connection(client_host, pClientSocket), msg);
+    client_session * p_session = m_sessions.value(pClientSocket, NULL);
+    if (p_session == NULL) {return;}
+    serve_requests(pClientSocket, p_session);
+  }
+}
+
+/**
+ * @brief Read the load reports on a worker's control connection.
+ *
+ * @param _p_worker Worker that owns the connection.
+ * @param _p_socket The control connection.
+ */
+void tcp_thread::read_load_reports(worker_connection * _p_worker, QTcpSocket * _p_socket)
+{
+  bool updated = false;
+  while (_p_socket->canReadLine()) {
+    updated = parse_load(_p_worker, _p_socket->readLine()) || updated;
+  }
+  /* there may be room for a client that is waiting */
+  if (updated) {m_p_master_node->handle_worker_load(_p_worker);}
+}
+
+/**
+ * @brief Read a worker's load report.
+ *
+ * The report looks like "LOAD <clients>:::<latency in us>", and
+ * workers with a control connection add ":::<free slots>:::<PAIRED
+ * messages seen>". Anything else leaves the worker looking idle.
+ *
+ * @param _p_worker Worker that sent the report.
+ * @param _line The report line.
+ * @return True if the report was understood.
+ */
+bool tcp_thread::parse_load(worker_connection * _p_worker, QByteArray _line)
+{
+  while (_line.endsWith('\n') || _line.endsWith('\r')) {_line.chop(1);}
+  if (!_line.startsWith("LOAD ")) {return false;}
+  QList<QByteArray> fields = _line.mid(5).split(':');
+  fields.removeAll(QByteArray());
+  if (fields.size() != 2 && fields.size() != 4) {return false;}
+
+  bool ok = true, ok_field;
+  int outstanding = fields[0].toInt(&ok_field); ok = ok && ok_field;
+  qint64 latency = fields[1].toLongLong(&ok_field); ok = ok && ok_field;
+  int free_slots = 1, paired_seen = 0;
+  if (fields.size() == 4) {
+    free_slots = fields[2].toInt(&ok_field); ok = ok && ok_field;
+    paired_seen = fields[3].toInt(&ok_field); ok = ok && ok_field;
+  }
+  if (!ok) {return false;}
+  _p_worker->set_load(outstanding, latency, free_slots, paired_seen);
+  return true;
+}
+
+/**
+ * @brief Fold the time taken by one request into the average.
+ *
+ * This is an EWMA with a weight of 1/8 for the new sample,
+ * the same smoothing TCP uses for round trip times.
+ *
+ * @param _usecs Time taken, in microseconds.
+ */
+void tcp_thread::record_latency(const qint64 & _usecs)
+{
+  qint64 average = m_latency.load(std::memory_order_relaxed);
+  m_latency.store(average + (_usecs - average) / 8, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Turn away a connection the master has no room to queue.
+ *
+ * @param _p_connection Connection to turn away (we delete it).
+ */
+void tcp_thread::server_busy(tcp_connection * _p_connection)
+{
+  QTcpSocket * p = (QTcpSocket *) _p_connection->get_socket();
+  std::cerr << "queue full, turning a connection away" << std::endl;
+  p->write("ERROR: SERVER BUSY\r\n");
+  p->disconnectFromHost();
+  _p_connection->deleteLater();
+}
+
+/**
+ * @brief Serve the requests buffered on a client's socket.
+ *
+ * Every complete request is served, so pipelined requests do not
+ * wait on the client. A request sent to the executor holds up
+ * the ones behind it until it is done (see request_done), so the
+ * replies go out in request order. A partial request is left for
+ * the next read. One-shot clients are hung up on after their first
+ * reply, which ends the loop.
+ *
+ * All clients share this event loop, so after MAX_REQUESTS_PER_TURN
+ * requests the rest are put off until the other clients have had
+ * a turn.
+ *
+ * @param _p_socket Socket of the client.
+ * @param _p_session Session of the client.
+ */
+void tcp_thread::serve_requests(QTcpSocket * _p_socket, client_session * _p_session)
+{
+  for (int served = 0; _p_socket->state() == QAbstractSocket::ConnectedState &&
+    !_p_session->is_busy(); ++served)
+  {
+    if (served == MAX_REQUESTS_PER_TURN) {
+      QPointer<QTcpSocket> p_socket(_p_socket);
+      QTimer::singleShot(0, this, [this, p_socket]() {
+        if (p_socket.isNull()) {return;}
+        client_session * p_session = m_sessions.value(p_socket.data(), NULL);
+        if (p_session != NULL) {serve_requests(p_socket.data(), p_session);}
+      });
+      return;
+    }
+    /* frames may follow the handshake in the same read */
+    bool served_one = _p_session->is_binary() ?
+      read_frame(_p_socket, _p_session) : read_line(_p_socket, _p_session);
+    if (!served_one) {return;}
+  }
+}
+
+/**
+ * @brief Serve one request line, if a whole one is buffered.
+ *
+ * @param _p_socket Socket of the client.
+ * @param _p_session Session of the client.
+ * @return False if there was no complete line.
+ */
+bool tcp_thread::read_line(QTcpSocket * _p_socket, client_session * _p_session)
+{
+  if (!_p_socket->canReadLine()) {return false;}
+  _p_session->stop_timer();
+  QByteArray bae = _p_socket->readLine();
+  /* strip the line terminator */
+  while (bae.endsWith('\n') || bae.endsWith('\r')) {bae.chop(1);}
+  /* look the verb up in the command table */
+  QElapsedTimer timer;
+  timer.start();
+  bool known = m_commands.dispatch(bae, _p_socket);
+  _p_session->set_served(true);
+  if (!known) {
+    std::cout << "client request: \"" << bae.constData() << "\"" << std::endl;
+    invalid_command(_p_socket);
+    return true;
+  }
+  /* requests on the executor are timed there */
+  if (!_p_session->is_busy()) {record_latency(timer.nsecsElapsed() / 1000);}
+  return true;
+}
+
+/**
+ * @brief Serve one binary frame, if a whole one is buffered.
+ *
+ * @param _p_socket Socket of the client.
+ * @param _p_session Session of the client.
+ * @return False if there was no complete frame, or it was malformed.
+ */
+bool tcp_thread::read_frame(QTcpSocket * _p_socket, client_session * _p_session)
+{
+  QByteArray verb;
+  QList<QByteArray> fields;
+  frame_codec::status status = frame_codec::read_request(_p_socket, verb, fields);
+  if (status == frame_codec::INCOMPLETE) {return false;}
+  _p_session->stop_timer();
+  if (status == frame_codec::MALFORMED) {
+    /* we cannot find the next frame boundary, so hang up */
+    std::cerr << "malformed frame" << std::endl;
+    _p_session->set_persistent(false);
+    QString * msg = new QString("ERROR: MALFORMED FRAME\r\n");
+    QString client_host = _p_socket->peerName();
+    disconnect_client(new tcp_connection(client_host, _p_socket), msg);
+    return false;
+  }
+  /* the handlers expect the text protocol's ":::" separated payload,
+     so a field holding the separator would be split in two */
+  for (int x = 0; x < fields.size(); ++x) {
+    if (fields.at(x).contains(":::")) {
+      QString * msg = new QString("ERROR: INVALID REQUEST\r\n");
+      QString client_host = _p_socket->peerName();
+      disconnect_client(new tcp_connection(client_host, _p_socket), msg);
+      return true;
     }
   }
+  QElapsedTimer timer;
+  timer.start();
+  if (!m_commands.dispatch(verb, fields.join(":::"), _p_socket)) {
+    std::cout << "client request: \"" << verb.constData() << "\"" << std::endl;
+    invalid_command(_p_socket);
+    return true;
+  }
+  if (!_p_session->is_busy()) {record_latency(timer.nsecsElapsed() / 1000);}
+  return true;
+}
+
+/**
+ * @brief Tell a client we do not know its command.
+ */
+void tcp_thread::invalid_command(QTcpSocket * _p_socket)
+{
+  QString * msg = new QString("ERROR: INVALID COMMAND\r\n");
+  QString client_host = _p_socket->peerName();
+  disconnect_client(new tcp_connection(client_host, _p_socket), msg);
+}
+
+/**
+ * @brief Write a reply in whatever framing the client asked for.
+ *
+ * @param _p_socket Socket of the client.
+ * @param _reply Reply text, terminated by "\r\n".
+ */
+void tcp_thread::write_reply(QTcpSocket * _p_socket, const QByteArray & _reply)
+{
+  client_session * p_session = m_sessions.value(_p_socket, NULL);
+  if (p_session != NULL && p_session->is_binary()) {
+    _p_socket->write(frame_codec::encode_reply(_reply));
+  } else {
+    _p_socket->write(_reply);
+  }
+}
+
+/**
+ * @brief Register a worker request handler.
+ *
+ * @param _verb Leading token of the request line.
+ * @param _handler Handler; takes ownership of the payload.
+ * @param _blocking True if the handler waits on the database, in
+ *   which case it runs on the executor (if we have one).
+ */
+void tcp_thread::register_command(
+  const QByteArray & _verb,
+  const command_table::handler & _handler,
+  const bool & _blocking)
+{
+  if (!_blocking) {
+    m_commands.register_command(_verb, _handler);
+    return;
+  }
+  m_commands.register_command(_verb,
+    [this, _handler](QString * _p_text, QTcpSocket * _p_socket) {
+      run_blocking(_handler, _p_text, _p_socket);
+    });
+}
+
+/**
+ * @brief Run a blocking handler off our event loop.
+ *
+ * The session is marked busy until the handler is done, and
+ * the socket is kept alive until then even if the client leaves.
+ * The handler's reply reaches disconnect_client() through a
+ * queued signal, ahead of the request_done() call made after it.
+ * request_done() is queued even if the handler throws, so the
+ * session never stays busy.
+ *
+ * @param _handler The handler.
+ * @param _p_text Request payload (the handler deletes it).
+ * @param _p_socket Socket of the client.
+ */
+void tcp_thread::run_blocking(
+  const command_table::handler & _handler,
+  QString * _p_text,
+  QTcpSocket * _p_socket)
+{
+  client_session * p_session = m_sessions.value(_p_socket, NULL);
+  if (m_p_executor == NULL || p_session == NULL) {
+    _handler(_p_text, _p_socket);
+    return;
+  }
+
+  p_session->set_busy(true);
+  bool queued = m_p_executor->submit([this, _handler, _p_text, _p_socket]() {
+      QElapsedTimer timer;
+      timer.start();
+      try {
+        _handler(_p_text, _p_socket);
+      } catch (...) {
+        std::cerr << "request handler threw an exception" << std::endl;
+      }
+      QMetaObject::invokeMethod(this, "request_done", Qt::QueuedConnection,
+        Q_ARG(QTcpSocket *, _p_socket), Q_ARG(qint64, timer.nsecsElapsed() / 1000));
+    });
+  if (!queued) {
+    /* every thread is busy and the queue is full */
+    p_session->set_busy(false);
+    delete _p_text;
+    QString * msg = new QString("ERROR: SERVER BUSY\r\n");
+    QString client_host = _p_socket->peerName();
+    disconnect_client(new tcp_connection(client_host, _p_socket), msg);
+  }
+}
+
+/**
+ * @brief Pick a client back up once its request is done.
+ *
+ * @param _p_socket Socket of the client.
+ * @param _usecs Time the handler took, in microseconds.
+ */
+void tcp_thread::request_done(QTcpSocket * _p_socket, qint64 _usecs)
+{
+  record_latency(_usecs);
+  if (m_closing.remove(_p_socket)) {
+    /* the client left while we were busy */
+    _p_socket->deleteLater();
+    return;
+  }
+  client_session * p_session = m_sessions.value(_p_socket, NULL);
+  if (p_session == NULL) {return;}
+  p_session->set_busy(false);
+  /* serve anything pipelined behind it */
+  serve_requests(_p_socket, p_session);
+}
+
+/**
+ * @brief Handle BEGIN_SESSION.
+ *
+ * Keep this client's socket open after each reply.
+ */
+void tcp_thread::begin_session(QString * _p_text, QTcpSocket * _p_socket)
+{
+  delete _p_text;
+  client_session * p_session = m_sessions.value(_p_socket, NULL);
+  if (p_session == NULL) {return;}
+  std::cout << "session started" << std::endl;
+  p_session->set_persistent(true);
+  write_reply(_p_socket, "OK\r\n");
+  p_session->touch();
+}
+
+/**
+ * @brief Handle END_SESSION.
+ */
+void tcp_thread::end_session(QString * _p_text, QTcpSocket * _p_socket)
+{
+  delete _p_text;
+  client_session * p_session = m_sessions.value(_p_socket, NULL);
+  if (p_session == NULL) {return;}
+  std::cout << "session ended" << std::endl;
+  p_session->set_persistent(false);
+  write_reply(_p_socket, "BYE\r\n");
+  _p_socket->disconnectFromHost();
+}
+
+/**
+ * @brief Handle FRAMING.
+ *
+ * "FRAMING BINARY" switches the client to length-prefixed
+ * frames and a persistent session. The OK is still sent as
+ * text; everything after it is framed. It is only accepted
+ * as the first line of a connection.
+ */
+void tcp_thread::set_framing(QString * _p_text, QTcpSocket * _p_socket)
+{
+  QString mode = *_p_text; delete _p_text;
+  client_session * p_session = m_sessions.value(_p_socket, NULL);
+  if (p_session == NULL) {return;}
+  if (p_session->has_served() || mode != "BINARY") {
+    QString * msg = new QString("ERROR: UNSUPPORTED FRAMING\r\n");
+    QString client_host = _p_socket->peerName();
+    disconnect_client(new tcp_connection(client_host, _p_socket), msg);
+    return;
+  }
+  std::cout << "binary framing started" << std::endl;
+  _p_socket->write("OK\r\n");
+  p_session->set_persistent(true);
+  p_session->set_binary(true);
+  p_session->touch();
 }
 
 void tcp_thread::sendMessage(QString msg, tcp_connection * request)
@@ -310,12 +590,30 @@ void tcp_thread::sendMessage(QString msg, tcp_connection * request)
   }
 }
 
+/**
+ * @brief Tell a paired connection who it was paired with.
+ *
+ * Registered workers stay with the pairing thread. Anything
+ * else is ours from here on, and is freed once it is told.
+ *
+ * @param request The paired connection.
+ */
 void tcp_thread::send_pair_info(tcp_connection * request)
 {
   QTcpSocket * p = (QTcpSocket *) request->get_socket();
   worker_connection * w = dynamic_cast<worker_connection *>(request);
   client_connection * c = dynamic_cast<client_connection *>(request);
 
+  if (w != NULL && w->is_persistent()) {
+    /* a registered worker keeps its connection */
+    if (!w->is_dropped()) {p->write("PAIRED\r\n");}
+    return;
+  }
+  /* the socket may have gone away since it was paired */
+  if (request->is_dropped()) {request->deleteLater(); return;}
+  m_connections.remove(p);
+  request->deleteLater();
+
   if (w != NULL) {
     /* instance of a worker */
     p->write("OK\r\n");
@@ -324,7 +622,8 @@ void tcp_thread::send_pair_info(tcp_connection * request)
     /* instance of a client */
     client_connection * c = dynamic_cast<client_connection *>(request);
 
-    QString paired_host = c->get_paired_hostname() + "\r\n" + '\0';
+    /* exactly one line terminator, whatever the location came with */
+    QString paired_host = c->get_paired_hostname().trimmed() + "\r\n" + '\0';
     p->write(paired_host.toStdString().c_str());
   }
 
@@ -332,9 +631,29 @@ void tcp_thread::send_pair_info(tcp_connection * request)
   p->disconnectFromHost();
 }
 
+/**
+ * @brief Send a reply to a client.
+ *
+ * One-shot clients are disconnected after their
+ * reply; persistent sessions stay open and have
+ * their idle timer restarted.
+ *
+ * @param client Connection to reply on (we delete it).
+ * @param _p_msg Reply text (we delete it).
+ */
 void tcp_thread::disconnect_client(tcp_connection * client, QString * _p_msg)
 {
   QTcpSocket * p = (QTcpSocket *) client->get_socket();
-  p->write(_p_msg->toUtf8()); delete _p_msg;
+  if (m_closing.contains(p)) {
+    /* nobody left to tell */
+    delete _p_msg; delete client;
+    return;
+  }
+  write_reply(p, _p_msg->toUtf8()); delete _p_msg;
+  client_session * p_session = m_sessions.value(p, NULL);
+  if (p_session != NULL && p_session->is_persistent()) {
+    p_session->touch(); delete client;
+    return;
+  }
   p->disconnectFromHost(); delete client;
 }
@@ -16,6 +16,7 @@
 #define __TCP_THREAD_HPP__
 
 #include <iostream>
+#include <atomic>
 
 #include <QDataStream>
 #include <QtNetwork>
@@ -24,6 +25,10 @@
 
 #include "worker_connection.hpp"
 #include "client_connection.hpp"
+#include "client_session.hpp"
+#include "command_table.hpp"
+#include "frame_codec.hpp"
+#include "request_executor.hpp"
 #include "master_node.hpp"
 #include "worker_node.hpp"
 
@@ -53,41 +58,21 @@ public:
   Q_SIGNAL void readIt(QTcpSocket *);
   Q_SIGNAL void receivedMessage();
 
-  Q_SIGNAL void got_create_account(QString *, QTcpSocket *);
-  Q_SIGNAL void got_login_request(QString *, QTcpSocket *);
-  Q_SIGNAL void got_create_group(QString *, QTcpSocket *);
-  Q_SIGNAL void got_join_group(QString *, QTcpSocket *);
-  Q_SIGNAL void got_leave_group(QString *, QTcpSocket *);
-  Q_SIGNAL void got_update_user(QString *, QTcpSocket *);
-  Q_SIGNAL void got_request_groups(QString *, QTcpSocket *);
-  Q_SIGNAL void got_request_account(QString *, QTcpSocket *);
-  Q_SIGNAL void got_delete_group(QString *, QTcpSocket *);
-  Q_SIGNAL void got_list_group_users(QString *, QTcpSocket *);
-  Q_SIGNAL void got_create_user_event(QString *, QTcpSocket *);
-  Q_SIGNAL void got_create_group_event(QString *, QTcpSocket *);
-  Q_SIGNAL void got_reset_password(QString *, QTcpSocket *);
-  Q_SIGNAL void got_request_events(QString *, QTcpSocket *);
-  Q_SIGNAL void got_request_month_events(QString *, QTcpSocket *);
-  Q_SIGNAL void got_request_group_events(QString *, QTcpSocket *);
-  Q_SIGNAL void got_request_group_month_events(QString *, QTcpSocket *);
-  Q_SIGNAL void got_create_friendship(QString *, QTcpSocket *);
-  Q_SIGNAL void got_accept_friend(QString *, QTcpSocket *);
-  Q_SIGNAL void got_request_friends(QString *, QTcpSocket *);
-  Q_SIGNAL void got_delete_friend(QString *, QTcpSocket *);
-  Q_SIGNAL void got_friend_requests(QString *, QTcpSocket *);
-  Q_SIGNAL void got_present(QString *, QTcpSocket *);
-  Q_SIGNAL void got_absent(QString *, QTcpSocket *);
-  Q_SIGNAL void got_suggest_user_time(QString *, QTcpSocket *);
-  Q_SIGNAL void got_suggest_group_times(QString *, QTcpSocket *);
+  void register_command(
+    const QByteArray & _verb, const command_table::handler & _handler,
+    const bool & _blocking = false);
+  Q_SLOT void begin_session(QString * _p_text, QTcpSocket * _p_socket);
+  Q_SLOT void end_session(QString * _p_text, QTcpSocket * _p_socket);
+  Q_SLOT void set_framing(QString * _p_text, QTcpSocket * _p_socket);
 
   Q_SIGNAL void worker_connected(worker_connection * _worker);
   Q_SIGNAL void client_connected(client_connection * _client);
 
-  Q_SIGNAL void dropped_connection(tcp_connection *);
+  Q_SIGNAL void accepted_client();
   Q_SIGNAL void dropped_client();
 
   Q_SLOT void echoReceived(QString);
-  Q_SLOT void timeout_disconnect();
+  Q_SLOT void timeout_disconnect(client_session * _p_session);
 
   int queueDepth()
   {
@@ -117,7 +102,29 @@ public:
 
   const QTcpServer * getServer() {return m_pServer;}
 
+  void set_idle_timeout(const int & _idle_timeout) {m_idle_timeout = _idle_timeout;}
+
+  /* blocking commands run here rather than on our event loop */
+  void set_executor(request_executor * _p_executor) {m_p_executor = _p_executor;}
+
+  /* average time (in us) the worker takes to answer a request */
+  qint64 get_latency() const {return m_latency.load(std::memory_order_relaxed);}
+
 private:
+  void read_load_reports(worker_connection * _p_worker, QTcpSocket * _p_socket);
+  bool parse_load(worker_connection * _p_worker, QByteArray _line);
+  void record_latency(const qint64 & _usecs);
+  void server_busy(tcp_connection * _p_connection);
+  void serve_requests(QTcpSocket * _p_socket, client_session * _p_session);
+  bool read_line(QTcpSocket * _p_socket, client_session * _p_session);
+  bool read_frame(QTcpSocket * _p_socket, client_session * _p_session);
+  void invalid_command(QTcpSocket * _p_socket);
+  void write_reply(QTcpSocket * _p_socket, const QByteArray & _reply);
+  void run_blocking(
+    const command_table::handler & _handler,
+    QString * _p_text, QTcpSocket * _p_socket);
+  Q_SLOT void request_done(QTcpSocket * _p_socket, qint64 _usecs);
+
   QTcpServer * m_pServer;
 
   volatile bool m_continue = true;
@@ -130,9 +137,26 @@ private:
   master_node * m_p_master_node;
   worker_node * m_p_worker_node;
 
-  QTcpSocket * currentSocket = NULL;
   QQueue<tcp_connection> * m_pTcpMessages;
-  QList<tcp_connection *> m_tcp_connections;
-  QTimer * m_p_timer;
+
+  /*
+   * master mode: connections that are queued, waiting to be told
+   * their pair, or registered, by socket. Dropping one is a single
+   * lookup no matter how many are waiting.
+   */
+  QHash<QTcpSocket *, tcp_connection *> m_connections;
+
+  /* worker mode: one session per connected client */
+  QHash<QTcpSocket *, client_session *> m_sessions;
+  /* clients that left while a request of theirs was still running */
+  QSet<QTcpSocket *> m_closing;
+  command_table m_commands;
+  request_executor * m_p_executor = NULL;
+  int m_idle_timeout = 30000;
+
+  std::atomic<qint64> m_latency{0};
+
+  /* requests served for one client before the others get a turn */
+  static const int MAX_REQUESTS_PER_TURN = 16;
 };
 #endif
@@ -18,8 +18,10 @@ worker_connection::worker_connection(
   QString & _hostname,
   QTcpSocket * _p_socket,
   QObject * _p_parent)
-: tcp_connection(_hostname, _p_socket, _p_parent)
-{ /* constructor implemented in base class */}
+: tcp_connection(_hostname, _p_socket, _p_parent),
+  m_free_slots(1),
+  m_last_report(QDateTime::currentMSecsSinceEpoch())
+{ /* until it says otherwise, a worker has room for one client */}
 
 worker_connection::~worker_connection()
 { /* @todo to delete, or not to delete? */}
@@ -36,3 +38,39 @@ void worker_connection::add_client(client_connection * c)
   std::cout << "Added client at " << client_address.toString().toStdString() << ":" <<
     client_port << std::endl;
 }
+
+/**
+ * @brief Record a load report from the worker.
+ *
+ * @param _outstanding Clients connected to (or on their way to) the worker.
+ * @param _latency Average response time, in microseconds.
+ * @param _free_slots Clients the worker has room for.
+ * @param _paired_seen PAIRED messages the worker had seen when it reported.
+ */
+void worker_connection::set_load(
+  const int & _outstanding, const qint64 & _latency,
+  const int & _free_slots, const int & _paired_seen)
+{
+  m_outstanding.storeRelease(_outstanding);
+  m_latency.storeRelease(_latency);
+  m_free_slots.storeRelease(_free_slots);
+  m_paired_seen.storeRelease(_paired_seen);
+  m_last_report.storeRelease(QDateTime::currentMSecsSinceEpoch());
+}
+
+/**
+ * @brief Clients the worker has room for, as far as we know.
+ *
+ * Pairings made since the worker's last report are taken off
+ * the free slots it reported. set_load() stores the free slots
+ * before the PAIRED count, so reading them the other way round
+ * can only undercount.
+ *
+ * @return Free slots (may be negative).
+ */
+int worker_connection::get_free_slots() const
+{
+  int paired_seen = m_paired_seen.loadAcquire();
+  int free_slots = m_free_slots.loadAcquire();
+  return free_slots - (m_paired_sent.loadAcquire() - paired_seen);
+}
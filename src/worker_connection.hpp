@@ -32,5 +32,40 @@ public:
   virtual ~worker_connection();
 
   void add_client(client_connection * c);
+
+  /*
+   * A worker registered with REGISTER_WORKER keeps its connection
+   * open and is paired many times; one registered with the older
+   * REQUEST_CLIENT is paired once and hung up on.
+   */
+  void set_persistent(const bool & _persistent) {m_persistent = _persistent;}
+  bool is_persistent() const {return m_persistent;}
+
+  /*
+   * Load reports are written by the tcp thread and read by the
+   * pairing thread, hence the atomics.
+   */
+  void set_load(
+    const int & _outstanding, const qint64 & _latency,
+    const int & _free_slots = 1, const int & _paired_seen = 0);
+  int get_outstanding() const {return m_outstanding.loadAcquire() + unacknowledged();}
+  qint64 get_latency() const {return m_latency.loadAcquire();}
+  int get_free_slots() const;
+  qint64 get_last_report() const {return m_last_report.loadAcquire();}
+
+  /* called by the pairing thread when it hands out a slot */
+  void note_paired() {m_paired_sent.ref();}
+
+private:
+  /* pairings the worker had not heard about when it last reported */
+  int unacknowledged() const {return m_paired_sent.loadAcquire() - m_paired_seen.loadAcquire();}
+
+  bool m_persistent = false;
+  QAtomicInt m_outstanding;               /* clients connected to the worker */
+  QAtomicInteger<qint64> m_latency;       /* average response time, in microseconds */
+  QAtomicInt m_free_slots;                /* room for more clients */
+  QAtomicInt m_paired_seen;               /* PAIRED messages the worker has seen */
+  QAtomicInt m_paired_sent;               /* slots we have handed out */
+  QAtomicInteger<qint64> m_last_report;   /* when the last report arrived (ms since epoch) */
 };
 #endif
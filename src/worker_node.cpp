@@ -14,16 +14,48 @@
 
 #include "worker_node.hpp"
 
+const int worker_node::MAX_QUEUED_REQUESTS;
+const qint64 worker_node::TOKEN_TTL;
+const int worker_node::AUTH_CACHE_SIZE;
+const qint64 worker_node::AUTH_CACHE_TTL;
+const int worker_node::MEMBERSHIP_CACHE_SIZE;
+const qint64 worker_node::MEMBERSHIP_CACHE_TTL;
+const int worker_node::SCHEDULE_CACHE_BUDGET;
+const qint64 worker_node::SCHEDULE_CACHE_TTL;
+const int worker_node::DAY_START;
+const int worker_node::DAY_END;
+const int worker_node::QUORUM_SUGGESTIONS;
+
 worker_node::worker_node(const QString & _host, const quint16 & _port, QObject * _p_parent)
 : QObject(_p_parent),
   m_host(_host),
   m_port(_port),
-  m_db(setup_db()),
-  m_p_mutex(new QMutex())
-{ /* constructor */}
+  m_p_mutex(new QMutex()),
+  m_p_db_pool(new db_pool([this](const QString & _name) {return setup_db(_name);})),
+  m_p_tokens(NULL)
+{
+  QByteArray secret = qgetenv("TOKEN_SECRET");
+  if (secret.isEmpty()) {
+    /* fine for one worker, but tokens will not carry over to the others */
+    std::cerr << "TOKEN_SECRET is not set; using a random token secret" << std::endl;
+    secret = QUuid::createUuid().toRfc4122() + QUuid::createUuid().toRfc4122();
+  }
+  m_p_tokens = new session_token(secret, TOKEN_TTL);
+  m_p_auth_cache = new auth_cache(AUTH_CACHE_SIZE, AUTH_CACHE_TTL);
+  m_p_membership = new membership_cache(MEMBERSHIP_CACHE_SIZE, MEMBERSHIP_CACHE_TTL);
+  m_p_schedules = new schedule_cache(SCHEDULE_CACHE_BUDGET, SCHEDULE_CACHE_TTL);
+  define_statements();
+}
 
 worker_node::~worker_node()
 {
+  /* let running requests finish first */
+  delete m_p_executor;
+  delete m_p_db_pool;
+  delete m_p_tokens;
+  delete m_p_auth_cache;
+  delete m_p_membership;
+  delete m_p_schedules;
   delete m_p_mutex;
   delete m_p_tcp_thread;
   delete m_p_thread;
@@ -37,6 +69,16 @@ bool worker_node::init()
   m_p_thread = new QThread();
   /* construct the tcp thread */
   m_p_tcp_thread = new tcp_thread(m_host, m_port, false);
+  m_p_tcp_thread->set_idle_timeout(m_idle_timeout);
+  /*
+   * database work runs off the tcp thread, on one thread per pooled
+   * connection; each thread opens its connection as it starts
+   */
+  m_p_executor = new request_executor(m_db_pool_size, MAX_QUEUED_REQUESTS,
+    [this]() {m_p_db_pool->acquire();});
+  m_p_tcp_thread->set_executor(m_p_executor);
+  /* replies now cross threads, so disconnect_client is queued */
+  qRegisterMetaType<QString *>("QString*");
 
   /* if the tcp thread fails to start, throw an exception. */
   if (!m_p_tcp_thread->init()) {throw thread_init_exception("tcp_thread failed to initialize.");}
@@ -54,178 +96,210 @@ bool worker_node::init()
   connect(this, &worker_node::established_client_connection, this, &worker_node::start_thread);
   connect(this, &worker_node::disconnect_client, m_p_tcp_thread, &tcp_thread::disconnect_client);
 
-  /* connect message handlers */
-  connect(m_p_tcp_thread, &tcp_thread::got_create_account,
-    this, &worker_node::request_create_account,
-    Qt::DirectConnection);
-  connect(m_p_tcp_thread, &tcp_thread::got_login_request,
-    this, &worker_node::request_login,
-    Qt::DirectConnection);
-  connect(m_p_tcp_thread, &tcp_thread::got_create_group,
-    this, &worker_node::request_create_group,
-    Qt::DirectConnection);
-  connect(m_p_tcp_thread, &tcp_thread::got_join_group,
-    this, &worker_node::request_add_to_group,
-    Qt::DirectConnection);
-  connect(m_p_tcp_thread, &tcp_thread::got_leave_group,
-    this, &worker_node::request_leave_group,
-    Qt::DirectConnection);
-  connect(m_p_tcp_thread, &tcp_thread::got_update_user,
-    this, &worker_node::request_update_user,
-    Qt::DirectConnection);
-  connect(m_p_tcp_thread, &tcp_thread::got_request_groups,
-    this, &worker_node::request_user_groups,
-    Qt::DirectConnection);
-  connect(m_p_tcp_thread, &tcp_thread::got_request_account,
-    this, &worker_node::request_account_info,
-    Qt::DirectConnection);
-  connect(m_p_tcp_thread, &tcp_thread::got_delete_group,
-    this, &worker_node::request_delete_group,
-    Qt::DirectConnection);
-  connect(m_p_tcp_thread, &tcp_thread::got_list_group_users,
-    this, &worker_node::request_group_users,
-    Qt::DirectConnection);
-  connect(m_p_tcp_thread, &tcp_thread::got_create_user_event,
-    this, &worker_node::request_personal_event,
-    Qt::DirectConnection);
-  connect(m_p_tcp_thread, &tcp_thread::got_create_group_event,
-    this, &worker_node::request_group_event,
-    Qt::DirectConnection);
-  connect(m_p_tcp_thread, &tcp_thread::got_reset_password,
-    this, &worker_node::request_reset_password,
-    Qt::DirectConnection);
-  connect(m_p_tcp_thread, &tcp_thread::got_request_events,
-    this, &worker_node::request_user_events,
-    Qt::DirectConnection);
-  connect(m_p_tcp_thread, &tcp_thread::got_request_month_events,
-    this, &worker_node::request_personal_month_events,
-    Qt::DirectConnection);
-  connect(m_p_tcp_thread, &tcp_thread::got_request_group_events,
-    this, &worker_node::request_group_events,
-    Qt::DirectConnection);
-  connect(m_p_tcp_thread, &tcp_thread::got_request_group_month_events,
-    this, &worker_node::request_group_month_events,
-    Qt::DirectConnection);
-  connect(m_p_tcp_thread, &tcp_thread::got_create_friendship,
-    this, &worker_node::request_create_friendship,
-    Qt::DirectConnection);
-  connect(m_p_tcp_thread, &tcp_thread::got_accept_friend,
-    this, &worker_node::request_accept_friend,
-    Qt::DirectConnection);
-  connect(m_p_tcp_thread, &tcp_thread::got_request_friends,
-    this, &worker_node::request_friends,
-    Qt::DirectConnection);
-  connect(m_p_tcp_thread, &tcp_thread::got_delete_friend,
-    this, &worker_node::request_delete_friend,
-    Qt::DirectConnection);
-  connect(m_p_tcp_thread, &tcp_thread::got_friend_requests,
-    this, &worker_node::request_friend_requests,
-    Qt::DirectConnection);
-  connect(m_p_tcp_thread, &tcp_thread::got_absent,
-    this, &worker_node::request_absent,
-    Qt::DirectConnection);
-  connect(m_p_tcp_thread, &tcp_thread::got_present,
-    this, &worker_node::request_present,
-    Qt::DirectConnection);
-  connect(m_p_tcp_thread, &tcp_thread::got_suggest_user_time,
-    this, &worker_node::request_suggest_user_times,
+  connect(m_p_tcp_thread, &tcp_thread::accepted_client,
+    this, &worker_node::handle_client_connect,
     Qt::DirectConnection);
   connect(m_p_tcp_thread, &tcp_thread::dropped_client,
     this, &worker_node::handle_client_disconnect,
     Qt::DirectConnection);
-  connect(m_p_tcp_thread, &tcp_thread::got_suggest_group_times,
-    this, &worker_node::request_suggest_group_times,
-    Qt::DirectConnection);
+
+  /* register message handlers */
+  register_request("CREATE_ACCOUNT", &worker_node::request_create_account);
+  register_request("REQUEST_LOGIN", &worker_node::request_login);
+  register_request("CREATE_GROUP_EVENT", &worker_node::request_group_event);
+  register_request("CREATE_GROUP", &worker_node::request_create_group);
+  register_request("JOIN_GROUP", &worker_node::request_add_to_group);
+  register_request("LEAVE_GROUP", &worker_node::request_leave_group);
+  register_request("UPDATE_ACCOUNT", &worker_node::request_update_user);
+  register_request("REQUEST_GROUPS", &worker_node::request_user_groups);
+  register_request("REQUEST_ACCOUNT", &worker_node::request_account_info);
+  register_request("DELETE_GROUP", &worker_node::request_delete_group);
+  register_request("REQUEST_USERS", &worker_node::request_group_users);
+  register_request("CREATE_USER_EVENT", &worker_node::request_personal_event);
+  register_request("REQUEST_RESET", &worker_node::request_reset_password);
+  register_request("REQUEST_EVENTS", &worker_node::request_user_events);
+  register_request("REQUEST_GROUP_EVENTS", &worker_node::request_group_events);
+  register_request("REQUEST_PERSONAL_MONTH_EVENTS", &worker_node::request_personal_month_events);
+  register_request("REQUEST_GROUP_MONTH_EVENTS", &worker_node::request_group_month_events);
+  register_request("CREATE_FRIENDSHIP", &worker_node::request_create_friendship);
+  register_request("ACCEPT_FRIEND", &worker_node::request_accept_friend);
+  register_request("REQUEST_FRIENDS", &worker_node::request_friends);
+  register_request("DELETE_FRIEND", &worker_node::request_delete_friend);
+  register_request("FRIEND_REQUESTS", &worker_node::request_friend_requests);
+  register_request("ABSENT", &worker_node::request_absent);
+  register_request("PRESENT", &worker_node::request_present);
+  register_request("SUGGEST_TIMES", &worker_node::request_suggest_user_times);
+  register_request("REQUEST_TIMES", &worker_node::request_suggest_group_times);
+  register_request("WORKER_STATS", &worker_node::request_stats);
+  register_request("CACHE_STATS", &worker_node::request_cache_stats);
+
   /* start the thread */
   m_p_thread->start();
   return m_p_thread->isRunning();
 }
 
+/**
+ * @brief Stop talking to the master.
+ */
+void worker_node::stop()
+{
+  m_continue = false;
+  /* the control socket belongs to our thread */
+  QMetaObject::invokeMethod(this, "close_control", Qt::QueuedConnection);
+}
+
+/**
+ * @brief Hang up on the master.
+ */
+void worker_node::close_control()
+{
+  if (m_p_control != NULL) {m_p_control->abort();}
+}
+
+/**
+ * @brief Route a request verb to one of our handlers.
+ *
+ * Our handlers all wait on the database, so they run
+ * on the executor; their replies are queued back to the
+ * tcp thread through disconnect_client.
+ *
+ * @param _verb Leading token of the request line.
+ * @param _handler Member function that serves the request.
+ */
+void worker_node::register_request(const QByteArray & _verb, request_handler _handler)
+{
+  m_p_tcp_thread->register_command(_verb,
+    [this, _handler](QString * _p_text, QTcpSocket * _p_socket) {
+      (this->*_handler)(_p_text, _p_socket);
+    }, true);
+}
+
+/**
+ * @brief Start the control connection to the master.
+ *
+ * This runs on our own thread when it starts. We keep one
+ * connection open to the master, register once, and tell it
+ * how many clients we have room for. From then on everything
+ * is event driven: the master sends PAIRED whenever it hands
+ * one of our slots to a client, and we send a fresh load report
+ * whenever our clients come and go (and on a heartbeat).
+ */
 void worker_node::run()
 {
   std::cout << "Worker Thread started" << std::endl;
-  /* initialize the state machine with a connect to master */
+
+  m_p_control = new QTcpSocket(this);
+  m_p_heartbeat = new QTimer(this);
+  m_p_heartbeat->setInterval(HEARTBEAT_INTERVAL);
+
+  connect(m_p_control, &QAbstractSocket::connected, this, &worker_node::register_with_master);
+  connect(m_p_control, &QIODevice::readyRead, this, &worker_node::read_from_master);
+  connect(m_p_control, &QAbstractSocket::disconnected, this, &worker_node::lost_master);
+  connect(m_p_control,
+    static_cast<void (QAbstractSocket::*)(QAbstractSocket::SocketError)>(&QAbstractSocket::error),
+    this, &worker_node::lost_master);
+  connect(m_p_heartbeat, &QTimer::timeout, this, &worker_node::send_load_report);
+
+  connect_to_master();
+}
+
+/**
+ * @brief (Re)open the control connection.
+ */
+void worker_node::connect_to_master()
+{
+  if (!m_continue) {return;}
+  std::cout << "state: CONNECT_TO_MASTER" << std::endl;
   state = connection_state::CONNECT_TO_MASTER;
+  m_p_control->abort();
+  m_reconnect_pending = false;
+  m_p_control->connectToHost(m_master_host, m_master_port, QIODevice::ReadWrite);
+}
 
-  QTcpSocket * pSocket = NULL;
-  QString read, our_tcp_server, port_string;
-  bool served;
-
-  for (; m_continue; m_p_thread->msleep(sleep_time)) {
-    if (state == connection_state::CONNECT_TO_MASTER) {
-      goto connect_to_master;
-    } else if (state == connection_state::WAIT_FOR_JOB) {
-      goto wait_for_job;
-    } else if (state == connection_state::WAIT_FOR_CLIENT_CONNECT) {goto wait_for_client;}
-connect_to_master:
-    served_client = false;
-    std::cout << "state: CONNECT_TO_MASTER" << std::endl;
-    if (pSocket != NULL) {delete pSocket;}
-    pSocket = new QTcpSocket();
-
-    pSocket->connectToHost(m_master_host,
-      m_master_port,
-      QIODevice::ReadWrite);
-    pSocket->waitForConnected(tcp_comm::TIMEOUT);
-
-    if (pSocket->state() == QAbstractSocket::UnconnectedState) {
-      pSocket->abort();
-      delete pSocket;
-      pSocket = NULL;                   /* asign to null for next go around */
-      goto end;
-    }
+/**
+ * @brief Register with the master once the control connection is up.
+ */
+void worker_node::register_with_master()
+{
+  std::cout << "state: WAIT_FOR_JOB" << std::endl;
+  state = connection_state::WAIT_FOR_JOB;
+  /* the master counts pairings per connection */
+  m_paired_seen = 0;
 
-    /* write the greeting message to the master_node */
-    pSocket->write("REQUEST_CLIENT\r\n");
-    /* write our location to the server */
-    our_tcp_server = m_host + ":";
-    port_string.setNum(m_port);
-    our_tcp_server += port_string + "\r\n" + '\0';
-    pSocket->write(our_tcp_server.toStdString().c_str());             /* write the next line */
-
-    /* wait until the bytes have been written, unlimited time. */
-    pSocket->waitForBytesWritten(-1);
-
-    /* if we are here, we can proceed. */
-    state = connection_state::WAIT_FOR_JOB;
-wait_for_job:
-    std::cout << "state: WAIT_FOR_JOB" << std::endl;
-    /* wait for ready read */
-    pSocket->waitForReadyRead();
-    for (; pSocket->canReadLine(); read += pSocket->readLine()) {
-    }
+  QByteArray greeting = "REGISTER_WORKER\r\n";
+  greeting += m_host.toUtf8() + ":" + QByteArray::number(m_port) + "\r\n";
+  m_p_control->write(greeting + load_report());
+  m_p_heartbeat->start();
+}
 
-    /* check that we have things. Otherwise, loop again. */
-    if (read.size() == 0) {goto end;}
-    read.replace("\r\n", "");
-    std::cout << "I read \"" << read.toStdString() << "\"" << std::endl;
-    if (read == "OK") {
-      state = connection_state::WAIT_FOR_CLIENT_CONNECT;
-      pSocket->disconnectFromHost();
-      delete pSocket; read.clear();
-      pSocket = NULL;
-    }
-    m_p_mutex->lock();
-    served_client = false;
-    m_p_mutex->unlock();
-wait_for_client:
-    for (;; m_p_thread->msleep(sleep_time)) {
-      m_p_mutex->lock();
-      served = served_client;
-      m_p_mutex->unlock();
-      if (served) {goto end;}
+/**
+ * @brief Handle messages from the master.
+ *
+ * The only message is PAIRED: a client has been given
+ * one of our slots and is on its way.
+ */
+void worker_node::read_from_master()
+{
+  bool paired = false;
+  while (m_p_control->canReadLine()) {
+    QByteArray line = m_p_control->readLine();
+    while (line.endsWith('\n') || line.endsWith('\r')) {line.chop(1);}
+    if (line == "PAIRED") {
+      ++m_paired_seen;
+      reserve_slot();
+      paired = true;
+    } else {
+      std::cerr << "unexpected message from master: \"" << line.constData() << "\"" << std::endl;
     }
-    state = connection_state::CONNECT_TO_MASTER;
-end:
-    state = connection_state::CONNECT_TO_MASTER;
-    continue;             /* go around again */
   }
+  /* let the master know we have caught up */
+  if (paired) {send_load_report();}
+}
+
+/**
+ * @brief Try the master again after a short wait.
+ *
+ * Connected to both disconnected() and error(), so it
+ * may be called twice for the same failure.
+ */
+void worker_node::lost_master()
+{
+  if (m_reconnect_pending || !m_continue) {return;}
+  m_reconnect_pending = true;
+  m_p_heartbeat->stop();
+  std::cerr << "lost the master, reconnecting" << std::endl;
+  QTimer::singleShot(sleep_time, this, &worker_node::connect_to_master);
+}
+
+/**
+ * @brief Send our load to the master.
+ */
+void worker_node::send_load_report()
+{
+  m_report_pending.storeRelease(0);
+  if (state != connection_state::WAIT_FOR_JOB) {return;}
+  m_p_control->write(load_report());
+}
+
+/**
+ * @brief Ask our thread to send a load report soon.
+ *
+ * Called from the tcp_thread as clients come and go.
+ * Several requests before the report goes out are
+ * folded into one.
+ */
+void worker_node::schedule_load_report()
+{
+  if (!m_report_pending.testAndSetOrdered(0, 1)) {return;}
+  QMetaObject::invokeMethod(this, "send_load_report", Qt::QueuedConnection);
 }
 
 /**
  * Unter doesn't know how to spell worker. (Unter=Hunter)
+ *
+ * @param _name Name to give the connection.
  */
-QSqlDatabase worker_node::setup_db()
+QSqlDatabase worker_node::setup_db(const QString & _name)
 {
   const char * user, * pwd, * dbb, * host, * port_string;
   if ((user = getenv("DBUSR")) == NULL) {
@@ -245,25 +319,158 @@ QSqlDatabase worker_node::setup_db()
     throw std::invalid_argument("getenv on db host failed");
   }
 
-  QSqlDatabase db = QSqlDatabase::addDatabase("QMYSQL");
+  QSqlDatabase db = QSqlDatabase::addDatabase("QMYSQL", _name);
   quint64 port = std::stoi(std::string(port_string));
 
   db.setHostName(host); db.setDatabaseName(dbb);
   db.setUserName(user); db.setPassword(pwd);
   db.setPort(port);
+  /* count the rows an UPDATE matched, not just the ones it changed */
+  db.setConnectOptions("CLIENT_FOUND_ROWS=1");
   return db;
 }
 
 /**
- * Handle an unexpected client disconnect.
+ * @brief Define the prepared statements our queries use.
+ *
+ * These are prepared once on each pooled connection, and
+ * bound by position at call time.
+ */
+void worker_node::define_statements()
+{
+  m_p_db_pool->define_statement("schedule",
+    "SELECT schedule_item.date, schedule_item.start_time, "
+    "schedule_item.duration, schedule_item.location, "
+    "schedule_item.event_name FROM schedule_item, schedules "
+    "WHERE schedules.owner = ? "
+    "AND schedule_item.schedule_id = schedules.schedule_id "
+    "ORDER BY schedule_item.date, schedule_item.start_time");
+  m_p_db_pool->define_statement("schedule_days",
+    "SELECT schedule_item.date, schedule_item.start_time, "
+    "schedule_item.duration, schedule_item.location, "
+    "schedule_item.event_name FROM schedule_item, schedules "
+    "WHERE schedules.owner = ? "
+    "AND schedule_item.date >= ? AND schedule_item.date <= ? "
+    "AND schedule_item.schedule_id = schedules.schedule_id "
+    "ORDER BY schedule_item.date, schedule_item.start_time");
+  m_p_db_pool->define_statement("group_busy",
+    "SELECT users.user_name, schedule_item.date, schedule_item.start_time, "
+    "schedule_item.duration FROM groups, user_group_relation, "
+    "users, schedule_item WHERE groups.group_name = ? "
+    "AND user_group_relation.group_id = groups.group_id "
+    "AND users.user_id = user_group_relation.user_id "
+    "AND schedule_item.schedule_id = users.schedule_id "
+    "AND schedule_item.date >= ? AND schedule_item.date <= ?");
+  m_p_db_pool->define_statement("friends",
+    "SELECT DISTINCT u2.user_name "
+    "FROM users u1, users u2, user_friend_relation "
+    "WHERE u1.user_name = ? AND "
+    "((user_friend_relation.user_id = u1.user_id AND "
+    "user_friend_relation.friend_id = u2.user_id) OR "
+    "(user_friend_relation.friend_id = u1.user_id AND "
+    "user_friend_relation.user_id = u2.user_id)) AND "
+    "u2.user_name != ? AND "
+    "user_friend_relation.accepted = 1");
+  m_p_db_pool->define_statement("select_user",
+    "SELECT DISTINCT user_id, schedule_id, email, cellphone FROM users "
+    "WHERE user_name = ? AND passwd = ?");
+  m_p_db_pool->define_statement("select_passwd",
+    "SELECT passwd FROM users WHERE user_name = ?");
+  m_p_db_pool->define_statement("username_exists",
+    "SELECT user_id FROM users WHERE user_name = ?");
+  m_p_db_pool->define_statement("select_schedule_id",
+    "SELECT DISTINCT schedule_id FROM schedules WHERE owner = ?");
+  m_p_db_pool->define_statement("insert_schedule",
+    "INSERT INTO schedules(owner) VALUES(?)");
+  m_p_db_pool->define_statement("insert_user",
+    "INSERT INTO users(user_name, schedule_id, passwd, email) VALUES(?, ?, ?, ?)");
+}
+
+/**
+ * @brief Count a newly connected client.
+ *
+ * The client takes up the slot the master reserved for it. A client
+ * can beat the worker thread to it and connect before the reservation
+ * is recorded; reserve_slot() settles up with it afterwards.
+ */
+void worker_node::handle_client_connect()
+{
+  m_p_mutex->lock();
+  ++m_active_clients;
+  if (!m_reservations.isEmpty()) {
+    m_reservations.removeFirst();
+  } else {
+    m_early_clients.append(QDateTime::currentMSecsSinceEpoch());
+  }
+  m_p_mutex->unlock();
+  schedule_load_report();
+}
+
+/**
+ * @brief Free the slot of a client that has left.
  */
 void worker_node::handle_client_disconnect()
 {
   m_p_mutex->lock();
-  served_client = true;
+  if (m_active_clients > 0) {--m_active_clients;}
+  m_p_mutex->unlock();
+  schedule_load_report();
+}
+
+/**
+ * @brief Build the LOAD line sent to the master.
+ *
+ * @return "LOAD <clients>:::<latency>:::<free slots>:::<paired>\r\n".
+ *   Clients counts both connected and expected clients, latency is
+ *   our average response time in microseconds, and paired is how many
+ *   PAIRED messages we have seen on this connection, so the master
+ *   can tell which of its pairings the report already accounts for.
+ */
+QByteArray worker_node::load_report()
+{
+  m_p_mutex->lock();
+  expire_reservations();
+  int outstanding = m_active_clients + m_reservations.size();
+  m_p_mutex->unlock();
+  int free_slots = qMax(0, m_max_clients - outstanding);
+  return "LOAD " + QByteArray::number(outstanding) + ":::" +
+    QByteArray::number(m_p_tcp_thread->get_latency()) + ":::" +
+    QByteArray::number(free_slots) + ":::" +
+    QByteArray::number(m_paired_seen) + "\r\n";
+}
+
+/**
+ * @brief Hold a slot for the client the master just paired us with.
+ */
+void worker_node::reserve_slot()
+{
+  m_p_mutex->lock();
+  expire_reservations();
+  if (!m_early_clients.isEmpty()) {
+    /* it is already here */
+    m_early_clients.removeFirst();
+  } else {
+    m_reservations.append(QDateTime::currentMSecsSinceEpoch());
+  }
   m_p_mutex->unlock();
 }
 
+/**
+ * @brief Drop reservations for clients that never showed up.
+ *
+ * The caller must hold m_p_mutex.
+ */
+void worker_node::expire_reservations()
+{
+  qint64 oldest = QDateTime::currentMSecsSinceEpoch() - RESERVATION_TIMEOUT;
+  while (!m_reservations.isEmpty() && m_reservations.first() < oldest) {
+    m_reservations.removeFirst();
+  }
+  while (!m_early_clients.isEmpty() && m_early_clients.first() < oldest) {
+    m_early_clients.removeFirst();
+  }
+}
+
 /**
  * @brief Insert a group into the database.
  *
@@ -272,12 +479,13 @@ void worker_node::handle_client_disconnect()
  */
 bool worker_node::insert_group(const QString & group_name)
 {
-  if (!m_db.open()) {
+  QSqlDatabase db = m_p_db_pool->acquire();
+  if (!db.isOpen()) {
     std::cerr << "Error! Failed to open database connection!" << std::endl;
     return false;
   } else if (!group_name.size()) {return false;}
 
-  QSqlQuery query(m_db);
+  QSqlQuery query(db);
   query.prepare("CALL AddGroup(?, @success)");
   query.bindValue(0, group_name);
 
@@ -293,6 +501,8 @@ bool worker_node::insert_group(const QString & group_name)
     return false;
   }
   query.next();
+  m_p_membership->invalidate_group(group_name);
+  m_p_schedules->invalidate(group_name);
 
   return query.value(0).toBool();
 }
@@ -306,12 +516,13 @@ bool worker_node::insert_group(const QString & group_name)
  */
 bool worker_node::leave_group(const QString & user_name, const QString & group_name)
 {
-  if (!m_db.open()) {
+  QSqlDatabase db = m_p_db_pool->acquire();
+  if (!db.isOpen()) {
     std::cerr << "Error! Failed to open database connection!" << std::endl;
     return false;
   } else if (!group_name.size()) {return false;}
 
-  QSqlQuery query(m_db);
+  QSqlQuery query(db);
   query.prepare("CALL RemoveFromGroup(?, ?, @success)");
   query.bindValue(0, group_name);
   query.bindValue(1, user_name);
@@ -328,6 +539,7 @@ bool worker_node::leave_group(const QString & user_name, const QString & group_n
     return false;
   }
   query.next();
+  m_p_membership->invalidate_group(group_name);
 
   return query.value(0).toBool();
 }
@@ -341,12 +553,13 @@ bool worker_node::leave_group(const QString & user_name, const QString & group_n
  */
 bool worker_node::group_exists(const QString & _group)
 {
-  if (!m_db.open()) {
+  QSqlDatabase db = m_p_db_pool->acquire();
+  if (!db.isOpen()) {
     std::cerr << "Error! Failed to open database connection!" << std::endl;
     return false;
   } else if (!_group.size()) {return false;}
 
-  QSqlQuery query(m_db);
+  QSqlQuery query(db);
   query.prepare("SELECT count(*) FROM groups WHERE group_name = ?");
   query.bindValue(0, _group);
 
@@ -369,12 +582,13 @@ bool worker_node::group_exists(const QString & _group)
  */
 bool worker_node::remove_group(const QString & group_name)
 {
-  if (!m_db.open()) {
+  QSqlDatabase db = m_p_db_pool->acquire();
+  if (!db.isOpen()) {
     std::cerr << "Error! Failed to open database connection!" << std::endl;
     return false;
   } else if (!group_name.size()) {return false;}
 
-  QSqlQuery query(m_db);
+  QSqlQuery query(db);
   query.prepare("CALL RemoveGroup(?, @success)");
   query.bindValue(0, group_name);
 
@@ -390,6 +604,8 @@ bool worker_node::remove_group(const QString & group_name)
     return false;
   }
   query.next();
+  m_p_membership->invalidate_group(group_name);
+  m_p_schedules->invalidate(group_name);
 
   return query.value(0).toBool();
 }
@@ -403,12 +619,13 @@ bool worker_node::remove_group(const QString & group_name)
  */
 bool worker_node::join_group(const QString & user_name, const QString & group_name)
 {
-  if (!m_db.open()) {
+  QSqlDatabase db = m_p_db_pool->acquire();
+  if (!db.isOpen()) {
     std::cerr << "Error! Failed to open database connection!" << std::endl;
     return false;
   } else if (!group_name.size()) {return false;}
 
-  QSqlQuery query(m_db);
+  QSqlQuery query(db);
   query.prepare("CALL AddUserToGroup(?, ?, @success)");
   query.bindValue(0, group_name);
   query.bindValue(1, user_name);
@@ -425,6 +642,7 @@ bool worker_node::join_group(const QString & user_name, const QString & group_na
     return false;
   }
   query.next();
+  m_p_membership->invalidate_group(group_name);
 
   return query.value(0).toBool();
 }
@@ -441,125 +659,205 @@ bool worker_node::list_user_events(
   const QString & end_date,
   QString * _msg)
 {
-  if (!m_db.open()) {
+  QSqlDatabase db = m_p_db_pool->acquire();
+  if (!db.isOpen()) {
     std::cerr << "Error! Failed to open database connection!" << std::endl;
     return false;
   } else if (!owner.size()) {return false;}
 
-  QSqlQuery query(m_db);
-  QString query_text = QString("SELECT schedule_item.date, schedule_item.start_time, "
-      "schedule_item.duration, schedule_item.location, "
-      "schedule_item.event_name FROM schedule_item, schedules "
-      "WHERE schedules.owner = '") + owner + "'" +
-    "AND schedule_item.date >= '" + start_date + "'" +
-    "AND schedule_item.date < '" + end_date +
-    "' AND schedule_item.schedule_id = schedules.schedule_id;";
-  query.prepare(query_text);
+  QDate from = QDate::fromString(start_date, "yyyy-M-d");
+  QDate end = QDate::fromString(end_date, "yyyy-M-d");
+  if (!from.isValid() || !end.isValid()) {throw std::invalid_argument("invalid date range");}
 
-  if (!query.exec()) {
-    std::cerr << "Query Failed to execute!" << std::endl;
-    std::cerr << "query: \"" << query.lastQuery().toStdString() << "\"" << std::endl;
-    throw std::invalid_argument("failed to query the user's groups");
-    return false;
-  } else if (!query.size()) {
+  /* the end date is not included */
+  schedule_cache::items events;
+  if (!schedule_between(owner, from, end.addDays(-1), events)) {return false;}
+  if (events.isEmpty()) {
     *_msg += "\n";
     return true;
   }
 
-  for (; query.next(); ) {
-    *_msg += query.value(0).toString() + ":::" +
-      query.value(1).toString() + ":::" +
-      query.value(2).toString() + ":::" +
-      query.value(3).toString() + ":::" +
-      query.value(4).toString() + "\n";
+  for (const schedule_cache::item & e : events) {
+    *_msg += e.text + "\n";
   }
   return true;
 }
 
-QSet<calendar_event> worker_node::suggest_event_times(
+/**
+ * @brief Get the events on a schedule between two days.
+ *
+ * Served from the schedule cache; a schedule that is not
+ * cached is loaded whole, and cached.
+ *
+ * @param owner Owner of the schedule.
+ * @param from First day wanted.
+ * @param until Last day wanted; if null, every day from the first on.
+ * @param _events Filled with the events, sorted by date and start time.
+ * @return True if the events were found.
+ */
+bool worker_node::schedule_between(
   const QString & owner,
-  const QString & deadline_date,
-  const QString & deadline_time,
-  const QString & duration)
+  const QDate & from,
+  const QDate & until,
+  schedule_cache::items & _events)
 {
-  /* buckle the fuck up */
-  if (!m_db.open()) {
-    std::cerr << "Error! Failed to open database connection!" << std::endl;
-    throw std::invalid_argument("failed to find the database");
-    QSet<calendar_event> rip; return rip;
-  } else if (!owner.size()) {
-    throw std::invalid_argument("empty owner string");
-    QSet<calendar_event> rip; return rip;
-  }
-  QSet<calendar_event> times;
+  if (m_p_schedules->range(owner, from, until, _events)) {return true;}
+  quint64 generation = m_p_schedules->generation();
 
-  /* what day even is it? */
+  schedule_cache::items all;
+  if (!load_schedule(owner, QDate(), QDate(), all)) {return false;}
+  m_p_schedules->insert(owner, all, generation);
+  schedule_cache::select(all, from, until, _events);
+  return true;
+}
 
-  QString start_date = QDateTime::currentDateTime().toString("yyyy-M-d");
+/**
+ * @brief Load a schedule's events from the database.
+ *
+ * @param owner Owner of the schedule.
+ * @param from First day to load; if null, load them all.
+ * @param until Last day to load.
+ * @param _events Filled with the events, sorted by date and start time.
+ * @return True if the events were loaded.
+ */
+bool worker_node::load_schedule(
+  const QString & owner,
+  const QDate & from,
+  const QDate & until,
+  schedule_cache::items & _events)
+{
+  QSqlDatabase db = m_p_db_pool->acquire();
+  if (!db.isOpen()) {
+    std::cerr << "Error! Failed to open database connection!" << std::endl;
+    return false;
+  }
 
-  QSqlQuery query(m_db);
-  QString query_text = QString("SELECT schedule_item.date, schedule_item.start_time, "
-      "schedule_item.duration FROM schedule_item, schedules "
-      "WHERE schedules.owner = '") + owner + "' " +
-    "AND schedule_item.date >= '" + start_date + "' " +
-    "AND schedule_item.date <= '" + deadline_date + "' " +
-    "AND schedule_item.schedule_id = schedules.schedule_id;";
-  query.prepare(query_text);
+  QSqlQuery * query = m_p_db_pool->statement(from.isNull() ? "schedule" : "schedule_days");
+  if (query == NULL) {throw std::invalid_argument("failed to prepare the query");}
+  query->bindValue(0, owner);
+  if (!from.isNull()) {
+    query->bindValue(1, from);
+    query->bindValue(2, until);
+  }
 
-  /* I suppose we can just as for those days then? */
-  if (!query.exec()) {
+  if (!m_p_db_pool->exec(query)) {
     std::cerr << "Query Failed to execute!" << std::endl;
-    std::cerr << "query: \"" << query.lastQuery().toStdString() << "\"" << std::endl;
-    throw std::invalid_argument("failed to query the user's groups");
-    QSet<calendar_event> rip; return rip;
+    std::cerr << "query: \"" << query->lastQuery().toStdString() << "\"" << std::endl;
+    throw std::invalid_argument("failed to query the schedule");
+    return false;
   }
 
-  /* iterate through the returned dates, getting fucked accordingly. */
-  QSet<calendar_event> events, scheduled_times;
-  /* push the current date */
-  calendar_event current_time;
-  current_time.date = QDateTime::currentDateTime().date();
-  current_time.time = QDateTime::currentDateTime().time();
-  current_time.duration = 0;
-  events.insert(current_time);
-
-  for (; query.next(); ) {
-    calendar_event curr;
-    curr.date = query.value(0).toDate();
-    curr.time = query.value(1).toTime();
-
-    QTime temp = query.value(2).toTime();
+  for (; query->next(); ) {
+    schedule_cache::item e;
+    e.date = query->value(0).toDate();
+    e.start = query->value(1).toTime();
+    QTime duration = query->value(2).toTime();
     /* extract minute duration from time */
-    curr.duration = temp.hour() * 60 + temp.minute();
-    events.insert(curr);
-  }       /* add the deadline */
-  calendar_event deadline;
-  deadline.date = QDate::fromString(deadline_date, "yyyy-M-d");
-  deadline.time = QTime::fromString(deadline_time, "hh:mm");
-  /* we don't care about the duration of the deadline */
-  events.insert(deadline); int len = duration.toInt();
-
-  /**
-   * @todo verify the deadline is not occupied,
-   * and, if it is, backtrack to the first
-   * free slot that can hold our event.
-   */
+    e.duration = duration.hour() * 60 + duration.minute();
+    e.text = query->value(0).toString() + ":::" +
+      query->value(1).toString() + ":::" +
+      query->value(2).toString() + ":::" +
+      query->value(3).toString() + ":::" +
+      query->value(4).toString();
+    _events.append(e);
+  }
+  return true;
+}
 
-  QList<calendar_event> temp = events.toList();
-  /* find the working times */
-  for (int x = 0; x < events.size() - 1; ++x) {
-    bool ok;
-    calendar_event c = schedule_between(temp, x, x + 1, len, &ok);
+/**
+ * @brief Bring one day of a cached schedule up to date, after adding to it.
+ *
+ * @param owner Owner of the schedule.
+ * @param date The day, as the client sent it.
+ */
+void worker_node::refresh_schedule_day(const QString & owner, const QString & date)
+{
+  QDate day = QDate::fromString(date, "yyyy-M-d");
+  if (!day.isValid()) {return m_p_schedules->invalidate(owner);}
+  quint64 generation = m_p_schedules->generation();
 
-    if (!ok) {
-      continue;                    /* don't insert if you didn't find a time */
+  schedule_cache::items events;
+  try {
+    if (!load_schedule(owner, day, day, events)) {return m_p_schedules->invalidate(owner);}
+  } catch (...) {
+    /* the event is in; the next read will load it */
+    return m_p_schedules->invalidate(owner);
+  }
+  m_p_schedules->update_day(owner, day, events, generation);
+}
 
-    }
-    /**
-     * @todo check that the hour is not absurd.
-     */
+/**
+ * @brief Load a user's busy times into a timeline.
+ *
+ * @param owner Owner of the schedule.
+ * @param from First day wanted.
+ * @param until Last day wanted; if null, every day from the first on.
+ * @param _busy Filled with the events.
+ */
+void worker_node::busy_timeline(
+  const QString & owner,
+  const QDate & from,
+  const QDate & until,
+  interval_timeline & _busy)
+{
+  schedule_cache::items items;
+  if (!schedule_between(owner, from, until, items)) {
+    throw std::invalid_argument("failed to query the user's schedule");
+  }
 
-    times.insert(c);
+  /* the items are sorted, so this only appends */
+  _busy.reserve(items.size());
+  for (const schedule_cache::item & item : items) {
+    calendar_event e = calendar_event::from(item.date, item.start, item.duration);
+    _busy.insert(e.start, e.end());
+  }
+}
+
+/**
+ * @brief Suggest times a user is free, before a deadline.
+ *
+ * One time is suggested in each free stretch between now and
+ * the deadline that fits the event: in the middle of the
+ * stretch, or at 16:00 on its middle day if it spans days.
+ *
+ * @param owner The user.
+ * @param deadline_date Day the event must happen by.
+ * @param deadline_time Time the event must be over by, that day.
+ * @param duration Length of the event, in minutes.
+ * @return The suggestions, in time order.
+ */
+QList<calendar_event> worker_node::suggest_event_times(
+  const QString & owner,
+  const QString & deadline_date,
+  const QString & deadline_time,
+  const QString & duration)
+{
+  if (!owner.size()) {throw std::invalid_argument("empty owner string");}
+
+  QDateTime now = QDateTime::currentDateTime();
+  QDate last_date = QDate::fromString(deadline_date, "yyyy-M-d");
+  QTime last_time = QTime::fromString(deadline_time, "hh:mm");
+  if (!last_date.isValid() || !last_time.isValid()) {throw std::invalid_argument("invalid deadline");}
+  int len = duration.toInt();
+
+  interval_timeline busy;
+  /* yesterday's events may run past midnight */
+  busy_timeline(owner, now.date().addDays(-1), last_date, busy);
+
+  QList<calendar_event> times;
+  if (len <= 0) {return times;}
+  for (const interval_timeline::span & gap : busy.gaps(
+    availability::minute(now.date(), now.time()), availability::minute(last_date, last_time)))
+  {
+    if (gap.end - gap.start < len) {continue;}
+    qint64 first_day = calendar_event::day_of(gap.start);
+    qint64 days = calendar_event::day_of(gap.end) - first_day;
+    qint64 start = (days > 1)
+      ? (first_day + (days >> 1)) * calendar_event::MINUTES_PER_DAY + 16 * 60
+      : gap.start + (gap.end - gap.start - len) / 2;
+    /* keep it inside the stretch */
+    start = qBound(gap.start, start, gap.end - len);
+    times.append(calendar_event{qint32(start), len});
   }
   return times;
 }
@@ -568,51 +866,17 @@ bool worker_node::is_valid_for_user(
   const QString & owner,
   const calendar_event & event)
 {
-  if (!m_db.open()) {
-    std::cerr << "Error! Failed to open database connection!" << std::endl;
-    throw std::invalid_argument("failed to find the database");
-    return false;
-  } else if (!owner.size()) {
+  if (!owner.size()) {
     throw std::invalid_argument("empty owner string");
     return false;
   } else if (QDateTime::currentDateTime().time().addSecs(60 * event.duration) >
-    event.time) {return false;}
-
-  /* what day even is it? */
-  QString start_date = QDateTime::currentDateTime().toString("yyyy-M-d");
-
-  QSqlQuery query(m_db);
-  /**
-   * It might be wise to have an end date, but... I mean...
-   * I don't plan that far ahead... So... We'll wait for the report ;)
-   */
-  QString query_text = QString("SELECT schedule_item.date, schedule_item.start_time, "
-      "schedule_item.duration FROM schedule_item, schedules "
-      "WHERE schedules.owner = '") + owner + "' " +
-    "AND schedule_item.date >= '" + start_date + "' " +
-    "AND schedule_item.schedule_id = schedules.schedule_id;";
-  query.prepare(query_text);
+    event.time()) {return false;}
 
-  if (!query.exec()) {
-    std::cerr << "Query Failed to execute!" << std::endl;
-    std::cerr << "query: \"" << query.lastQuery().toStdString() << "\"" << std::endl;
-    throw std::invalid_argument("failed to query the user's groups");
-    return false;
-  }
-
-  for (; query.next(); ) {
-    calendar_event curr;
-    curr.date = query.value(0).toDate();
-    curr.time = query.value(1).toTime();
-
-    QTime temp = query.value(2).toTime();
-    /* extract minute duration from time */
-    curr.duration = temp.hour() * 60 + temp.minute();
-
-    /* return false if events overlap */
-    if (check_overlap(event, curr)) {return false;}
-  }
-  return true;
+  /* the day before too, for events that run past midnight */
+  interval_timeline busy;
+  QDate day = event.date();
+  busy_timeline(owner, day.addDays(-1), day.addDays(1), busy);
+  return !busy.overlaps(event.start, event.end());
 }
 
 bool worker_node::suggest_user_events(
@@ -622,136 +886,203 @@ bool worker_node::suggest_user_events(
   const QString & duration,
   QString * _msg)
 {
-  QSet<calendar_event> suggestions;
-  suggestions = suggest_event_times(owner, deadline_date,
+  QList<calendar_event> times = suggest_event_times(owner, deadline_date,
       deadline_time, duration);
   /* write back the request */
-  if (!suggestions.size()) {
+  if (!times.size()) {
     *_msg = "\n";
     return true;
   }
 
-  QList<calendar_event> times = suggestions.values();
   for (int x = 0; x < times.size(); ++x) {
-    *_msg += times[x].date.toString("yyyy-M-d") + ":::" +
-      times[x].time.toString("hh:mm") + "\n";
+    *_msg += times[x].date().toString("yyyy-M-d") + ":::" +
+      times[x].time().toString("hh:mm") + "\n";
   }
   return true;
 }
 
-bool worker_node::suggest_group_events(
+/**
+ * @brief Collect the busy times of a group's members.
+ *
+ * The busy times of every member, from now up to the deadline,
+ * come from a single query, and are marked on a bitset per
+ * member (see availability).
+ *
+ * @param owner The group.
+ * @param deadline_date Day the event must happen by.
+ * @param deadline_time Time the event must be over by, that day.
+ * @param duration Length of the event, in minutes.
+ * @param _length Set to the length of the event.
+ * @return The group's availability (the caller deletes it), or NULL.
+ */
+availability * worker_node::group_availability(
   const QString & owner,
   const QString & deadline_date,
   const QString & deadline_time,
   const QString & duration,
-  QString * _msg)
+  int & _length)
 {
-  QSet<calendar_event> group_times;
-  QString * p_users;       /* @todo delete me! */
+  QDateTime now = QDateTime::currentDateTime();
+  QDate last_date = QDate::fromString(deadline_date, "yyyy-M-d");
+  QTime last_time = QTime::fromString(deadline_time, "hh:mm");
+  bool ok; _length = duration.toInt(&ok);
+  if (!last_date.isValid() || !last_time.isValid() || !ok || _length <= 0) {
+    throw std::invalid_argument("invalid deadline or duration");
+  }
 
-  /**
-   * First, obtain a list of all users in the group.
-   * Should probably just do the damn query, but...
-   * I already wrote it down there and I'm lazy.
-   */
-  if (!list_group_users(owner, p_users = new QString())) {
-    /* if this fails, something is pretty messed up... */
-    *_msg = "Please tell Hunter that\n"
-      "the thing he thought wouldn't\n"
-      "happen happened...\n";
-    return true;
+  /* each member gets a busy bitset of their own, members with nothing on included */
+  QStringList names;
+  if (!group_members(owner, names)) {return NULL;}
+  QHash<QString, int> members;
+  for (const QString & name : names) {members.insert(name, members.size());}
+
+  QSqlDatabase db = m_p_db_pool->acquire();
+  if (!db.isOpen()) {
+    std::cerr << "Error! Failed to open database connection!" << std::endl;
+    return NULL;
   }
 
-  QStringList users = p_users->split("\n");
-  QString empty = ""; users.removeAll(empty);
+  /* a year of 5 minute slots is about 13 KiB a member */
+  if (last_date > now.date().addDays(MAX_HORIZON_DAYS)) {
+    last_date = now.date().addDays(MAX_HORIZON_DAYS);
+  }
 
-  /* free p_users, as it is no longer needed */
-  delete p_users;
+  QSqlQuery * query = m_p_db_pool->statement("group_busy");
+  if (query == NULL) {throw std::invalid_argument("failed to prepare the query");}
+  query->bindValue(0, owner);
+  /* yesterday's events may run past midnight */
+  query->bindValue(1, now.date().addDays(-1));
+  query->bindValue(2, last_date);
 
-  for (int x = 0; x < users.size(); ++x) {
-    /* grab the current user's events */
-    QSet<calendar_event> suggestions;
-    suggestions = suggest_event_times(users[x], deadline_date,
-        deadline_time, duration);
-    /**
-     * Union the user's free times with the current
-     * group pool. We don't intersect here, since
-     * the suggested times we received for each user
-     * is not a complete list... It's only a mere
-     * approximation.
-     *
-     * P.S. Why the fuck is "|=" the union operator?
-     * Also, why is the union function called unite?
-     *
-     * Come on, Qt...
-     */
-    group_times |= suggestions;
+  if (!m_p_db_pool->exec(query)) {
+    std::cerr << "Query Failed to execute!" << std::endl;
+    std::cerr << "query: \"" << query->lastQuery().toStdString() << "\"" << std::endl;
+    throw std::invalid_argument("failed to query the group's schedules");
+    return NULL;
   }
 
-  /**
-   * Next we iterate through the group times set, removing
-   * times that do not work for ALL group members.
-   */
-  QList<calendar_event> temp = group_times.toList();
-  for (int x = 0; x < users.size(); ++x) {
-    for (int y = 0; y < temp.size(); ++y) {
-      if (!is_valid_for_user(users[x], temp[y])) {group_times -= temp[y];}
-    }
+  availability * p_group = new availability(availability::minute(now.date(), now.time()),
+    availability::minute(last_date, last_time));
+  p_group->set_hours(DAY_START, DAY_END);
+  p_group->set_members(names.size());
+  for (; query->next(); ) {
+    QString name = query->value(0).toString();
+    int member = members.value(name, members.size());
+    members.insert(name, member);
+    qint64 start = availability::minute(query->value(1).toDate(), query->value(2).toTime());
+    QTime length = query->value(3).toTime();
+    p_group->add_busy(member, start, start + length.hour() * 60 + length.minute());
   }
+  return p_group;
+}
+
+/**
+ * @brief Suggest times everyone in a group is free.
+ *
+ * The members' busy bitsets are ORed together, and each free
+ * stretch within working hours that fits the event is
+ * suggested, at its start.
+ *
+ * @param owner The group.
+ * @param deadline_date Day the event must happen by.
+ * @param deadline_time Time the event must be over by, that day.
+ * @param duration Length of the event, in minutes.
+ * @param _msg Filled with "<date>:::<time>" lines.
+ * @return True if the suggestions were made.
+ */
+bool worker_node::suggest_group_events(
+  const QString & owner,
+  const QString & deadline_date,
+  const QString & deadline_time,
+  const QString & duration,
+  QString * _msg)
+{
+  int len;
+  availability * p_group = group_availability(owner, deadline_date, deadline_time, duration, len);
+  if (p_group == NULL) {return false;}
+  QVector<availability::slot> slots = p_group->free(len);
+  delete p_group;
 
   /* write back the request */
-  if (!group_times.size()) {
+  if (slots.isEmpty()) {
     *_msg = "\n";
     return true;
   }
 
-  /* return the list of times that work for everyone */
-  QSet<calendar_event>::iterator i;
-  for (i = group_times.begin(); i != group_times.end(); ++i) {
-    *_msg += i->date.toString("yyyy-M-d") + ":::" +
-      i->time.toString("hh:mm") + "\n";
+  for (const availability::slot & free_slot : slots) {
+    *_msg += availability::date_of(free_slot.start).toString("yyyy-M-d") + ":::" +
+      availability::time_of(free_slot.start).toString("hh:mm") + "\n";
   }
   return true;
 }
 
-bool worker_node::list_user_month_events(
+/**
+ * @brief Suggest times enough of a group is free.
+ *
+ * Like suggest_group_events, but a time only needs _minimum
+ * members free for all of it. The best QUORUM_SUGGESTIONS
+ * times come back, most members first, then earliest.
+ *
+ * @param owner The group.
+ * @param deadline_date Day the event must happen by.
+ * @param deadline_time Time the event must be over by, that day.
+ * @param duration Length of the event, in minutes.
+ * @param minimum Fewest members that must be able to come.
+ * @param _msg Filled with "<date>:::<time>:::<members free>" lines.
+ * @return True if the suggestions were made.
+ */
+bool worker_node::suggest_quorum_events(
   const QString & owner,
-  const quint8 & month,
-  const quint16 & year,
+  const QString & deadline_date,
+  const QString & deadline_time,
+  const QString & duration,
+  const QString & minimum,
   QString * _msg)
 {
-  if (!m_db.open()) {
-    std::cerr << "Error! Failed to open database connection!" << std::endl;
-    return false;
-  } else if (!owner.size()) {return false;}
-  QString start_date = QString().setNum(year) + "-" + QString().setNum(month) + "-01";
-  QString end_date = QString().setNum((month == 12 ? year + 1 : year)) +
-    "-" + QString().setNum((month == 12 ? 1 : (month + 1))) + "-01";
-  QSqlQuery query(m_db);
-  QString query_text = QString("SELECT schedule_item.date FROM schedule_item, schedules "
-      "WHERE schedules.owner = '") + owner + "'" +
-    "AND schedule_item.date >= '" + start_date + "'" +
-    "AND schedule_item.date < '" + end_date +
-    "' AND schedule_item.schedule_id = schedules.schedule_id;";
-  query.prepare(query_text);
+  bool ok; int least = minimum.toInt(&ok);
+  if (!ok || least <= 0) {throw std::invalid_argument("invalid member count");}
 
-  if (!query.exec()) {
-    std::cerr << "Query Failed to execute!" << std::endl;
-    std::cerr << "query: \"" << query.lastQuery().toStdString() << "\"" << std::endl;
-    throw std::invalid_argument("failed to query the user's groups");
-    return false;
-  } else if (!query.size()) {
-    *_msg = "0\n";
+  int len;
+  availability * p_group = group_availability(owner, deadline_date, deadline_time, duration, len);
+  if (p_group == NULL) {return false;}
+  QVector<availability::choice> choices = p_group->quorum(len, least, QUORUM_SUGGESTIONS);
+  delete p_group;
+
+  /* write back the request */
+  if (choices.isEmpty()) {
+    *_msg = "\n";
     return true;
   }
-  int number = 0;
 
-  QStringList list;
-  for (; query.next(); ) {
-    list = query.value(0).toString().split("-");
-    number = (number | (1 << (list[2].toInt())));
+  for (const availability::choice & option : choices) {
+    *_msg += availability::date_of(option.start).toString("yyyy-M-d") + ":::" +
+      availability::time_of(option.start).toString("hh:mm") + ":::" +
+      QString::number(option.attendance) + "\n";
   }
-  _msg->setNum(number); *(_msg) += "\n";
+  return true;
+}
+
+bool worker_node::list_user_month_events(
+  const QString & owner,
+  const quint8 & month,
+  const quint16 & year,
+  QString * _msg)
+{
+  if (!owner.size()) {return false;}
+
+  /* the cache keeps a bitmap per month, so this is one lookup */
+  quint32 days = 0;
+  QDate first(year, month, 1);
+  if (first.isValid() && !m_p_schedules->month(owner, year, month, days)) {
+    quint64 generation = m_p_schedules->generation();
+    schedule_cache::items events;
+    /* not worth loading the whole schedule for: read the month, and keep its bitmap */
+    if (!load_schedule(owner, first, first.addMonths(1).addDays(-1), events)) {return false;}
+    days = schedule_cache::days(events);
+    m_p_schedules->insert_month(owner, year, month, days, generation);
+  }
+  /* day 31 lands in the sign bit, as it always has */
+  _msg->setNum((qint32) days); *(_msg) += "\n";
   return true;
 }
 
@@ -763,12 +1094,13 @@ bool worker_node::list_user_month_events(
  */
 bool worker_node::list_groups(const QString & user_name, QString * _msg)
 {
-  if (!m_db.open()) {
+  QSqlDatabase db = m_p_db_pool->acquire();
+  if (!db.isOpen()) {
     std::cerr << "Error! Failed to open database connection!" << std::endl;
     return false;
   } else if (!user_name.size()) {return false;}
 
-  QSqlQuery query(m_db);
+  QSqlQuery query(db);
   query.prepare("SELECT groups.group_name FROM groups, users,"
     " user_group_relation WHERE users.user_name = ? "
     "AND user_group_relation.user_id = users.user_id "
@@ -799,12 +1131,44 @@ bool worker_node::list_groups(const QString & user_name, QString * _msg)
  */
 bool worker_node::list_group_users(const QString & group_name, QString * _msg)
 {
-  if (!m_db.open()) {
+  QSqlDatabase db = m_p_db_pool->acquire();
+  if (!db.isOpen()) {
     std::cerr << "Error! Failed to open database connection!" << std::endl;
     return false;
   } else if (!group_name.size()) {return false;}
 
-  QSqlQuery query(m_db);
+  QStringList members;
+  if (!group_members(group_name, members)) {return false;}
+  if (members.isEmpty()) {
+    *_msg += "\n";
+    return true;
+  }
+
+  for (const QString & member : members) {
+    *_msg += member + "\n";
+  }
+  return true;
+}
+
+/**
+ * @brief Get the users in a group, from the cache if we can.
+ *
+ * @param group_name Group name.
+ * @param _members Filled with the members.
+ * @return True if the members were found.
+ */
+bool worker_node::group_members(const QString & group_name, QStringList & _members)
+{
+  if (m_p_membership->members(group_name, _members)) {return true;}
+  quint64 generation = m_p_membership->generation();
+
+  QSqlDatabase db = m_p_db_pool->acquire();
+  if (!db.isOpen()) {
+    std::cerr << "Error! Failed to open database connection!" << std::endl;
+    return false;
+  }
+
+  QSqlQuery query(db);
   query.prepare("SELECT users.user_name FROM groups, users,"
     " user_group_relation WHERE groups.group_name = ? "
     "AND user_group_relation.user_id = users.user_id "
@@ -816,14 +1180,10 @@ bool worker_node::list_group_users(const QString & group_name, QString * _msg)
     std::cerr << "query: \"" << query.lastQuery().toStdString() << "\"" << std::endl;
     throw std::invalid_argument("failed to query the user's groups");
     return false;
-  } else if (!query.size()) {
-    *_msg += "\n";
-    return true;
   }
 
-  for (; query.next(); ) {
-    *_msg += query.value(0).toString() + "\n";
-  }
+  for (; query.next(); ) {_members.append(query.value(0).toString());}
+  m_p_membership->insert(group_name, _members, generation);
   return true;
 }
 
@@ -835,12 +1195,13 @@ bool worker_node::list_group_users(const QString & group_name, QString * _msg)
  */
 bool worker_node::get_account_info(const QString & user_name, QString * _msg)
 {
-  if (!m_db.open()) {
+  QSqlDatabase db = m_p_db_pool->acquire();
+  if (!db.isOpen()) {
     std::cerr << "Error! Failed to open database connection!" << std::endl;
     return false;
   } else if (!user_name.size()) {return false;}
 
-  QSqlQuery query(m_db);
+  QSqlQuery query(db);
   query.prepare("SELECT email, cellphone FROM users WHERE user_name = ?");
   query.bindValue(0, user_name);
 
@@ -869,26 +1230,34 @@ bool worker_node::update_user(
   const QString & _new_pass, const QString & _new_user,
   const QString & _new_mail, const QString & _new_cell)
 {
-  if (!m_db.open()) {
+  QSqlDatabase db = m_p_db_pool->acquire();
+  if (!db.isOpen()) {
     std::cerr << "Error! Failed to open database connection!" << std::endl;
     return false;
   } else if (!(_old_user.size() && _old_pass.size() && _new_pass.size() &&
     _new_user.size() && _new_mail.size())) {return false;}
 
-  QSqlQuery query(m_db);
+  QSqlQuery query(db);
   query.prepare("UPDATE users SET user_name = ?, passwd = ?,"
     "email = ?, cellphone = ? WHERE user_name = ? AND passwd = ?");
   query.bindValue(0, _new_user); query.bindValue(1, _new_pass);
   query.bindValue(2, _new_mail); query.bindValue(3, _new_cell);
   query.bindValue(4, _old_user); query.bindValue(5, _old_pass);
 
-  if (!query.exec()) {
+  bool ok = query.exec();
+  /* only now, so a login racing the update can not cache the old password */
+  m_p_auth_cache->invalidate(_old_user); m_p_auth_cache->invalidate(_new_user);
+  m_p_tokens->revoke(_old_user); m_p_tokens->revoke(_new_user);
+  m_p_membership->invalidate_user(_old_user);
+  m_p_schedules->invalidate(_old_user); m_p_schedules->invalidate(_new_user);
+  if (!ok) {
     std::cerr << "Query Failed to execute!" << std::endl;
     std::cerr << "query: \"" << query.lastQuery().toStdString() << "\"" << std::endl;
     throw std::invalid_argument("something failed during procedure call");
     return false;
   }
-  return true;
+  /* no row means the old name and password did not match */
+  return query.numRowsAffected() > 0;
 }
 
 /**
@@ -899,49 +1268,44 @@ bool worker_node::update_user(
  */
 bool worker_node::insert_user(user & u)
 {
-  if (!m_db.open()) {
+  QSqlDatabase db = m_p_db_pool->acquire();
+  if (!db.isOpen()) {
     std::cerr << "Error! Failed to open database connection!" << std::endl;
     return false;
   } else if (!u.get_username().size()) {return false;}
 
-  QSqlQuery * query = new QSqlQuery(m_db);
-  QString user_query_string = "INSERT INTO users(user_name, schedule_id, passwd, email)";
-  QString schedule_item_string = "INSERT INTO schedules(owner) VALUES(";
-  schedule_item_string += "'" + u.get_username() + "');";
-
-  query->prepare(schedule_item_string);
-  if (!query->exec()) {
+  QSqlQuery * query = m_p_db_pool->statement("insert_schedule");
+  if (query == NULL) {throw std::invalid_argument("failed to prepare the insert query");}
+  query->bindValue(0, u.get_username());
+  if (!m_p_db_pool->exec(query)) {
     std::cerr << "Query Failed to execute!" << std::endl;
     std::cerr << "query: \"" << query->lastQuery().toStdString() << "\"" << std::endl;
-    delete query;
     throw std::invalid_argument("something failed in the insert query");
     return false;
   }
-  delete query;
 
   if (!select_schedule_id(u)) {throw std::invalid_argument("Something bad happened!");}
+  m_p_schedules->invalidate(u.get_username());
 
-  user_query_string += " VALUES('" + u.get_username() + "', '" + u.get_schedule_id() +
-    "', '" + u.get_password() + "', '" + u.get_email() + "');";
-
-  query = new QSqlQuery(m_db);
-  query->prepare(user_query_string);
-  if (!query->exec()) {
+  query = m_p_db_pool->statement("insert_user");
+  if (query == NULL) {throw std::invalid_argument("failed to prepare the insert query");}
+  query->bindValue(0, u.get_username()); query->bindValue(1, u.get_schedule_id());
+  query->bindValue(2, u.get_password()); query->bindValue(3, u.get_email());
+  if (!m_p_db_pool->exec(query)) {
     std::cerr << "Query Failed to execute!" << std::endl;
     std::cerr << "query: \"" << query->lastQuery().toStdString() << "\"" << std::endl;
     std::string str = "Something failed in insert query:\n" +
       query->lastQuery().toStdString();
-    delete query;
     throw std::invalid_argument(str);
     return false;
   }
-  delete query;
   return true;
 }
 
 bool worker_node::username_exists(const QString & _user)
 {
-  if (!m_db.open()) {
+  QSqlDatabase db = m_p_db_pool->acquire();
+  if (!db.isOpen()) {
     std::cerr << "Error! Failed to open database connection!" << std::endl;
     /**
      * @todo probably shouldn't return false here
@@ -949,22 +1313,21 @@ bool worker_node::username_exists(const QString & _user)
     return true;
   }
 
-  QSqlQuery * query = new QSqlQuery(m_db);
-  QString text = "SELECT * FROM users WHERE user_name = '" +
-    _user + "';";
+  QSqlQuery * query = m_p_db_pool->statement("username_exists");
+  if (query == NULL) {throw std::invalid_argument("failed to prepare the select query");}
+  query->bindValue(0, _user);
 
-  if (!query->exec(text)) {
+  if (!m_p_db_pool->exec(query)) {
     std::cerr << "Query failed to execute!" << std::endl;
     std::cerr << "query: \"" << query->lastQuery().toStdString() << "\"" << std::endl;
-    text = "Something failed in select query:\n" + text;
-    std::string str = text.toStdString(); delete query;
-    throw std::invalid_argument(str);
+    QString text = "Something failed in select query:\n" + query->lastQuery();
+    throw std::invalid_argument(text.toStdString());
     /**
      * @todo again, probably should not return false.
      */
     return true;
-  } else if (query->size()) {return delete query, true;}
-  return delete query, false;
+  }
+  return query->size() > 0;
 }
 
 bool worker_node::reset_password(
@@ -972,13 +1335,14 @@ bool worker_node::reset_password(
   QString & _p_email,
   QString & _p_new_psswd)
 {
-  if (!m_db.open()) {
+  QSqlDatabase db = m_p_db_pool->acquire();
+  if (!db.isOpen()) {
     std::cerr << "Error! Failed to open database connection!" << std::endl;
     return false;
   } else if (!(_p_user.size() &&
     _p_email.size() &&
     _p_new_psswd.size())) {return false;}
-  QSqlQuery q(m_db);
+  QSqlQuery q(db);
   q.prepare("SELECT DISTINCT email FROM users WHERE user_name = ?");
   q.bindValue(0, _p_user);
 
@@ -1000,13 +1364,16 @@ bool worker_node::reset_password(
   QString email = _email.toString();
   if (QString::compare(_p_email, email) != 0) {return false;}
 
-  QSqlQuery query(m_db);
+  QSqlQuery query(db);
   query.prepare("UPDATE users SET passwd = ? "
     "WHERE user_name = ? AND email = ?");
   query.bindValue(0, _p_new_psswd); query.bindValue(1, _p_user);
   query.bindValue(2, _p_email);
 
-  if (!query.exec()) {
+  bool ok = query.exec();
+  m_p_auth_cache->invalidate(_p_user);
+  m_p_tokens->revoke(_p_user);
+  if (!ok) {
     std::cerr << "Query Failed to execute!" << std::endl;
     std::cerr << "query: \"" << query.lastQuery().toStdString() << "\"" << std::endl;
     throw std::invalid_argument("something failed during procedure call");
@@ -1017,24 +1384,23 @@ bool worker_node::reset_password(
 
 bool worker_node::select_schedule_id(user & u)
 {
-  if (!m_db.open()) {
+  QSqlDatabase db = m_p_db_pool->acquire();
+  if (!db.isOpen()) {
     std::cerr << "Error! Failed to open database connection!" << std::endl;
     return false;
   }
 
-  QSqlQuery * query = new QSqlQuery(m_db);
+  QSqlQuery * query = m_p_db_pool->statement("select_schedule_id");
+  if (query == NULL) {throw std::invalid_argument("failed to prepare the select query");}
+  query->bindValue(0, u.get_username());
 
-  QString schedule_select = "SELECT DISTINCT schedule_id FROM schedules WHERE ";
-  schedule_select += "owner = '" + u.get_username() + "';";
-
-  if (!query->exec(schedule_select)) {
+  if (!m_p_db_pool->exec(query)) {
     std::cerr << "Query failed to execute!" << std::endl;
     std::cerr << "query: \"" << query->lastQuery().toStdString() << "\"" << std::endl;
-    schedule_select = "Something failed in select query:\n" + schedule_select;
-    std::string str = schedule_select.toStdString(); delete query;
-    throw std::invalid_argument(str);
+    QString schedule_select = "Something failed in select query:\n" + query->lastQuery();
+    throw std::invalid_argument(schedule_select.toStdString());
     return false;
-  } else if (!query->size()) {return delete query, false;}
+  } else if (!query->size()) {return false;}
 
   /* now extract the schedule id and set in our referenced object */
   register int sched_id_col = query->record().indexOf("schedule_id");
@@ -1042,28 +1408,27 @@ bool worker_node::select_schedule_id(user & u)
   if (sched_id_col != -1) {u.set_schedule_id(query->value(sched_id_col).toString());} else {
     throw std::invalid_argument("No schedule_id column returned");
   }
-  return delete query, true;
+  return true;
 }
 
 bool worker_node::select_user(user & u)
 {
-  if (!m_db.open()) {
+  QSqlDatabase db = m_p_db_pool->acquire();
+  if (!db.isOpen()) {
     std::cerr << "Error! Failed to open database connection!" << std::endl;
     return false;
   }
 
-  QSqlQuery * query = new QSqlQuery(m_db);
+  QSqlQuery * query = m_p_db_pool->statement("select_user");
+  if (query == NULL) {throw std::invalid_argument("failed to prepare the select query");}
+  query->bindValue(0, u.get_username());
+  query->bindValue(1, u.get_password());
 
-  QString user_stuff = "SELECT DISTINCT user_id, schedule_id, email, cellphone FROM users WHERE ";
-  user_stuff += "user_name = '" + u.get_username() + "' AND passwd = '" + u.get_password() + "';";
-
-  if (!query->exec(user_stuff)) {
+  if (!m_p_db_pool->exec(query)) {
     std::cerr << "Query Failed to execute!" << std::endl;
     std::cerr << "query: \"" << query->lastQuery().toStdString() << "\"" << std::endl;
-    delete query;
-    user_stuff = "Something failed in select query:\n" + user_stuff;
-    std::string str = user_stuff.toStdString();
-    throw std::invalid_argument(str);
+    QString user_stuff = "Something failed in select query:\n" + query->lastQuery();
+    throw std::invalid_argument(user_stuff.toStdString());
     return false;
   } else if (!query->size()) {return false;}
 
@@ -1097,7 +1462,6 @@ bool worker_node::select_user(user & u)
     if (db_cell.size()) {u.set_cell(db_cell);}
     u.set_schedule_id(db_schedule_id);
   }
-  delete query;
   return true;
 }
 
@@ -1112,12 +1476,13 @@ bool worker_node::create_personal_event(
   const QString & immutable
 )
 {
-  if (!m_db.open()) {
+  QSqlDatabase db = m_p_db_pool->acquire();
+  if (!db.isOpen()) {
     std::cerr << "Error! Failed to open database connection!" << std::endl;
     return false;
   }
 
-  QSqlQuery query(m_db);
+  QSqlQuery query(db);
   query.prepare("CALL AddPersonalEvent(?, ?, ?, ?, ?, ?, ?, ?, @success)");
 
   /* convert minutes to a time */
@@ -1155,7 +1520,9 @@ bool worker_node::create_personal_event(
   }
   query.next();
 
-  return query.value(0).toBool();
+  bool added = query.value(0).toBool();
+  if (added) {refresh_schedule_day(user, date);}
+  return added;
 }
 
 /**
@@ -1171,28 +1538,13 @@ bool worker_node::user_in_group(
   const QString & group
 )
 {
-  if (!m_db.open()) {
-    std::cerr << "Error! Failed to open database connection!" << std::endl;
-    return false;
-  }
-
-  QSqlQuery query(m_db);
-  query.prepare("SELECT count(*) FROM users, user_group_relation, "
-    "groups WHERE users.user_id = user_group_relation.user_id "
-    "AND groups.group_id = user_group_relation.group_id "
-    "AND users.user_name = ? "
-    "AND groups.group_name = ?");
-  query.bindValue(0, user);     query.bindValue(1, group);
-
-  if (!query.exec()) {
-    std::cerr << "Query Failed to execute!" << std::endl;
-    std::cerr << "query: \"" << query.lastQuery().toStdString() << "\"" << std::endl;
-    throw std::invalid_argument("something failed during procedure call");
-    return false;
-  }
-  query.next();
+  bool member = false;
+  if (m_p_membership->find(group, user, member)) {return member;}
 
-  return query.value(0).toBool();
+  /* load the whole group once, rather than join for every user */
+  QStringList members;
+  if (!group_members(group, members)) {return false;}
+  return members.contains(user, Qt::CaseInsensitive);
 }
 
 /**
@@ -1216,16 +1568,85 @@ bool worker_node::try_create(
 /**
  * @brief Try to login.
  *
+ * A session token from REQUEST_LOGIN may be given in place
+ * of the password; it is checked without the database. So are
+ * credentials the database accepted in the last few seconds.
+ *
  * @param _user Encrypted username.
- * @param _password Encrypted password.
+ * @param _password Encrypted password, or a session token.
  * @return True upon authentication.
  */
 bool worker_node::try_login(const QString & _user, const QString & _password)
 {
+  if (session_token::is_token(_password)) {return verify_token(_user, _password);}
+  if (m_p_auth_cache->contains(_user, _password)) {return true;}
+  quint64 generation = m_p_auth_cache->generation();
+
   user u;       /* temporary user to fill. set username and password. */
   u.set_username(_user); u.set_password(_password);
 
-  return select_user(u);
+  if (!select_user(u)) {return false;}
+  m_p_auth_cache->insert(_user, _password, generation);
+  return true;
+}
+
+/**
+ * @brief Issue a session token to a user who just logged in.
+ *
+ * @param _user The username.
+ * @return The token, or an empty string if the user is gone.
+ */
+QString worker_node::issue_token(const QString & _user)
+{
+  QByteArray stamp;
+  if (!credential_stamp(_user, stamp)) {return QString();}
+  return m_p_tokens->issue(_user, stamp);
+}
+
+/**
+ * @brief Check a session token presented in place of a password.
+ *
+ * @param _user The username.
+ * @param _token The token.
+ * @return True if the token is good, and the password it was
+ *   issued under has not changed since.
+ */
+bool worker_node::verify_token(const QString & _user, const QString & _token)
+{
+  QByteArray stamp;
+  return credential_stamp(_user, stamp) && m_p_tokens->verify(_user, _token, stamp);
+}
+
+/**
+ * @brief Get a user's credential stamp (see session_token).
+ *
+ * @param _user The username.
+ * @param _stamp Set to the stamp.
+ * @return False if there is no such user.
+ */
+bool worker_node::credential_stamp(const QString & _user, QByteArray & _stamp)
+{
+  if (m_p_tokens->known_stamp(_user, _stamp)) {return true;}
+  quint64 generation = m_p_tokens->generation();
+
+  QSqlDatabase db = m_p_db_pool->acquire();
+  if (!db.isOpen()) {
+    std::cerr << "Error! Failed to open database connection!" << std::endl;
+    return false;
+  }
+  QSqlQuery * query = m_p_db_pool->statement("select_passwd");
+  if (query == NULL) {throw std::invalid_argument("failed to prepare the select query");}
+  query->bindValue(0, _user);
+  if (!m_p_db_pool->exec(query)) {
+    std::cerr << "Query Failed to execute!" << std::endl;
+    std::cerr << "query: \"" << query->lastQuery().toStdString() << "\"" << std::endl;
+    throw std::invalid_argument("something failed in the select query");
+    return false;
+  } else if (!query->next()) {return false;}
+
+  _stamp = session_token::stamp(query->value(0).toString());
+  m_p_tokens->remember_stamp(_user, _stamp, generation);
+  return true;
 }
 
 /**
@@ -1238,14 +1659,18 @@ bool worker_node::try_login(const QString & _user, const QString & _password)
  */
 bool worker_node::cleanup_db_insert()
 {
-  if (!m_db.open()) {
+  QSqlDatabase db = m_p_db_pool->acquire();
+  if (!db.isOpen()) {
     std::cerr << "Error! Failed to open database connection!" << std::endl;
     return false;
   }
   /* now we remove the inserted */
+  m_p_auth_cache->invalidate("billy");
+  m_p_schedules->invalidate("billy");
+  m_p_membership->invalidate_user("billy");
   QString delete_user = "DELETE FROM users WHERE user_name = 'billy'";
   QString delete_schedule_item = "DELETE FROM schedules WHERE owner = 'billy'";
-  QSqlQuery * query = new QSqlQuery(m_db);
+  QSqlQuery * query = new QSqlQuery(db);
   query->prepare(delete_user);
 
   if (!query->exec()) {
@@ -1257,7 +1682,7 @@ bool worker_node::cleanup_db_insert()
   }
   delete query;
 
-  query = new QSqlQuery(m_db);
+  query = new QSqlQuery(db);
   query->prepare(delete_schedule_item);
 
   if (!query->exec()) {
@@ -1275,12 +1700,13 @@ bool worker_node::delete_friend(
   const QString & _user,
   const QString & _friend)
 {
-  if (!m_db.open()) {
+  QSqlDatabase db = m_p_db_pool->acquire();
+  if (!db.isOpen()) {
     std::cerr << "Error! Failed to open database connection!" << std::endl;
     return false;
   } else if (_user.size() == 0 || _friend.size() == 0) {return false;}
 
-  QSqlQuery query(m_db);
+  QSqlQuery query(db);
   QString txt = "CALL DeleteFriend(\'";
   txt += _user + "\', \'" + _friend + "\', " + "@success);";
   std::cerr << "txt = " << txt.toStdString() << std::endl;
@@ -1304,33 +1730,26 @@ bool worker_node::delete_friend(
 
 bool worker_node::friends(const QString & _user, QString * _msg)
 {
-  if (!m_db.open()) {
+  QSqlDatabase db = m_p_db_pool->acquire();
+  if (!db.isOpen()) {
     std::cerr << "Error! Failed to open database connection!" << std::endl;
     return false;
   } else if (_user.size() == 0) {return false;}
 
-  QSqlQuery query(m_db);
-  QString txt = "SELECT DISTINCT u2.user_name ";
-  txt += "FROM users u1, users u2, user_friend_relation ";
-  txt += "WHERE u1.user_name = '" + _user + "' AND ";
-  txt += "((user_friend_relation.user_id = u1.user_id AND ";
-  txt += "user_friend_relation.friend_id = u2.user_id) OR ";
-  txt += "(user_friend_relation.friend_id = u1.user_id AND ";
-  txt += "user_friend_relation.user_id = u2.user_id)) AND ";
-  txt += "u2.user_name != '" + _user + "' AND ";
-  txt += "user_friend_relation.accepted = 1;";
-  std::cerr << "txt = " << txt.toStdString() << std::endl;
-  query.prepare(txt);
+  QSqlQuery * query = m_p_db_pool->statement("friends");
+  if (query == NULL) {throw std::invalid_argument("failed to prepare the query");}
+  query->bindValue(0, _user);
+  query->bindValue(1, _user);
 
-  if (!query.exec()) {
+  if (!m_p_db_pool->exec(query)) {
     std::cerr << "Query Failed to execute!" << std::endl;
-    std::cerr << "query: \"" << query.lastQuery().toStdString() << "\"" << std::endl;
+    std::cerr << "query: \"" << query->lastQuery().toStdString() << "\"" << std::endl;
     throw std::invalid_argument("something failed during procedure call");
     return false;
   }
 
-  for (; query.next(); ) {
-    *_msg += query.value(0).toString() + "\n";
+  for (; query->next(); ) {
+    *_msg += query->value(0).toString() + "\n";
   }
   std::cerr << "_msg = " << _msg->toStdString() << std::endl;
   return true;
@@ -1338,12 +1757,13 @@ bool worker_node::friends(const QString & _user, QString * _msg)
 
 bool worker_node::friend_requests(const QString & _user, QString * _msg)
 {
-  if (!m_db.open()) {
+  QSqlDatabase db = m_p_db_pool->acquire();
+  if (!db.isOpen()) {
     std::cerr << "Error! Failed to open database connection!" << std::endl;
     return false;
   } else if (_user.size() == 0) {return false;}
 
-  QSqlQuery query(m_db);
+  QSqlQuery query(db);
   QString txt = "SELECT DISTINCT u2.user_name FROM ";
   txt += "users u1, users u2, user_friend_relation ";
   txt += "WHERE u1.user_name = '" + _user + "' AND ";
@@ -1370,12 +1790,13 @@ bool worker_node::friend_requests(const QString & _user, QString * _msg)
 
 bool worker_node::accept_friend(const QString & _user, const QString & _friend)
 {
-  if (!m_db.open()) {
+  QSqlDatabase db = m_p_db_pool->acquire();
+  if (!db.isOpen()) {
     std::cerr << "Error! Failed to open database connection!" << std::endl;
     return false;
   } else if (_user.size() == 0 || _friend.size() == 0) {return false;}
 
-  QSqlQuery query(m_db);
+  QSqlQuery query(db);
   QString txt = "CALL AcceptFriend(\'";
   txt += _user + "\', \'" + _friend + "\', " + "@success);";
   std::cerr << "txt = " << txt.toStdString() << std::endl;
@@ -1409,7 +1830,8 @@ bool worker_node::create_friendship(
   const QString & _user,
   const QString & _friend)
 {
-  if (!m_db.open()) {
+  QSqlDatabase db = m_p_db_pool->acquire();
+  if (!db.isOpen()) {
     std::cerr << "Error! Failed to open database connection!" << std::endl;
     return false;
   }
@@ -1418,7 +1840,7 @@ bool worker_node::create_friendship(
     return false;
   }
 
-  QSqlQuery query(m_db);
+  QSqlQuery query(db);
   QString txt = "CALL AddFriend(\'";
   txt += _user + "\', \'" + _friend + "\', " + "@success);";
   std::cerr << "txt = " << txt.toStdString() << std::endl;
@@ -1442,17 +1864,20 @@ bool worker_node::create_friendship(
 
 bool worker_node::cleanup_group_insert()
 {
-  if (!m_db.open()) {
+  QSqlDatabase db = m_p_db_pool->acquire();
+  if (!db.isOpen()) {
     std::cerr << "Error! Failed to open database connection!" << std::endl;
     return false;
   }
 
   /* now we remove the inserted */
+  m_p_membership->invalidate_group("billy group");
+  m_p_schedules->invalidate("billy group");
   QString delete_group = "DELETE FROM groups WHERE group_name = 'billy group';";
   QString delete_schedule_item = "DELETE FROM schedules WHERE owner = 'billy group';";
   /* @todo remove from group */
   /* QString delete_relation = "CALL RemoveFromGroup(?, ?, @success) */
-  QSqlQuery * query = new QSqlQuery(m_db);
+  QSqlQuery * query = new QSqlQuery(db);
   query->prepare(delete_group);
 
   if (!query->exec()) {
@@ -1464,7 +1889,7 @@ bool worker_node::cleanup_group_insert()
   }
   delete query;
 
-  query = new QSqlQuery(m_db);
+  query = new QSqlQuery(db);
   query->prepare(delete_schedule_item);
 
   if (!query->exec()) {
@@ -1480,12 +1905,13 @@ bool worker_node::cleanup_group_insert()
 
 bool worker_node::present(const QString & _user)
 {
-  if (!m_db.open()) {
+  QSqlDatabase db = m_p_db_pool->acquire();
+  if (!db.isOpen()) {
     std::cerr << "Error! Failed to open database connection!" << std::endl;
     return false;
   } else if (_user.size() == 0) {return false;}
 
-  QSqlQuery query(m_db);
+  QSqlQuery query(db);
   query.prepare("UPDATE users SET absent = 0 "
     "WHERE user_name = ? ");
   query.bindValue(0, _user);
@@ -1501,12 +1927,13 @@ bool worker_node::present(const QString & _user)
 
 bool worker_node::absent(const QString & _user)
 {
-  if (!m_db.open()) {
+  QSqlDatabase db = m_p_db_pool->acquire();
+  if (!db.isOpen()) {
     std::cerr << "Error! Failed to open database connection!" << std::endl;
     return false;
   } else if (_user.size() == 0) {return false;}
 
-  QSqlQuery query(m_db);
+  QSqlQuery query(db);
   query.prepare("UPDATE users SET absent = 1 "
     "WHERE user_name = ? ");
   query.bindValue(0, _user);
@@ -1522,12 +1949,13 @@ bool worker_node::absent(const QString & _user)
 
 bool worker_node::cleanup_user_group_insert()
 {
-  if (!m_db.open()) {
+  QSqlDatabase db = m_p_db_pool->acquire();
+  if (!db.isOpen()) {
     std::cerr << "Error! Failed to open database connection!" << std::endl;
     return false;
   }
 
-  QSqlQuery query2(m_db);
+  QSqlQuery query2(db);
   query2.prepare("CALL RemoveFromGroup(?, ?, @success)");
   query2.bindValue(0, "billy group");
   query2.bindValue(1, "billy");
@@ -1548,11 +1976,13 @@ bool worker_node::cleanup_user_group_insert()
   if (!query2.value(0).toBool()) {return false;}
 
   /* now we remove the inserted */
+  m_p_membership->invalidate_group("billy group");
+  m_p_schedules->invalidate("billy group");
   QString delete_group = "DELETE FROM groups WHERE group_name = 'billy group';";
   QString delete_schedule_item = "DELETE FROM schedules WHERE owner = 'billy group';";
   /* @todo remove from group */
   /* QString delete_relation = "CALL RemoveFromGroup(?, ?, @success) */
-  QSqlQuery * query = new QSqlQuery(m_db);
+  QSqlQuery * query = new QSqlQuery(db);
   query->prepare(delete_group);
 
   if (!query->exec()) {
@@ -1564,7 +1994,7 @@ bool worker_node::cleanup_user_group_insert()
   }
   delete query;
 
-  query = new QSqlQuery(m_db);
+  query = new QSqlQuery(db);
   query->prepare(delete_schedule_item);
 
   if (!query->exec()) {
@@ -1594,9 +2024,6 @@ void worker_node::request_absent(
   if (separated.size() < 2) {
     /* if there are not enough params, disconnect. */
     QString * msg = new QString("ERROR: INVALID REQUEST\r\n");
-    m_p_mutex->lock();
-    served_client = true;
-    m_p_mutex->unlock();
     Q_EMIT (disconnect_client(p, msg));
     return;
   }
@@ -1610,16 +2037,10 @@ void worker_node::request_absent(
     if (!try_login(_user, _pass)) {
       msg = new QString("ERROR: AUTHENTICATION FAILED\r\n");
       delete _p_text;
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       Q_EMIT (disconnect_client(p, msg));
       return;
     } else if (!absent(_user)) {
       msg = new QString("ERROR: USER NOT ABSENT\r\n");
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       Q_EMIT (disconnect_client(p, msg));
       delete _p_text;
       return;
@@ -1628,9 +2049,6 @@ void worker_node::request_absent(
     msg = new QString("ERROR: DB COMMUNICATION FAILED\r\n");
   }
   Q_EMIT (disconnect_client(p, msg));
-  m_p_mutex->lock();
-  served_client = true;
-  m_p_mutex->unlock();
   delete _p_text;
 }
 
@@ -1650,9 +2068,6 @@ void worker_node::request_present(
   if (separated.size() < 2) {
     /* if there are not enough params, disconnect. */
     QString * msg = new QString("ERROR: INVALID REQUEST\r\n");
-    m_p_mutex->lock();
-    served_client = true;
-    m_p_mutex->unlock();
     Q_EMIT (disconnect_client(p, msg));
     return;
   }
@@ -1666,16 +2081,10 @@ void worker_node::request_present(
     if (!try_login(_user, _pass)) {
       msg = new QString("ERROR: AUTHENTICATION FAILED\r\n");
       delete _p_text;
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       Q_EMIT (disconnect_client(p, msg));
       return;
     } else if (!present(_user)) {
       msg = new QString("ERROR: USER NOT PRESENT\r\n");
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       Q_EMIT (disconnect_client(p, msg));
       delete _p_text;
       return;
@@ -1684,9 +2093,6 @@ void worker_node::request_present(
     msg = new QString("ERROR: DB COMMUNICATION FAILED\r\n");
   }
   Q_EMIT (disconnect_client(p, msg));
-  m_p_mutex->lock();
-  served_client = true;
-  m_p_mutex->unlock();
   delete _p_text;
 }
 
@@ -1706,9 +2112,6 @@ void worker_node::request_accept_friend(
   if (separated.size() < 3) {
     /* if there are not enough params, disconnect. */
     QString * msg = new QString("ERROR: INVALID REQUEST\r\n");
-    m_p_mutex->lock();
-    served_client = true;
-    m_p_mutex->unlock();
     Q_EMIT (disconnect_client(p, msg));
     return;
   }
@@ -1723,16 +2126,10 @@ void worker_node::request_accept_friend(
     if (!try_login(_user, _pass)) {
       msg = new QString("ERROR: AUTHENTICATION FAILED\r\n");
       delete _p_text;
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       Q_EMIT (disconnect_client(p, msg));
       return;
     } else if (!accept_friend(_user, _friend)) {
       msg = new QString("ERROR: FRIEND REQUEST DOES NOT EXIST\r\n");
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       Q_EMIT (disconnect_client(p, msg));
       delete _p_text;
       return;
@@ -1741,9 +2138,6 @@ void worker_node::request_accept_friend(
     msg = new QString("ERROR: DB COMMUNICATION FAILED\r\n");
   }
   Q_EMIT (disconnect_client(p, msg));
-  m_p_mutex->lock();
-  served_client = true;
-  m_p_mutex->unlock();
   delete _p_text;
 }
 
@@ -1763,9 +2157,6 @@ void worker_node::request_create_friendship(
   if (separated.size() < 3) {
     /* if there are not enough params, disconnect. */
     QString * msg = new QString("ERROR: INVALID REQUEST\r\n");
-    m_p_mutex->lock();
-    served_client = true;
-    m_p_mutex->unlock();
     Q_EMIT (disconnect_client(p, msg));
     return;
   }
@@ -1780,16 +2171,10 @@ void worker_node::request_create_friendship(
     if (!try_login(_user, _pass)) {
       msg = new QString("ERROR: AUTHENTICATION FAILED\r\n");
       delete _p_text;
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       Q_EMIT (disconnect_client(p, msg));
       return;
     } else if (!create_friendship(_user, _friend)) {
       msg = new QString("ERROR: FRIEND DOES NOT EXIST\r\n");
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       Q_EMIT (disconnect_client(p, msg));
       delete _p_text;
       return;
@@ -1798,9 +2183,6 @@ void worker_node::request_create_friendship(
     msg = new QString("ERROR: DB COMMUNICATION FAILED\r\n");
   }
   Q_EMIT (disconnect_client(p, msg));
-  m_p_mutex->lock();
-  served_client = true;
-  m_p_mutex->unlock();
   delete _p_text;
 }
 
@@ -1820,9 +2202,6 @@ void worker_node::request_friends(
   if (separated.size() < 2) {
     /* if there are not enough params, disconnect. */
     QString * msg = new QString("ERROR: INVALID REQUEST\r\n");
-    m_p_mutex->lock();
-    served_client = true;
-    m_p_mutex->unlock();
     Q_EMIT (disconnect_client(p, msg));
     return;
   }
@@ -1836,16 +2215,10 @@ void worker_node::request_friends(
     if (!try_login(_user, _pass)) {
       msg = new QString("ERROR: AUTHENTICATION FAILED\r\n");
       delete _p_text;
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       Q_EMIT (disconnect_client(p, msg));
       return;
     } else if (!friends(_user, msg = new QString())) {
       msg = new QString("ERROR: USER DOES NOT EXIST\r\n");
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       Q_EMIT (disconnect_client(p, msg));
       delete _p_text;
       return;
@@ -1854,9 +2227,6 @@ void worker_node::request_friends(
     msg = new QString("ERROR: DB COMMUNICATION FAILED\r\n");
   }
   Q_EMIT (disconnect_client(p, msg));
-  m_p_mutex->lock();
-  served_client = true;
-  m_p_mutex->unlock();
   delete _p_text;
 }
 
@@ -1876,9 +2246,6 @@ void worker_node::request_delete_friend(
   if (separated.size() < 3) {
     /* if there are not enough params, disconnect. */
     QString * msg = new QString("ERROR: INVALID REQUEST\r\n");
-    m_p_mutex->lock();
-    served_client = true;
-    m_p_mutex->unlock();
     Q_EMIT (disconnect_client(p, msg));
     return;
   }
@@ -1893,16 +2260,10 @@ void worker_node::request_delete_friend(
     if (!try_login(_user, _pass)) {
       msg = new QString("ERROR: AUTHENTICATION FAILED\r\n");
       delete _p_text;
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       Q_EMIT (disconnect_client(p, msg));
       return;
     } else if (!delete_friend(_user, _friend)) {
       msg = new QString("ERROR: FRIEND DOES NOT EXIST\r\n");
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       Q_EMIT (disconnect_client(p, msg));
       delete _p_text;
       return;
@@ -1911,9 +2272,6 @@ void worker_node::request_delete_friend(
     msg = new QString("ERROR: DB COMMUNICATION FAILED\r\n");
   }
   Q_EMIT (disconnect_client(p, msg));
-  m_p_mutex->lock();
-  served_client = true;
-  m_p_mutex->unlock();
   delete _p_text;
 }
 
@@ -1933,9 +2291,6 @@ void worker_node::request_friend_requests(
   if (separated.size() < 2) {
     /* if there are not enough params, disconnect. */
     QString * msg = new QString("ERROR: INVALID REQUEST\r\n");
-    m_p_mutex->lock();
-    served_client = true;
-    m_p_mutex->unlock();
     Q_EMIT (disconnect_client(p, msg));
     return;
   }
@@ -1949,16 +2304,10 @@ void worker_node::request_friend_requests(
     if (!try_login(_user, _pass)) {
       msg = new QString("ERROR: AUTHENTICATION FAILED\r\n");
       delete _p_text;
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       Q_EMIT (disconnect_client(p, msg));
       return;
     } else if (!friend_requests(_user, msg = new QString())) {
       msg = new QString("ERROR: USER DOES NOT EXIST\r\n");
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       Q_EMIT (disconnect_client(p, msg));
       delete _p_text;
       return;
@@ -1967,9 +2316,6 @@ void worker_node::request_friend_requests(
     msg = new QString("ERROR: DB COMMUNICATION FAILED\r\n");
   }
   Q_EMIT (disconnect_client(p, msg));
-  m_p_mutex->lock();
-  served_client = true;
-  m_p_mutex->unlock();
   delete _p_text;
 }
 
@@ -1988,9 +2334,6 @@ void worker_node::request_create_account(
   if (separated.size() < 3) {
     /* if there are not enough params, disconnect. */
     QString * msg = new QString("ERROR: INVALID REQUEST\r\n");
-    m_p_mutex->lock();
-    served_client = true;
-    m_p_mutex->unlock();
     Q_EMIT (disconnect_client(p, msg));
     return;
   }
@@ -2003,9 +2346,6 @@ void worker_node::request_create_account(
   if (username_exists(_user)) {
     /* the user exists. Invalid request. */
     QString * msg = new QString("ERROR: EXISTING USER\r\n");
-    m_p_mutex->lock();
-    served_client = true;
-    m_p_mutex->unlock();
     Q_EMIT (disconnect_client(p, msg));
     return;
   }
@@ -2016,18 +2356,12 @@ void worker_node::request_create_account(
     if (!try_create(_user, _pass, _mail)) {
       msg = new QString("ERROR: DB INSERT FAILED\r\n");
       delete _p_text;
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       return;
     } else {msg = new QString("OK\r\n");}
   } catch (...) {
     msg = new QString("ERROR: DB INSERT FAILED\r\n");
   }
   Q_EMIT (disconnect_client(p, msg));
-  m_p_mutex->lock();
-  served_client = true;
-  m_p_mutex->unlock();
   delete _p_text;
 }
 
@@ -2044,9 +2378,6 @@ void worker_node::request_reset_password(QString * _p_text, QTcpSocket * _p_sock
   if (separated.size() < 3) {
     /* invalid params => disconnect */
     QString * msg = new QString("ERROR: INVALID REQUEST\r\n");
-    m_p_mutex->lock();
-    served_client = true;
-    m_p_mutex->unlock();
     Q_EMIT (disconnect_client(p, msg));
     return;
   }
@@ -2063,15 +2394,9 @@ void worker_node::request_reset_password(QString * _p_text, QTcpSocket * _p_sock
       msg = new QString("ERROR: USER DOES NOT EXIST\r\n");
       Q_EMIT (disconnect_client(p, msg));
       delete _p_text;
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       return;
     } else if (!reset_password(_user, _email, _psswd)) {
       msg = new QString("ERROR: WRONG USERNAME & EMAIL COMBO\r\n");
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       Q_EMIT (disconnect_client(p, msg));
       delete _p_text;
       return;
@@ -2080,9 +2405,6 @@ void worker_node::request_reset_password(QString * _p_text, QTcpSocket * _p_sock
     msg = new QString("ERROR: DB COMMUNICATION FAILED\r\n");
   }
   Q_EMIT (disconnect_client(p, msg));
-  m_p_mutex->lock();
-  served_client = true;
-  m_p_mutex->unlock();
   delete _p_text;
 }
 
@@ -2099,15 +2421,14 @@ void worker_node::request_login(QString * _p_text, QTcpSocket * _p_socket)
   if (separated.size() < 2) {
     /* if there are not enough params, disconnect. */
     QString * msg = new QString("ERROR: INVALID REQUEST\r\n");
-    m_p_mutex->lock();
-    served_client = true;
-    m_p_mutex->unlock();
     Q_EMIT (disconnect_client(p, msg));
     return;
   }
 
   QString _user = separated[0];
   QString _pass = separated[1];
+  /* "user:::pass:::TOKEN" asks for a session token as well */
+  bool want_token = separated.size() > 2 && separated[2] == "TOKEN";
 
   QString * msg;
   /* try to authenticate */
@@ -2115,19 +2436,20 @@ void worker_node::request_login(QString * _p_text, QTcpSocket * _p_socket)
     if (!try_login(_user, _pass)) {
       msg = new QString("ERROR: AUTHENTICATION FAILED\r\n");
       delete _p_text;
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       Q_EMIT (disconnect_client(p, msg));
       return;
+    } else if (want_token && session_token::is_token(_pass)) {
+      /* a token can not be stretched into a new one */
+      msg = new QString("ERROR: PASSWORD REQUIRED\r\n");
+    } else if (want_token) {
+      QString token = issue_token(_user);
+      msg = (token.isEmpty()) ? new QString("ERROR: AUTHENTICATION FAILED\r\n") :
+        new QString("OK\r\n" + token + "\r\n");
     } else {msg = new QString("OK\r\n");}
   } catch (...) {
     msg = new QString("ERROR: DB COMMUNICATION FAILED\r\n");
   }
   Q_EMIT (disconnect_client(p, msg));
-  m_p_mutex->lock();
-  served_client = true;
-  m_p_mutex->unlock();
   delete _p_text;
 }
 
@@ -2144,9 +2466,6 @@ void worker_node::request_create_group(QString * _p_text, QTcpSocket * _p_socket
   if (separated.size() < 3) {
     /* invalid params => disconnect */
     QString * msg = new QString("ERROR: INVALID REQUEST\r\n");
-    m_p_mutex->lock();
-    served_client = true;
-    m_p_mutex->unlock();
     Q_EMIT (disconnect_client(p, msg));
     return;
   }
@@ -2163,15 +2482,9 @@ void worker_node::request_create_group(QString * _p_text, QTcpSocket * _p_socket
       msg = new QString("ERROR: AUTHENTICATION FAILED\r\n");
       Q_EMIT (disconnect_client(p, msg));
       delete _p_text;
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       return;
     } else if (!insert_group(_grp)) {
       msg = new QString("ERROR: EXISTING GROUP\r\n");
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       Q_EMIT (disconnect_client(p, msg));
       delete _p_text;
       return;
@@ -2180,9 +2493,6 @@ void worker_node::request_create_group(QString * _p_text, QTcpSocket * _p_socket
     msg = new QString("ERROR: DB COMMUNICATION FAILED\r\n");
   }
   Q_EMIT (disconnect_client(p, msg));
-  m_p_mutex->lock();
-  served_client = true;
-  m_p_mutex->unlock();
   delete _p_text;
 }
 
@@ -2199,9 +2509,6 @@ void worker_node::request_add_to_group(QString * _p_text, QTcpSocket * _p_socket
   if (separated.size() < 4) {
     /* invalid params => disconnect */
     QString * msg = new QString("ERROR: INVALID REQUEST\r\n");
-    m_p_mutex->lock();
-    served_client = true;
-    m_p_mutex->unlock();
     Q_EMIT (disconnect_client(p, msg));
     return;
   }
@@ -2219,15 +2526,9 @@ void worker_node::request_add_to_group(QString * _p_text, QTcpSocket * _p_socket
       msg = new QString("ERROR: AUTHENTICATION FAILED\r\n");
       Q_EMIT (disconnect_client(p, msg));
       delete _p_text;
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       return;
     } else if (!join_group(_usr2, _grp)) {
       msg = new QString("ERROR: GROUP DOES NOT EXIST\r\n");
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       Q_EMIT (disconnect_client(p, msg));
       delete _p_text;
       return;
@@ -2236,9 +2537,6 @@ void worker_node::request_add_to_group(QString * _p_text, QTcpSocket * _p_socket
     msg = new QString("ERROR: DB COMMUNICATION FAILED\r\n");
   }
   Q_EMIT (disconnect_client(p, msg));
-  m_p_mutex->lock();
-  served_client = true;
-  m_p_mutex->unlock();
   delete _p_text;
 }
 
@@ -2255,9 +2553,6 @@ void worker_node::request_delete_group(QString * _p_text, QTcpSocket * _p_socket
   if (separated.size() != 3) {
     /* invalid params => disconnect */
     QString * msg = new QString("ERROR: INVALID REQUEST\r\n");
-    m_p_mutex->lock();
-    served_client = true;
-    m_p_mutex->unlock();
     Q_EMIT (disconnect_client(p, msg));
     return;
   }
@@ -2274,15 +2569,9 @@ void worker_node::request_delete_group(QString * _p_text, QTcpSocket * _p_socket
       msg = new QString("ERROR: AUTHENTICATION FAILED\r\n");
       Q_EMIT (disconnect_client(p, msg));
       delete _p_text;
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       return;
     } else if (!remove_group(_grp)) {
       msg = new QString("ERROR: GROUP REMOVAL FAILED\r\n");
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       Q_EMIT (disconnect_client(p, msg));
       delete _p_text;
       return;
@@ -2291,9 +2580,6 @@ void worker_node::request_delete_group(QString * _p_text, QTcpSocket * _p_socket
     msg = new QString("ERROR: DB COMMUNICATION FAILED\r\n");
   }
   Q_EMIT (disconnect_client(p, msg));
-  m_p_mutex->lock();
-  served_client = true;
-  m_p_mutex->unlock();
   delete _p_text;
 }
 
@@ -2310,9 +2596,6 @@ void worker_node::request_leave_group(QString * _p_text, QTcpSocket * _p_socket)
   if (separated.size() < 4) {
     /* invalid params => disconnect */
     QString * msg = new QString("ERROR: INVALID REQUEST\r\n");
-    m_p_mutex->lock();
-    served_client = true;
-    m_p_mutex->unlock();
     Q_EMIT (disconnect_client(p, msg));
     return;
   }
@@ -2330,15 +2613,9 @@ void worker_node::request_leave_group(QString * _p_text, QTcpSocket * _p_socket)
       msg = new QString("ERROR: AUTHENTICATION FAILED\r\n");
       Q_EMIT (disconnect_client(p, msg));
       delete _p_text;
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       return;
     } else if (!leave_group(_usr2, _grp)) {
       msg = new QString("ERROR: GROUP DOES NOT EXIST\r\n");
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       Q_EMIT (disconnect_client(p, msg));
       delete _p_text;
       return;
@@ -2347,9 +2624,6 @@ void worker_node::request_leave_group(QString * _p_text, QTcpSocket * _p_socket)
     msg = new QString("ERROR: DB COMMUNICATION FAILED\r\n");
   }
   Q_EMIT (disconnect_client(p, msg));
-  m_p_mutex->lock();
-  served_client = true;
-  m_p_mutex->unlock();
   delete _p_text;
 }
 
@@ -2366,9 +2640,6 @@ void worker_node::request_update_user(QString * _p_text, QTcpSocket * _p_socket)
   if (separated.size() < 5) {
     /* invalid params => disconnect */
     QString * msg = new QString("ERROR: INVALID REQUEST\r\n");
-    m_p_mutex->lock();
-    served_client = true;
-    m_p_mutex->unlock();
     Q_EMIT (disconnect_client(p, msg));
     return;
   }
@@ -2383,24 +2654,26 @@ void worker_node::request_update_user(QString * _p_text, QTcpSocket * _p_socket)
 
   QString * msg;
 
+  if (session_token::is_token(_old_pass)) {
+    /* the update matches on the old password, which a token is not */
+    msg = new QString("ERROR: PASSWORD REQUIRED\r\n");
+    Q_EMIT (disconnect_client(p, msg));
+    delete _p_text;
+    return;
+  }
+
   try {
     if (!try_login(_old_user, _old_pass)) {
       std::cerr << "Authentication Error" << std::endl;
       msg = new QString("ERROR: AUTHENTICATION FAILED\r\n");
       Q_EMIT (disconnect_client(p, msg));
       delete _p_text;
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       return;
     } else if (!update_user(_old_user, _old_pass,
       _new_pass, _new_user,
       _new_mail, _new_cell))
     {
       msg = new QString("ERROR: FAILED TO UPDATE USER\r\n");
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       Q_EMIT (disconnect_client(p, msg));
       delete _p_text;
       return;
@@ -2409,9 +2682,6 @@ void worker_node::request_update_user(QString * _p_text, QTcpSocket * _p_socket)
     msg = new QString("ERROR: DB COMMUNICATION FAILED\r\n");
   }
   Q_EMIT (disconnect_client(p, msg));
-  m_p_mutex->lock();
-  served_client = true;
-  m_p_mutex->unlock();
   delete _p_text;
 }
 
@@ -2428,9 +2698,6 @@ void worker_node::request_personal_event(QString * _p_text, QTcpSocket * _p_sock
   if (separated.size() != 9) {
     /* invalid params => disconnect */
     QString * msg = new QString("ERROR: INVALID REQUEST\r\n");
-    m_p_mutex->lock();
-    served_client = true;
-    m_p_mutex->unlock();
     Q_EMIT (disconnect_client(p, msg));
     return;
   }
@@ -2453,9 +2720,6 @@ void worker_node::request_personal_event(QString * _p_text, QTcpSocket * _p_sock
       msg = new QString("ERROR: AUTHENTICATION FAILED\r\n");
       Q_EMIT (disconnect_client(p, msg));
       delete _p_text;
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       return;
     } else if (!create_personal_event(user, date,
       start, duration,
@@ -2463,9 +2727,6 @@ void worker_node::request_personal_event(QString * _p_text, QTcpSocket * _p_sock
       name, immutable))
     {
       msg = new QString("ERROR: FAILED TO CREATE EVENT\r\n");
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       Q_EMIT (disconnect_client(p, msg));
       delete _p_text;
       return;
@@ -2474,9 +2735,6 @@ void worker_node::request_personal_event(QString * _p_text, QTcpSocket * _p_sock
     msg = new QString("ERROR: DB COMMUNICATION FAILED\r\n");
   }
   Q_EMIT (disconnect_client(p, msg));
-  m_p_mutex->lock();
-  served_client = true;
-  m_p_mutex->unlock();
   delete _p_text;
 }
 
@@ -2493,9 +2751,6 @@ void worker_node::request_group_event(QString * _p_text, QTcpSocket * _p_socket)
   if (separated.size() != 9) {
     /* invalid params => disconnect */
     QString * msg = new QString("ERROR: INVALID REQUEST\r\n");
-    m_p_mutex->lock();
-    served_client = true;
-    m_p_mutex->unlock();
     Q_EMIT (disconnect_client(p, msg));
     return;
   }
@@ -2518,9 +2773,6 @@ void worker_node::request_group_event(QString * _p_text, QTcpSocket * _p_socket)
       msg = new QString("ERROR: AUTHENTICATION FAILED\r\n");
       Q_EMIT (disconnect_client(p, msg));
       delete _p_text;
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       return;
     } else if (!create_personal_event(group, date,
       start, duration,
@@ -2528,9 +2780,6 @@ void worker_node::request_group_event(QString * _p_text, QTcpSocket * _p_socket)
       name, immutable))
     {
       msg = new QString("ERROR: FAILED TO CREATE EVENT\r\n");
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       Q_EMIT (disconnect_client(p, msg));
       delete _p_text;
       return;
@@ -2539,9 +2788,6 @@ void worker_node::request_group_event(QString * _p_text, QTcpSocket * _p_socket)
     msg = new QString("ERROR: DB COMMUNICATION FAILED\r\n");
   }
   Q_EMIT (disconnect_client(p, msg));
-  m_p_mutex->lock();
-  served_client = true;
-  m_p_mutex->unlock();
   delete _p_text;
 }
 
@@ -2558,9 +2804,6 @@ void worker_node::request_user_groups(QString * _p_text, QTcpSocket * _p_socket)
   if (separated.size() != 2) {
     /* invalid params => disconnect */
     QString * msg = new QString("ERROR: INVALID REQUEST\r\n");
-    m_p_mutex->lock();
-    served_client = true;
-    m_p_mutex->unlock();
     Q_EMIT (disconnect_client(p, msg));
     return;
   }
@@ -2576,15 +2819,9 @@ void worker_node::request_user_groups(QString * _p_text, QTcpSocket * _p_socket)
       msg = new QString("ERROR: AUTHENTICATION FAILED\r\n");
       Q_EMIT (disconnect_client(p, msg));
       delete _p_text;
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       return;
     } else if (!list_groups(user, msg = new QString())) {
       msg = new QString("ERROR: FAILED TO FETCH GROUP LIST\r\n");
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       Q_EMIT (disconnect_client(p, msg));
       delete _p_text;
       return;
@@ -2593,9 +2830,6 @@ void worker_node::request_user_groups(QString * _p_text, QTcpSocket * _p_socket)
     msg = new QString("ERROR: DB COMMUNICATION FAILED\r\n");
   }
   Q_EMIT (disconnect_client(p, msg));
-  m_p_mutex->lock();
-  served_client = true;
-  m_p_mutex->unlock();
   delete _p_text;
 }
 
@@ -2612,9 +2846,6 @@ void worker_node::request_account_info(QString * _p_text, QTcpSocket * _p_socket
   if (separated.size() != 2) {
     /* invalid params => disconnect */
     QString * msg = new QString("ERROR: INVALID REQUEST\r\n");
-    m_p_mutex->lock();
-    served_client = true;
-    m_p_mutex->unlock();
     Q_EMIT (disconnect_client(p, msg));
     return;
   }
@@ -2630,15 +2861,9 @@ void worker_node::request_account_info(QString * _p_text, QTcpSocket * _p_socket
       msg = new QString("ERROR: AUTHENTICATION FAILED\r\n");
       Q_EMIT (disconnect_client(p, msg));
       delete _p_text;
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       return;
     } else if (!get_account_info(user, msg = new QString())) {
       msg = new QString("ERROR: FAILED TO FETCH ACCOUNT INFO\r\n");
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       Q_EMIT (disconnect_client(p, msg));
       delete _p_text;
       return;
@@ -2647,9 +2872,6 @@ void worker_node::request_account_info(QString * _p_text, QTcpSocket * _p_socket
     msg = new QString("ERROR: DB COMMUNICATION FAILED\r\n");
   }
   Q_EMIT (disconnect_client(p, msg));
-  m_p_mutex->lock();
-  served_client = true;
-  m_p_mutex->unlock();
   delete _p_text;
 }
 
@@ -2666,9 +2888,6 @@ void worker_node::request_group_users(QString * _p_text, QTcpSocket * _p_socket)
   if (separated.size() != 3) {
     /* invalid params => disconnect */
     QString * msg = new QString("ERROR: INVALID REQUEST\r\n");
-    m_p_mutex->lock();
-    served_client = true;
-    m_p_mutex->unlock();
     Q_EMIT (disconnect_client(p, msg));
     return;
   }
@@ -2685,15 +2904,9 @@ void worker_node::request_group_users(QString * _p_text, QTcpSocket * _p_socket)
       msg = new QString("ERROR: AUTHENTICATION FAILED\r\n");
       Q_EMIT (disconnect_client(p, msg));
       delete _p_text;
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       return;
     } else if (!list_group_users(group, msg = new QString())) {
       msg = new QString("ERROR: FAILED TO FETCH GROUP USERS\r\n");
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       Q_EMIT (disconnect_client(p, msg));
       delete _p_text;
       return;
@@ -2702,9 +2915,6 @@ void worker_node::request_group_users(QString * _p_text, QTcpSocket * _p_socket)
     msg = new QString("ERROR: DB COMMUNICATION FAILED\r\n");
   }
   Q_EMIT (disconnect_client(p, msg));
-  m_p_mutex->lock();
-  served_client = true;
-  m_p_mutex->unlock();
   delete _p_text;
 }
 
@@ -2721,9 +2931,6 @@ void worker_node::request_user_events(QString * _p_text, QTcpSocket * _p_socket)
   if (separated.size() != 4) {
     /* invalid params => disconnect */
     QString * msg = new QString("ERROR: INVALID REQUEST\r\n");
-    m_p_mutex->lock();
-    served_client = true;
-    m_p_mutex->unlock();
     Q_EMIT (disconnect_client(p, msg));
     return;
   }
@@ -2741,15 +2948,9 @@ void worker_node::request_user_events(QString * _p_text, QTcpSocket * _p_socket)
       msg = new QString("ERROR: AUTHENTICATION FAILED\r\n");
       Q_EMIT (disconnect_client(p, msg));
       delete _p_text;
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       return;
     } else if (!list_user_events(user, start_day, stop_day, msg = new QString())) {
       msg = new QString("ERROR: FAILED TO FETCH USER EVENTS\r\n");
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       Q_EMIT (disconnect_client(p, msg));
       delete _p_text;
       return;
@@ -2758,9 +2959,6 @@ void worker_node::request_user_events(QString * _p_text, QTcpSocket * _p_socket)
     msg = new QString("ERROR: DB COMMUNICATION FAILED\r\n");
   }
   Q_EMIT (disconnect_client(p, msg));
-  m_p_mutex->lock();
-  served_client = true;
-  m_p_mutex->unlock();
   delete _p_text;
 }
 
@@ -2777,9 +2975,6 @@ void worker_node::request_group_events(QString * _p_text, QTcpSocket * _p_socket
   if (separated.size() != 5) {
     /* invalid params => disconnect */
     QString * msg = new QString("ERROR: INVALID REQUEST\r\n");
-    m_p_mutex->lock();
-    served_client = true;
-    m_p_mutex->unlock();
     Q_EMIT (disconnect_client(p, msg));
     return;
   }
@@ -2798,24 +2993,15 @@ void worker_node::request_group_events(QString * _p_text, QTcpSocket * _p_socket
       msg = new QString("ERROR: AUTHENTICATION FAILED\r\n");
       Q_EMIT (disconnect_client(p, msg));
       delete _p_text;
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       return;
     } else if (!user_in_group(user, group)) {
       msg = new QString("ERROR: USER ");
       *msg += "\"" + user + "\" IS NOT IN GROUP \"" + group + "\"\r\n";
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       Q_EMIT (disconnect_client(p, msg));
       delete _p_text;
       return;
     } else if (!list_user_events(group, start_day, stop_day, msg = new QString())) {
       msg = new QString("ERROR: FAILED TO FETCH USER EVENTS\r\n");
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       Q_EMIT (disconnect_client(p, msg));
       delete _p_text;
       return;
@@ -2824,9 +3010,6 @@ void worker_node::request_group_events(QString * _p_text, QTcpSocket * _p_socket
     msg = new QString("ERROR: DB COMMUNICATION FAILED\r\n");
   }
   Q_EMIT (disconnect_client(p, msg));
-  m_p_mutex->lock();
-  served_client = true;
-  m_p_mutex->unlock();
   delete _p_text;
 }
 
@@ -2844,9 +3027,6 @@ void worker_node::request_personal_month_events(QString * _p_text, QTcpSocket *
   if (separated.size() != 4) {
     /* invalid params => disconnect */
     QString * msg = new QString("ERROR: INVALID REQUEST\r\n");
-    m_p_mutex->lock();
-    served_client = true;
-    m_p_mutex->unlock();
     Q_EMIT (disconnect_client(p, msg));
     return;
   }
@@ -2864,15 +3044,9 @@ void worker_node::request_personal_month_events(QString * _p_text, QTcpSocket *
       msg = new QString("ERROR: AUTHENTICATION FAILED\r\n");
       Q_EMIT (disconnect_client(p, msg));
       delete _p_text;
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       return;
     } else if (!list_user_month_events(user, month, year, msg = new QString())) {
       msg = new QString("ERROR: FAILED TO FETCH USER EVENTS\r\n");
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       Q_EMIT (disconnect_client(p, msg));
       delete _p_text;
       return;
@@ -2881,9 +3055,6 @@ void worker_node::request_personal_month_events(QString * _p_text, QTcpSocket *
     msg = new QString("ERROR: DB COMMUNICATION FAILED\r\n");
   }
   Q_EMIT (disconnect_client(p, msg));
-  m_p_mutex->lock();
-  served_client = true;
-  m_p_mutex->unlock();
   delete _p_text;
 }
 
@@ -2901,9 +3072,6 @@ void worker_node::request_group_month_events(QString * _p_text, QTcpSocket * _p_
   if (separated.size() != 5) {
     /* invalid params => disconnect */
     QString * msg = new QString("ERROR: INVALID REQUEST\r\n");
-    m_p_mutex->lock();
-    served_client = true;
-    m_p_mutex->unlock();
     Q_EMIT (disconnect_client(p, msg));
     return;
   }
@@ -2922,33 +3090,21 @@ void worker_node::request_group_month_events(QString * _p_text, QTcpSocket * _p_
       msg = new QString("ERROR: AUTHENTICATION FAILED\r\n");
       Q_EMIT (disconnect_client(p, msg));
       delete _p_text;
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       return;
     } else if (!group_exists(group)) {
       msg = new QString("ERROR: GROUP ");
       *msg += "\"" + group + "\" DOES NOT EXIST\r\n";
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       Q_EMIT (disconnect_client(p, msg));
       delete _p_text;
       return;
     } else if (!user_in_group(user, group)) {
       msg = new QString("ERROR: USER ");
       *msg += "\"" + user + "\" IS NOT IN GROUP \"" + group + "\"\r\n";
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       Q_EMIT (disconnect_client(p, msg));
       delete _p_text;
       return;
     } else if (!list_user_month_events(group, month, year, msg = new QString())) {
       msg = new QString("ERROR: FAILED TO FETCH GROUP EVENTS\r\n");
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       Q_EMIT (disconnect_client(p, msg));
       delete _p_text;
       return;
@@ -2957,9 +3113,6 @@ void worker_node::request_group_month_events(QString * _p_text, QTcpSocket * _p_
     msg = new QString("ERROR: DB COMMUNICATION FAILED\r\n");
   }
   Q_EMIT (disconnect_client(p, msg));
-  m_p_mutex->lock();
-  served_client = true;
-  m_p_mutex->unlock();
   delete _p_text;
 }
 
@@ -2976,9 +3129,6 @@ void worker_node::request_suggest_user_times(QString * _p_text, QTcpSocket * _p_
   if (separated.size() != 5) {
     /* invalid params => disconnect */
     QString * msg = new QString("ERROR: INVALID REQUEST\r\n");
-    m_p_mutex->lock();
-    served_client = true;
-    m_p_mutex->unlock();
     Q_EMIT (disconnect_client(p, msg));
     return;
   }
@@ -2997,17 +3147,11 @@ void worker_node::request_suggest_user_times(QString * _p_text, QTcpSocket * _p_
       msg = new QString("ERROR: AUTHENTICATION FAILED\r\n");
       Q_EMIT (disconnect_client(p, msg));
       delete _p_text;
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       return;
     } else if (!suggest_user_events(user, stop_day, stop_time,
       duration, msg = new QString()))
     {
       msg = new QString("ERROR: FAILED TO ESTIMATE EVENTS\r\n");
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       Q_EMIT (disconnect_client(p, msg));
       delete _p_text;
       return;
@@ -3016,9 +3160,6 @@ void worker_node::request_suggest_user_times(QString * _p_text, QTcpSocket * _p_
     msg = new QString("ERROR: DB COMMUNICATION FAILED\r\n");
   }
   Q_EMIT (disconnect_client(p, msg));
-  m_p_mutex->lock();
-  served_client = true;
-  m_p_mutex->unlock();
   delete _p_text;
 }
 
@@ -3032,12 +3173,10 @@ void worker_node::request_suggest_group_times(QString * _p_text, QTcpSocket * _p
   /* split along ':' characters */
   QStringList separated = _p_text->split(":::");
 
-  if (separated.size() != 6) {
+  /* a seventh field asks for times that many members can make */
+  if (separated.size() != 6 && separated.size() != 7) {
     /* invalid params => disconnect */
     QString * msg = new QString("ERROR: INVALID REQUEST\r\n");
-    m_p_mutex->lock();
-    served_client = true;
-    m_p_mutex->unlock();
     Q_EMIT (disconnect_client(p, msg));
     return;
   }
@@ -3057,35 +3196,26 @@ void worker_node::request_suggest_group_times(QString * _p_text, QTcpSocket * _p
       msg = new QString("ERROR: AUTHENTICATION FAILED\r\n");
       Q_EMIT (disconnect_client(p, msg));
       delete _p_text;
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       return;
     } else if (!group_exists(group)) {
       msg = new QString("ERROR: GROUP ");
       *msg += "\"" + group + "\" DOES NOT EXIST\r\n";
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       Q_EMIT (disconnect_client(p, msg));
       delete _p_text;
       return;
     } else if (!user_in_group(user, group)) {
       msg = new QString("ERROR: USER ");
       *msg += "\"" + user + "\" IS NOT IN GROUP \"" + group + "\"\r\n";
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       Q_EMIT (disconnect_client(p, msg));
       delete _p_text;
       return;
-    } else if (!suggest_group_events(group, stop_day, stop_time,
-      duration, msg = new QString()))
+    } else if (separated.size() == 7
+      ? !suggest_quorum_events(group, stop_day, stop_time, duration,
+        separated[6], msg = new QString())
+      : !suggest_group_events(group, stop_day, stop_time,
+        duration, msg = new QString()))
     {
       msg = new QString("ERROR: FAILED TO ESTIMATE EVENTS\r\n");
-      m_p_mutex->lock();
-      served_client = true;
-      m_p_mutex->unlock();
       Q_EMIT (disconnect_client(p, msg));
       delete _p_text;
       return;
@@ -3097,8 +3227,54 @@ void worker_node::request_suggest_group_times(QString * _p_text, QTcpSocket * _p
     msg = new QString("ERROR: DB COMMUNICATION FAILED\r\n");
   }
   Q_EMIT (disconnect_client(p, msg));
-  m_p_mutex->lock();
-  served_client = true;
-  m_p_mutex->unlock();
   delete _p_text;
 }
+
+/**
+ * @brief Handle WORKER_STATS.
+ *
+ * Replies with the number of pooled database connections,
+ * then a line per connection with its statistics:
+ * "<name>:::<checkouts>:::<pings>:::<connects>:::<failures>:::<prepares>:::<executes>".
+ */
+void worker_node::request_stats(QString * _p_text, QTcpSocket * _p_socket)
+{
+  delete _p_text;
+  QString client_host = _p_socket->peerName();
+  tcp_connection * p = new tcp_connection(client_host, _p_socket);
+
+  QList<db_pool::connection_stats> stats = m_p_db_pool->stats();
+  QString * msg = new QString(QString::number(stats.size()) + "\r\n");
+  for (const db_pool::connection_stats & c : stats) {
+    *msg += c.name + ":::" + QString::number(c.checkouts) + ":::" +
+      QString::number(c.pings) + ":::" + QString::number(c.connects) + ":::" +
+      QString::number(c.failures) + ":::" + QString::number(c.prepares) + ":::" +
+      QString::number(c.executes) + "\r\n";
+  }
+  Q_EMIT (disconnect_client(p, msg));
+}
+
+/**
+ * @brief Handle CACHE_STATS.
+ *
+ * Replies with the number of caches, then a line per cache:
+ * "<cache>:::<hits>:::<misses>:::<entries>".
+ */
+void worker_node::request_cache_stats(QString * _p_text, QTcpSocket * _p_socket)
+{
+  delete _p_text;
+  QString client_host = _p_socket->peerName();
+  tcp_connection * p = new tcp_connection(client_host, _p_socket);
+
+  QString * msg = new QString("3\r\n");
+  *msg += "auth:::" + QString::number(m_p_auth_cache->hits()) + ":::" +
+    QString::number(m_p_auth_cache->misses()) + ":::" +
+    QString::number(m_p_auth_cache->size()) + "\r\n";
+  *msg += "membership:::" + QString::number(m_p_membership->hits()) + ":::" +
+    QString::number(m_p_membership->misses()) + ":::" +
+    QString::number(m_p_membership->size()) + "\r\n";
+  *msg += "schedule:::" + QString::number(m_p_schedules->hits()) + ":::" +
+    QString::number(m_p_schedules->misses()) + ":::" +
+    QString::number(m_p_schedules->size()) + "\r\n";
+  Q_EMIT (disconnect_client(p, msg));
+}
@@ -27,6 +27,14 @@
 #include "user.hpp"
 #include "tcp_comm.hpp"
 #include "tcp_thread.hpp"
+#include "request_executor.hpp"
+#include "db_pool.hpp"
+#include "session_token.hpp"
+#include "auth_cache.hpp"
+#include "membership_cache.hpp"
+#include "schedule_cache.hpp"
+#include "availability.hpp"
+#include "interval_timeline.hpp"
 #include "event_struct.hpp"
 #include "thread_init_exception.hpp"
 #include "worker_connection_state.hpp"
@@ -49,6 +57,13 @@ public:
   bool try_login(
     const QString & _user,
     const QString & _password);
+  QString issue_token(const QString & _user);
+  bool verify_token(
+    const QString & _user,
+    const QString & _token);
+  bool credential_stamp(
+    const QString & _user,
+    QByteArray & _stamp);
   bool try_create(
     const QString & _user,
     const QString & _password,
@@ -60,7 +75,7 @@ public:
   bool is_valid_for_user(
     const QString &,
     const calendar_event &);
-  QSet<calendar_event> suggest_event_times(
+  QList<calendar_event> suggest_event_times(
     const QString &, const QString &,
     const QString &, const QString &);
 
@@ -68,10 +83,11 @@ public:
   Q_SIGNAL void finished_client_job();
 
   Q_SLOT void run();
-  Q_SLOT void stop() {m_continue = false;}
+  Q_SLOT void stop();
   Q_SLOT void start_thread() {m_p_thread->start();}
 
-  Q_SLOT QSqlDatabase setup_db();
+  Q_SLOT QSqlDatabase setup_db(const QString & _name);
+  void define_statements();
   Q_SLOT bool insert_user(user & u);
   Q_SLOT bool select_user(user & u);
   Q_SLOT bool select_schedule_id(user & u);
@@ -90,6 +106,29 @@ public:
   Q_SLOT bool list_groups(const QString &, QString *);
   Q_SLOT bool get_account_info(const QString &, QString *);
   Q_SLOT bool list_group_users(const QString &, QString *);
+  bool group_members(const QString &, QStringList &);
+  availability * group_availability(
+    const QString &,
+    const QString &,
+    const QString &,
+    const QString &,
+    int &);
+  bool schedule_between(
+    const QString &,
+    const QDate &,
+    const QDate &,
+    schedule_cache::items &);
+  void busy_timeline(
+    const QString &,
+    const QDate &,
+    const QDate &,
+    interval_timeline &);
+  bool load_schedule(
+    const QString &,
+    const QDate &,
+    const QDate &,
+    schedule_cache::items &);
+  void refresh_schedule_day(const QString &, const QString &);
   Q_SLOT bool create_personal_event(
     const QString &, const QString &,
     const QString &, const QString &,
@@ -124,6 +163,14 @@ public:
     const QString &,
     const QString &,
     QString * _msg);
+  Q_SLOT bool suggest_quorum_events(
+    const QString &,
+    const QString &,
+    const QString &,
+    const QString &,
+    const QString &,
+    QString * _msg);
+  Q_SLOT void handle_client_connect();
   Q_SLOT void handle_client_disconnect();
 
   bool reset_password(
@@ -145,6 +192,34 @@ public:
     m_master_port = _master_port;
   }
 
+  void set_idle_timeout(const int & _idle_timeout)
+  {
+    m_idle_timeout = _idle_timeout;
+  }
+
+  void set_max_clients(const int & _max_clients)
+  {
+    m_max_clients = _max_clients;
+  }
+
+  /* database connections, and so threads serving requests; before init() */
+  void set_db_pool_size(const int & _db_pool_size)
+  {
+    m_db_pool_size = _db_pool_size;
+  }
+
+  /* time (in ms) a verified login is remembered; before init() */
+  void set_auth_cache_ttl(const qint64 & _auth_cache_ttl)
+  {
+    m_p_auth_cache->set_ttl(_auth_cache_ttl);
+  }
+
+  /* seconds a session token stays valid; before init() */
+  void set_token_ttl(const qint64 & _token_ttl)
+  {
+    m_p_tokens->set_ttl(_token_ttl);
+  }
+
   Q_SIGNAL void disconnect_client(
     tcp_connection * client,
     QString * _p_msg);
@@ -226,8 +301,54 @@ public:
   Q_SLOT void request_suggest_group_times(
     QString * _p_text,
     QTcpSocket * _p_socket);
+  Q_SLOT void request_stats(
+    QString * _p_text,
+    QTcpSocket * _p_socket);
+  Q_SLOT void request_cache_stats(
+    QString * _p_text,
+    QTcpSocket * _p_socket);
 
 private:
+  typedef void (worker_node::* request_handler)(QString *, QTcpSocket *);
+  void register_request(const QByteArray & _verb, request_handler _handler);
+
+  Q_SLOT void close_control();
+  Q_SLOT void connect_to_master();
+  Q_SLOT void register_with_master();
+  Q_SLOT void read_from_master();
+  Q_SLOT void lost_master();
+  Q_SLOT void send_load_report();
+  void schedule_load_report();
+
+  QByteArray load_report();
+  void reserve_slot();
+  void expire_reservations();
+
+  /* how long (in ms) a slot is held for a client the master sent us */
+  static const int RESERVATION_TIMEOUT = 10000;
+  /* how often (in ms) we remind the master of our load */
+  static const int HEARTBEAT_INTERVAL = 1000;
+  /* requests that may wait for an executor thread */
+  static const int MAX_QUEUED_REQUESTS = 1024;
+  /* session tokens last an hour unless told otherwise */
+  static const qint64 TOKEN_TTL = 3600;
+  /* logins remembered, and for how long (in ms) */
+  static const int AUTH_CACHE_SIZE = 4096;
+  static const qint64 AUTH_CACHE_TTL = 30000;
+  /* groups remembered, and for how long (in ms) */
+  static const int MEMBERSHIP_CACHE_SIZE = 1024;
+  static const qint64 MEMBERSHIP_CACHE_TTL = 30000;
+  /* group suggestions fall within these minutes of the day */
+  static const int DAY_START = 8 * 60;
+  static const int DAY_END = 22 * 60;
+  /* and no further ahead than this */
+  static const int MAX_HORIZON_DAYS = 366;
+  /* most times a quorum request is offered */
+  static const int QUORUM_SUGGESTIONS = 10;
+  /* bytes spent on cached schedules, and how long (in ms) one is kept */
+  static const int SCHEDULE_CACHE_BUDGET = 16 * 1024 * 1024;
+  static const qint64 SCHEDULE_CACHE_TTL = 30000;
+
   volatile bool m_continue = true;
 
   QString m_host;
@@ -238,12 +359,38 @@ private:
 
   tcp_thread * m_p_tcp_thread;
   QThread * m_p_thread;
+  request_executor * m_p_executor = NULL;
 
-  connection_state state;       /* state enum for the state machine */
+  connection_state state = CONNECT_TO_MASTER;       /* state enum for the state machine */
 
   quint16 sleep_time = 400;
-  QSqlDatabase m_db;
-  volatile bool served_client = false;
+  int m_idle_timeout = 30000;
+
+  /* client slots, guarded by m_p_mutex */
+  int m_max_clients = 1;
+  int m_active_clients = 0;
+  QList<qint64> m_reservations;
+  QList<qint64> m_early_clients;
   QMutex * m_p_mutex;
+
+  /* one database connection per executor thread */
+  db_pool * m_p_db_pool;
+  int m_db_pool_size = QThread::idealThreadCount();
+
+  /* signs and checks session tokens */
+  session_token * m_p_tokens;
+  /* recently verified logins */
+  auth_cache * m_p_auth_cache;
+  /* who is in which group */
+  membership_cache * m_p_membership;
+  /* the events on each schedule */
+  schedule_cache * m_p_schedules;
+
+  /* control connection to the master; only used on our thread */
+  QTcpSocket * m_p_control = NULL;
+  QTimer * m_p_heartbeat = NULL;
+  int m_paired_seen = 0;
+  bool m_reconnect_pending = false;
+  QAtomicInt m_report_pending;
 };
 #endif
@@ -0,0 +1,138 @@
+// Copyright 2017 Hunter L. Allen
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "worker_selection_policy.hpp"
+
+#include <cmath>
+
+/**
+ * @brief Compare two workers by load.
+ *
+ * Fewer outstanding clients wins; latency breaks ties.
+ *
+ * @return True if _p_a is less loaded than _p_b.
+ */
+static bool less_loaded(worker_connection * _p_a, worker_connection * _p_b)
+{
+  if (_p_a->get_outstanding() != _p_b->get_outstanding()) {
+    return _p_a->get_outstanding() < _p_b->get_outstanding();
+  }
+  return _p_a->get_latency() < _p_b->get_latency();
+}
+
+/**
+ * @brief Construct a policy by name.
+ *
+ * @param _name One of "fifo", "least-outstanding", "latency", "p2c" or "affinity".
+ * @return The policy (caller owns it), or NULL for an unknown name.
+ */
+worker_selection_policy * worker_selection_policy::create(const QString & _name)
+{
+  if (_name == "fifo") {
+    return new fifo_policy();
+  } else if (_name == "least-outstanding") {
+    return new least_outstanding_policy();
+  } else if (_name == "latency") {
+    return new latency_policy();
+  } else if (_name == "p2c") {
+    return new power_of_two_policy();
+  } else if (_name == "affinity") {
+    return new affinity_policy();
+  }
+  return NULL;
+}
+
+int fifo_policy::select(const QList<worker_connection *> &)
+{
+  return 0;
+}
+
+int least_outstanding_policy::select(const QList<worker_connection *> & _workers)
+{
+  /* the first of equals wins, so ties go to the oldest registration */
+  int best = 0;
+  for (int x = 1; x < _workers.size(); ++x) {
+    if (_workers[x]->get_outstanding() < _workers[best]->get_outstanding()) {best = x;}
+  }
+  return best;
+}
+
+int latency_policy::select(const QList<worker_connection *> & _workers)
+{
+  int best = 0;
+  for (int x = 1; x < _workers.size(); ++x) {
+    if (_workers[x]->get_latency() < _workers[best]->get_latency()) {best = x;}
+  }
+  return best;
+}
+
+int power_of_two_policy::select(const QList<worker_connection *> & _workers)
+{
+  if (_workers.size() == 1) {return 0;}
+  /* two distinct workers */
+  std::uniform_int_distribution<int> pick(0, _workers.size() - 1);
+  int a = pick(m_random);
+  int b = pick(m_random);
+  while (b == a) {b = pick(m_random);}
+  return less_loaded(_workers[b], _workers[a]) ? b : a;
+}
+
+int affinity_policy::select(const QList<worker_connection *> & _workers)
+{
+  int best = 0;
+  for (int x = 1; x < _workers.size(); ++x) {
+    if (less_loaded(_workers[x], _workers[best])) {best = x;}
+  }
+  return best;
+}
+
+int affinity_policy::select_for(const QList<worker_connection *> & _workers, const QString & _key)
+{
+  if (_key.isEmpty()) {return select(_workers);}
+
+  QHash<QString, int> index;
+  int total = 0;
+  for (int x = 0; x < _workers.size(); ++x) {
+    if (!index.contains(_workers[x]->get_hostname())) {index.insert(_workers[x]->get_hostname(), x);}
+    total += _workers[x]->get_outstanding();
+  }
+  /* counting the client we are placing */
+  int bound = (int) std::ceil((1.0 + m_epsilon) * (total + 1) / _workers.size());
+
+  QString chosen = m_ring.find(_key, [&](const QString & _node) {
+        int x = index.value(_node, -1);
+        return x >= 0 && _workers[x]->get_outstanding() < bound;
+      });
+  /* every worker is at the bound, or none of them are on the ring */
+  if (chosen.isEmpty()) {return select(_workers);}
+  return index.value(chosen);
+}
+
+void affinity_policy::worker_added(worker_connection * _p_worker)
+{
+  /* the same location may register more than once */
+  if (m_registrations[_p_worker->get_hostname()]++ == 0) {
+    m_ring.add_node(_p_worker->get_hostname());
+  }
+}
+
+void affinity_policy::worker_removed(worker_connection * _p_worker)
+{
+  QHash<QString, int>::iterator it = m_registrations.find(_p_worker->get_hostname());
+  if (it == m_registrations.end()) {return;}
+  if (--it.value() == 0) {
+    m_registrations.erase(it);
+    m_ring.remove_node(_p_worker->get_hostname());
+  }
+}
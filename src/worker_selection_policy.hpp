@@ -0,0 +1,139 @@
+// Copyright 2017 Hunter L. Allen
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __WORKER_SELECTION_POLICY_HPP__
+#define __WORKER_SELECTION_POLICY_HPP__
+#pragma once
+#include <QtCore>
+
+#include <random>
+
+#include "worker_connection.hpp"
+#include "consistent_hash_ring.hpp"
+
+/**
+ * Decides which idle worker the master hands the next client.
+ *
+ * Workers report their load when they register (see
+ * worker_connection::set_load); a policy looks at those
+ * reports and picks one of the registered workers.
+ */
+class worker_selection_policy
+{
+public:
+  virtual ~worker_selection_policy() {}
+
+  /**
+   * @brief Pick a worker.
+   * @param _workers Idle workers, oldest registration first. Never empty.
+   * @return Index into _workers.
+   */
+  virtual int select(const QList<worker_connection *> & _workers) = 0;
+
+  /**
+   * @brief Pick a worker for a client that gave its username.
+   * @param _workers Idle workers, oldest registration first. Never empty.
+   * @param _key The client's username.
+   * @return Index into _workers.
+   */
+  virtual int select_for(const QList<worker_connection *> & _workers, const QString &)
+  {
+    return select(_workers);
+  }
+
+  /* the master tells us as workers join and leave its pool */
+  virtual void worker_added(worker_connection *) {}
+  virtual void worker_removed(worker_connection *) {}
+
+  virtual const char * name() const = 0;
+
+  static worker_selection_policy * create(const QString & _name);
+};
+
+/**
+ * The oldest registration gets the client.
+ */
+class fifo_policy : public worker_selection_policy
+{
+public:
+  int select(const QList<worker_connection *> & _workers) override;
+  const char * name() const override {return "fifo";}
+};
+
+/**
+ * The worker with the fewest clients gets the client.
+ */
+class least_outstanding_policy : public worker_selection_policy
+{
+public:
+  int select(const QList<worker_connection *> & _workers) override;
+  const char * name() const override {return "least-outstanding";}
+};
+
+/**
+ * The worker with the lowest average response time gets the client.
+ */
+class latency_policy : public worker_selection_policy
+{
+public:
+  int select(const QList<worker_connection *> & _workers) override;
+  const char * name() const override {return "latency";}
+};
+
+/**
+ * Two workers are picked at random, and the less loaded of the
+ * two gets the client. This avoids sending every client to the
+ * same worker between load reports.
+ */
+class power_of_two_policy : public worker_selection_policy
+{
+public:
+  explicit power_of_two_policy(const unsigned int & _seed = std::random_device()())
+  : m_random(_seed)
+  { /* seeded so tests can repeat a run */}
+
+  int select(const QList<worker_connection *> & _workers) override;
+  const char * name() const override {return "p2c";}
+
+private:
+  std::mt19937 m_random;
+};
+
+/**
+ * A client that gives its username goes to the same worker every
+ * time, so that worker's caches stay warm for it. Usernames are
+ * mapped onto the workers with a consistent_hash_ring, and no worker
+ * is given more than (1 + epsilon) times the average load: a worker
+ * at that bound passes the client on to the next one on the ring.
+ * Clients without a username go to the least loaded worker.
+ */
+class affinity_policy : public worker_selection_policy
+{
+public:
+  explicit affinity_policy(const double & _epsilon = 0.25)
+  : m_epsilon(_epsilon)
+  { /* workers are added as they register */}
+
+  int select(const QList<worker_connection *> & _workers) override;
+  int select_for(const QList<worker_connection *> & _workers, const QString & _key) override;
+  void worker_added(worker_connection * _p_worker) override;
+  void worker_removed(worker_connection * _p_worker) override;
+  const char * name() const override {return "affinity";}
+
+private:
+  double m_epsilon;
+  consistent_hash_ring m_ring;
+  QHash<QString, int> m_registrations;    /* workers in the pool, by location */
+};
+#endif
@@ -0,0 +1,10 @@
+QT = core testlib
+CONFIG += c++14 debug
+
+SOURCES = testcaches.cpp
+
+SOURCES += ../src/session_token.cpp \
+           ../src/schedule_cache.cpp
+
+HEADERS += ../src/session_token.hpp \
+           ../src/schedule_cache.hpp
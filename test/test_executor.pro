@@ -0,0 +1,8 @@
+QT = core testlib
+CONFIG += c++14 debug
+
+SOURCES = testexecutor.cpp
+
+SOURCES += ../src/request_executor.cpp
+
+HEADERS += ../src/request_executor.hpp
@@ -0,0 +1,59 @@
+QT = core network sql testlib
+CONFIG += c++14 debug
+
+QTPLUGIN += QSQLMYSQL
+
+SOURCES = testpairing.cpp
+
+SOURCES += ../src/master_node.cpp \
+           ../src/tcp_thread.cpp \
+		   ../src/worker_connection.cpp \
+		   ../src/client_connection.cpp \
+		   ../src/client_session.cpp \
+		   ../src/command_table.cpp \
+		   ../src/consistent_hash_ring.cpp \
+		   ../src/db_pool.cpp \
+		   ../src/statement_registry.cpp \
+		   ../src/session_token.cpp \
+		   ../src/auth_cache.cpp \
+		   ../src/membership_cache.cpp \
+		   ../src/schedule_cache.cpp \
+		   ../src/availability.cpp \
+		   ../src/slot_bitset.cpp \
+		   ../src/slot_counter.cpp \
+		   ../src/interval_timeline.cpp \
+		   ../src/frame_codec.cpp \
+		   ../src/request_executor.cpp \
+		   ../src/tcp_connection.cpp \
+		   ../src/event_struct.cpp \
+		   ../src/user.cpp \
+		   ../src/worker_node.cpp \
+		   ../src/worker_selection_policy.cpp
+
+HEADERS += ../src/master_node.hpp \
+           ../src/tcp_thread.hpp \
+		   ../src/worker_connection.hpp \
+		   ../src/client_connection.hpp \
+		   ../src/client_session.hpp \
+		   ../src/command_table.hpp \
+		   ../src/consistent_hash_ring.hpp \
+		   ../src/db_pool.hpp \
+		   ../src/statement_registry.hpp \
+		   ../src/session_token.hpp \
+		   ../src/auth_cache.hpp \
+		   ../src/membership_cache.hpp \
+		   ../src/schedule_cache.hpp \
+		   ../src/availability.hpp \
+		   ../src/slot_bitset.hpp \
+		   ../src/slot_counter.hpp \
+		   ../src/interval_timeline.hpp \
+		   ../src/frame_codec.hpp \
+		   ../src/mpmc_queue.hpp \
+		   ../src/request_executor.hpp \
+		   ../src/tcp_connection.hpp \
+		   ../src/event_struct.hpp \
+		   ../src/user.hpp \
+		   ../src/worker_node.hpp \
+		   ../src/worker_selection_policy.hpp \
+		   ../src/thread_init_exception.hpp \
+		   ../src/tcp_comm.hpp
@@ -0,0 +1,10 @@
+QT = core network testlib
+CONFIG += c++14 debug
+
+SOURCES = testprotocol.cpp
+
+SOURCES += ../src/command_table.cpp \
+           ../src/frame_codec.cpp
+
+HEADERS += ../src/command_table.hpp \
+           ../src/frame_codec.hpp
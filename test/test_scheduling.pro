@@ -0,0 +1,16 @@
+QT = core testlib
+CONFIG += c++14 debug
+
+SOURCES = testscheduling.cpp
+
+SOURCES += ../src/availability.cpp \
+           ../src/slot_bitset.cpp \
+           ../src/slot_counter.cpp \
+           ../src/interval_timeline.cpp \
+           ../src/event_struct.cpp
+
+HEADERS += ../src/availability.hpp \
+           ../src/slot_bitset.hpp \
+           ../src/slot_counter.hpp \
+           ../src/interval_timeline.hpp \
+           ../src/event_struct.hpp
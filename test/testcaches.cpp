@@ -0,0 +1,164 @@
+// Copyright 2017 Hunter L. Allen
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <QtTest/QtTest>
+#include "../src/session_token.hpp"
+#include "../src/schedule_cache.hpp"
+
+class test_caches: public QObject
+{
+	Q_OBJECT
+public:
+	test_caches(QObject * _p_parent = NULL)
+		: QObject(_p_parent)
+		{ /* construct the test */ }
+private slots:
+	void test_session_token();
+	void test_schedule_cache();
+};
+
+void test_caches::test_session_token()
+{
+	session_token tokens("secret", 60);
+	QByteArray stamp = session_token::stamp("hunter2");
+	QString token = tokens.issue("billy", stamp, 1000);
+	QCOMPARE(token, QString("TOKEN:1060.") + token.mid(11));
+	QVERIFY(session_token::is_token(token));
+	QVERIFY(tokens.verify("billy", token, stamp, 1059));
+	/* it expires */
+	QVERIFY(!tokens.verify("billy", token, stamp, 1060));
+	/* it belongs to one user, whatever case the name is in */
+	QVERIFY(!tokens.verify("bob", token, stamp, 1000));
+	QVERIFY(tokens.verify("Billy", token, stamp, 1000));
+	/* and one password */
+	QVERIFY(!tokens.verify("billy", token, session_token::stamp("hunter3"), 1000));
+	/* and can not be pushed back */
+	QString later = token; later.replace("1060.", "9060.");
+	QVERIFY(!tokens.verify("billy", later, stamp, 1000));
+	/* nor made with another secret */
+	QVERIFY(!session_token("other", 60).verify("billy", token, stamp, 1000));
+	QVERIFY(!tokens.verify("billy", "TOKEN:1060", stamp, 1000));
+	QVERIFY(!tokens.verify("billy", "password123!", stamp, 1000));
+
+	/* stamps are remembered until revoked */
+	QByteArray known;
+	QVERIFY(!tokens.known_stamp("billy", known));
+	tokens.remember_stamp("BILLY", stamp, tokens.generation());
+	QVERIFY(tokens.known_stamp("billy", known));
+	QCOMPARE(known, stamp);
+	quint64 generation = tokens.generation();
+	tokens.revoke("Billy");
+	QVERIFY(!tokens.known_stamp("billy", known));
+	/* a stamp read before the revoke is not kept */
+	tokens.remember_stamp("billy", stamp, generation);
+	QVERIFY(!tokens.known_stamp("billy", known));
+}
+
+static schedule_cache::item make_item(const QDate & _date, const QString & _start)
+{
+	schedule_cache::item i;
+	i.date = _date; i.start = QTime::fromString(_start, "hh:mm"); i.duration = 60;
+	i.text = _date.toString(Qt::ISODate) + ":::" + _start;
+	return i;
+}
+
+void test_caches::test_schedule_cache()
+{
+	schedule_cache cache(1024 * 1024, 60000);
+	QDate day(2017, 4, 10);
+	schedule_cache::items all, got;
+	all << make_item(day, "09:00") << make_item(day.addDays(1), "10:00")
+		<< make_item(day.addDays(3), "08:00");
+
+	QVERIFY(!cache.range("billy", day, day.addDays(7), got));
+	cache.insert("billy", all, cache.generation());
+	QVERIFY(cache.range("billy", day.addDays(1), day.addDays(2), got));
+	QCOMPARE(got.size(), 1);
+	QCOMPARE(got[0].text, all[1].text);
+	/* a null end date is open */
+	got.clear();
+	QVERIFY(cache.range("billy", day.addDays(1), QDate(), got));
+	QCOMPARE(got.size(), 2);
+
+	/* a new event replaces its day, in order, whatever case the owner is in */
+	quint64 generation = cache.generation();
+	cache.update_day("BILLY", day.addDays(1), schedule_cache::items()
+		<< make_item(day.addDays(1), "07:00") << all[1], generation);
+	got.clear();
+	QVERIFY(cache.range("billy", day, day.addDays(3), got));
+	QCOMPARE(got.size(), 4);
+	QCOMPARE(got[1].start, QTime(7, 0));
+	QCOMPARE(got[3].date, day.addDays(3));
+
+	/* an update that raced another change drops the schedule */
+	generation = cache.generation();
+	cache.invalidate("bob");
+	cache.update_day("billy", day, schedule_cache::items(), generation);
+	QVERIFY(!cache.range("billy", day, day, got));
+	/* and so does a load */
+	generation = cache.generation();
+	cache.invalidate("billy");
+	cache.insert("billy", all, generation);
+	QVERIFY(!cache.range("billy", day, day, got));
+	QCOMPARE(cache.hits(), quint64(3));
+	QCOMPARE(cache.misses(), quint64(3));
+
+	/* month bitmaps follow the events */
+	cache.insert("billy", all, cache.generation());
+	quint32 days = 0;
+	QVERIFY(cache.month("billy", 2017, 4, days));
+	QCOMPARE(days, quint32((1 << 10) | (1 << 11) | (1 << 13)));
+	QCOMPARE(schedule_cache::days(all), days);
+	cache.update_day("billy", day.addDays(1), schedule_cache::items(), cache.generation());
+	QVERIFY(cache.month("billy", 2017, 4, days));
+	QCOMPARE(days, quint32((1 << 10) | (1 << 13)));
+	cache.update_day("billy", QDate(2017, 5, 31), schedule_cache::items()
+		<< make_item(QDate(2017, 5, 31), "12:00"), cache.generation());
+	QVERIFY(cache.month("billy", 2017, 5, days));
+	QCOMPARE(days, quint32(1) << 31);
+	QVERIFY(cache.month("billy", 2017, 6, days));
+	QCOMPARE(days, quint32(0));
+
+	/* a month read on its own is kept, without the events */
+	QVERIFY(!cache.month("bob", 2017, 4, days));
+	cache.insert_month("bob", 2017, 4, 1u << 3, cache.generation());
+	QVERIFY(cache.month("Bob", 2017, 4, days));
+	QCOMPARE(days, quint32(1) << 3);
+	QVERIFY(!cache.month("bob", 2017, 5, days));
+	QVERIFY(!cache.range("bob", day, day, got));
+	/* and follows new events */
+	cache.update_day("bob", QDate(2017, 4, 5), schedule_cache::items()
+		<< make_item(QDate(2017, 4, 5), "12:00"), cache.generation());
+	QVERIFY(cache.month("bob", 2017, 4, days));
+	QCOMPARE(days, quint32((1 << 3) | (1 << 5)));
+	/* a read that raced a change is not kept */
+	cache.invalidate("bob");
+	generation = cache.generation();
+	cache.invalidate("billy");
+	cache.insert_month("bob", 2017, 4, 0, generation);
+	QVERIFY(!cache.month("bob", 2017, 4, days));
+	/* and a whole schedule is not overridden */
+	cache.insert("billy", all, cache.generation());
+	cache.insert_month("billy", 2017, 4, 0, cache.generation());
+	QVERIFY(cache.month("billy", 2017, 4, days));
+	QCOMPARE(days, schedule_cache::days(all));
+
+	/* schedules over the budget are not kept */
+	schedule_cache small(64, 60000);
+	small.insert("billy", all, small.generation());
+	QCOMPARE(small.size(), 0);
+}
+
+QTEST_MAIN(test_caches)
+#include "testcaches.moc"
@@ -14,6 +14,7 @@
 
 #include <QtTest/QtTest>
 #include "../src/worker_node.hpp"
+#include "../src/frame_codec.hpp"
 
 class test_client_requests: public QObject
 {
@@ -25,7 +26,15 @@ public:
 		  m_p_worker(new worker_node("localhost", 3442))
 		{ /* construct the test */ }
 private slots:
+	void initTestCase();
 	void test_create();
+	void test_session();
+	void test_binary_session();
+	void test_pipeline();
+	void test_concurrent_clients();
+	void test_worker_stats();
+	void test_cache_stats();
+	void cleanupTestCase();
 private:
 	master_node * m_p_master;
 	worker_node * m_p_worker;
@@ -33,12 +42,17 @@ private:
 
 
 
-void test_client_requests::test_create()
+void test_client_requests::initTestCase()
 {
 	/* initialize the master */
 	QVERIFY(m_p_master->init());
-	/* initialize the worker */
+	/* initialize the worker, with two database threads */
+	m_p_worker->set_db_pool_size(2);
 	QVERIFY(m_p_worker->init());
+}
+
+void test_client_requests::test_create()
+{
 	/* create a new socket */
 	QTcpSocket * p_client = new QTcpSocket();
 	/* connect to master */
@@ -64,6 +78,199 @@ void test_client_requests::test_create()
 	QVERIFY(host == "localhost");
 	/* verify the port is correct */
 	QVERIFY(port == "3442");
+	delete p_client;
+}
+
+void test_client_requests::test_session()
+{
+	QTcpSocket * p_client = new QTcpSocket();
+	/* connect straight to the worker */
+	p_client->connectToHost("localhost", 3442, QIODevice::ReadWrite);
+	QTRY_VERIFY(p_client->state() == QAbstractSocket::ConnectedState);
+	/* ask to keep the connection open */
+	p_client->write("BEGIN_SESSION\r\n");
+	QTRY_VERIFY(p_client->canReadLine());
+	QCOMPARE(QString(p_client->readLine()), QString("OK\r\n"));
+	/* a session survives several requests */
+	for (int x = 0; x < 3; ++x) {
+		p_client->write("REQUEST_LOGIN fake:::morefake\r\n");
+		QTRY_VERIFY(p_client->canReadLine());
+		QCOMPARE(QString(p_client->readLine()),
+				 QString("ERROR: AUTHENTICATION FAILED\r\n"));
+		QVERIFY(p_client->state() == QAbstractSocket::ConnectedState);
+	}
+	/* framing can only be picked on the first line */
+	p_client->write("FRAMING BINARY\r\n");
+	QTRY_VERIFY(p_client->canReadLine());
+	QCOMPARE(QString(p_client->readLine()), QString("ERROR: UNSUPPORTED FRAMING\r\n"));
+	/* and is closed on request */
+	p_client->write("END_SESSION\r\n");
+	QTRY_VERIFY(p_client->canReadLine());
+	QCOMPARE(QString(p_client->readLine()), QString("BYE\r\n"));
+	QTRY_VERIFY(p_client->state() == QAbstractSocket::UnconnectedState);
+	delete p_client;
+}
+
+void test_client_requests::test_binary_session()
+{
+	QTcpSocket * p_client = new QTcpSocket();
+	p_client->connectToHost("localhost", 3442, QIODevice::ReadWrite);
+	QTRY_VERIFY(p_client->state() == QAbstractSocket::ConnectedState);
+	/* the handshake is plain text */
+	p_client->write("FRAMING BINARY\r\n");
+	QTRY_VERIFY(p_client->canReadLine());
+	QCOMPARE(QString(p_client->readLine()), QString("OK\r\n"));
+	/* send a frame in two pieces */
+	QByteArray frame = frame_codec::encode_request("REQUEST_LOGIN",
+		QVariantList() << "fake" << "morefake");
+	p_client->write(frame.left(7)); p_client->waitForBytesWritten(-1);
+	QTest::qWait(50);
+	p_client->write(frame.mid(7));
+	/* the reply is a frame too */
+	QByteArray expected = frame_codec::encode_reply("ERROR: AUTHENTICATION FAILED\r\n");
+	QTRY_VERIFY(p_client->bytesAvailable() >= expected.size());
+	QCOMPARE(p_client->read(expected.size()), expected);
+	QVERIFY(p_client->state() == QAbstractSocket::ConnectedState);
+	/* two frames at once */
+	p_client->write(frame + frame);
+	QTRY_VERIFY(p_client->bytesAvailable() >= 2 * expected.size());
+	QCOMPARE(p_client->read(2 * expected.size()), expected + expected);
+	/* a field may not hold the text protocol's separator */
+	p_client->write(frame_codec::encode_request("REQUEST_LOGIN",
+		QVariantList() << "fake:::more" << "fake"));
+	QByteArray invalid = frame_codec::encode_reply("ERROR: INVALID REQUEST\r\n");
+	QTRY_VERIFY(p_client->bytesAvailable() >= invalid.size());
+	QCOMPARE(p_client->read(invalid.size()), invalid);
+	QVERIFY(p_client->state() == QAbstractSocket::ConnectedState);
+	/* close it */
+	p_client->write(frame_codec::encode_request("END_SESSION", QVariantList()));
+	QTRY_VERIFY(p_client->state() == QAbstractSocket::UnconnectedState);
+	QCOMPARE(p_client->readAll(), frame_codec::encode_reply("BYE\r\n"));
+	delete p_client;
+}
+
+void test_client_requests::test_pipeline()
+{
+	QTcpSocket * p_client = new QTcpSocket();
+	p_client->connectToHost("localhost", 3442, QIODevice::ReadWrite);
+	QTRY_VERIFY(p_client->state() == QAbstractSocket::ConnectedState);
+	/* send everything at once, without waiting for replies */
+	p_client->write("BEGIN_SESSION\r\n"
+					"REQUEST_LOGIN fake:::morefake\r\n"
+					"NOT_A_COMMAND\r\n"
+					"REQUEST_LOGIN fake:::morefake\r\n"
+					"END_SESSION\r\n");
+	QTRY_VERIFY(p_client->state() == QAbstractSocket::UnconnectedState);
+	/* the replies come back in request order */
+	QStringList expected;
+	expected << "OK\r\n"
+			 << "ERROR: AUTHENTICATION FAILED\r\n"
+			 << "ERROR: INVALID COMMAND\r\n"
+			 << "ERROR: AUTHENTICATION FAILED\r\n"
+			 << "BYE\r\n";
+	for (const QString & reply : expected) {
+		QVERIFY(p_client->canReadLine());
+		QCOMPARE(QString(p_client->readLine()), reply);
+	}
+	delete p_client;
+}
+
+void test_client_requests::test_concurrent_clients()
+{
+	const int num_clients = 50;
+	QList<QTcpSocket *> clients;
+	/* open a session on every client before any of them finish */
+	for (int x = 0; x < num_clients; ++x) {
+		QTcpSocket * p_client = new QTcpSocket();
+		p_client->connectToHost("localhost", 3442, QIODevice::ReadWrite);
+		p_client->write("BEGIN_SESSION\r\n");
+		clients.append(p_client);
+	}
+	for (QTcpSocket * p_client : clients) {
+		QTRY_VERIFY(p_client->canReadLine());
+		QCOMPARE(QString(p_client->readLine()), QString("OK\r\n"));
+	}
+	/* every client is served while the others stay connected */
+	for (QTcpSocket * p_client : clients) {
+		p_client->write("REQUEST_LOGIN fake:::morefake\r\n");
+	}
+	for (QTcpSocket * p_client : clients) {
+		QTRY_VERIFY(p_client->canReadLine());
+		QCOMPARE(QString(p_client->readLine()),
+				 QString("ERROR: AUTHENTICATION FAILED\r\n"));
+		QVERIFY(p_client->state() == QAbstractSocket::ConnectedState);
+	}
+	for (QTcpSocket * p_client : clients) {
+		p_client->write("END_SESSION\r\n");
+	}
+	for (QTcpSocket * p_client : clients) {
+		QTRY_VERIFY(p_client->state() == QAbstractSocket::UnconnectedState);
+		delete p_client;
+	}
+}
+
+void test_client_requests::test_worker_stats()
+{
+	QTcpSocket * p_client = new QTcpSocket();
+	p_client->connectToHost("localhost", 3442, QIODevice::ReadWrite);
+	QTRY_VERIFY(p_client->state() == QAbstractSocket::ConnectedState);
+	p_client->write("WORKER_STATS\r\n");
+	/* the worker hangs up once the stats are sent */
+	QTRY_VERIFY(p_client->state() == QAbstractSocket::UnconnectedState);
+	QList<QByteArray> lines = p_client->readAll().split('\n');
+	lines.removeAll(QByteArray());
+	QVERIFY(lines.size() >= 2);
+	/* a pooled connection per executor thread, and no more */
+	int connections = lines[0].trimmed().toInt();
+	QCOMPARE(connections, lines.size() - 1);
+	QCOMPARE(connections, 2);
+	quint64 checkouts = 0, executes = 0;
+	for (int x = 1; x < lines.size(); ++x) {
+		QList<QByteArray> fields = lines[x].trimmed().split(':');
+		fields.removeAll(QByteArray());
+		QCOMPARE(fields.size(), 7);
+		checkouts += fields[1].toULongLong();
+		executes += fields[6].toULongLong();
+		/* requests reuse the open connections */
+		QVERIFY(fields[3].toULongLong() <= fields[1].toULongLong());
+	}
+	QVERIFY(checkouts > 0);
+	/* the earlier requests ran prepared statements */
+	QVERIFY(executes > 0);
+	delete p_client;
+}
+
+void test_client_requests::test_cache_stats()
+{
+	QTcpSocket * p_client = new QTcpSocket();
+	p_client->connectToHost("localhost", 3442, QIODevice::ReadWrite);
+	QTRY_VERIFY(p_client->state() == QAbstractSocket::ConnectedState);
+	p_client->write("CACHE_STATS\r\n");
+	QTRY_VERIFY(p_client->state() == QAbstractSocket::UnconnectedState);
+	QList<QByteArray> lines = p_client->readAll().split('\n');
+	lines.removeAll(QByteArray());
+	QVERIFY(lines.size() >= 4);
+	QCOMPARE(lines[0].trimmed().toInt(), lines.size() - 1);
+	QList<QByteArray> fields = lines[1].trimmed().split(':');
+	fields.removeAll(QByteArray());
+	QCOMPARE(fields.size(), 4);
+	QCOMPARE(fields[0], QByteArray("auth"));
+	/* the failed logins of test_session were never cached */
+	QVERIFY(fields[2].toULongLong() >= 3);
+	QCOMPARE(fields[3].toInt(), 0);
+	fields = lines[2].trimmed().split(':');
+	fields.removeAll(QByteArray());
+	QCOMPARE(fields.size(), 4);
+	QCOMPARE(fields[0], QByteArray("membership"));
+	fields = lines[3].trimmed().split(':');
+	fields.removeAll(QByteArray());
+	QCOMPARE(fields.size(), 4);
+	QCOMPARE(fields[0], QByteArray("schedule"));
+	delete p_client;
+}
+
+void test_client_requests::cleanupTestCase()
+{
 	m_p_master->stop(); m_p_worker->stop();
 	delete m_p_master; delete m_p_worker;
 }
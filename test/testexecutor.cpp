@@ -0,0 +1,52 @@
+// Copyright 2017 Hunter L. Allen
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <QtTest/QtTest>
+#include "../src/request_executor.hpp"
+
+class test_executor: public QObject
+{
+	Q_OBJECT
+public:
+	test_executor(QObject * _p_parent = NULL)
+		: QObject(_p_parent)
+		{ /* construct the test */ }
+private slots:
+	void test_bounded_queue();
+};
+
+void test_executor::test_bounded_queue()
+{
+	request_executor executor(2, 4);
+	QCOMPARE(executor.thread_count(), 2);
+	QSemaphore started, release;
+	QAtomicInt done;
+	/* keep both threads busy */
+	for (int x = 0; x < 2; ++x) {
+		QVERIFY(executor.submit([&]() {started.release(); release.acquire(); done.ref();}));
+	}
+	started.acquire(2);
+	/* four tasks may wait, the fifth is turned away */
+	for (int x = 0; x < 4; ++x) {QVERIFY(executor.submit([&]() {done.ref();}));}
+	QVERIFY(!executor.submit([&]() {done.ref();}));
+	QCOMPARE(executor.queued(), 4);
+	/* everything queued is run before stop returns */
+	release.release(2);
+	executor.stop();
+	QCOMPARE(done.load(), 6);
+	QVERIFY(!executor.submit([&]() {done.ref();}));
+}
+
+QTEST_MAIN(test_executor)
+#include "testexecutor.moc"
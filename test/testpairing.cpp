@@ -0,0 +1,395 @@
+// Copyright 2017 Hunter L. Allen
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <QtTest/QtTest>
+#include "../src/master_node.hpp"
+#include "../src/mpmc_queue.hpp"
+
+#include <thread>
+
+class test_pairing: public QObject
+{
+	Q_OBJECT
+public:
+	test_pairing(QObject * _p_parent = NULL)
+		: QObject(_p_parent),
+		  m_p_master(new master_node("localhost", 3225))
+		{ /* construct the test */ }
+private slots:
+	void initTestCase();
+	void test_queue_order();
+	void test_queue_bounds();
+	void test_queue_threads();
+	void test_connection_state();
+	void test_pair();
+	void test_dropped_client();
+	void test_policies();
+	void test_affinity();
+	void test_load_report();
+	void test_control_connection();
+	void test_routing_table();
+	void bench_pairing_storm_data();
+	void bench_pairing_storm();
+	void cleanupTestCase();
+private:
+	QTcpSocket * connect_worker(const QString & _location);
+	QTcpSocket * connect_client();
+	QList<QByteArray> routing_table();
+	master_node * m_p_master;
+};
+
+void test_pairing::initTestCase()
+{
+	QVERIFY(m_p_master->init());
+}
+
+/**
+ * Register a (fake) worker with the master.
+ */
+QTcpSocket * test_pairing::connect_worker(const QString & _location)
+{
+	QTcpSocket * p_worker = new QTcpSocket();
+	p_worker->connectToHost("localhost", 3225, QIODevice::ReadWrite);
+	p_worker->write(QString("REQUEST_CLIENT\r\n" + _location + "\r\n").toUtf8());
+	return p_worker;
+}
+
+/**
+ * Ask the master for a worker.
+ */
+QTcpSocket * test_pairing::connect_client()
+{
+	QTcpSocket * p_client = new QTcpSocket();
+	p_client->connectToHost("localhost", 3225, QIODevice::ReadWrite);
+	p_client->write("REQUEST_WORKER\r\n");
+	return p_client;
+}
+
+/**
+ * Fetch the master's routing table, one line per entry.
+ */
+QList<QByteArray> test_pairing::routing_table()
+{
+	QTcpSocket client;
+	client.connectToHost("localhost", 3225, QIODevice::ReadWrite);
+	client.write("ROUTING_TABLE\r\n");
+	/* the master hangs up once the table is sent */
+	for (int x = 0; x < 100 && client.state() != QAbstractSocket::UnconnectedState; ++x) {
+		QTest::qWait(50);
+	}
+	QList<QByteArray> lines = client.readAll().split('\n');
+	for (QByteArray & line : lines) {line = line.trimmed();}
+	lines.removeAll(QByteArray());
+	return lines;
+}
+
+void test_pairing::test_queue_order()
+{
+	mpmc_queue<int> queue(8);
+	int out = 0;
+	QVERIFY(!queue.dequeue(out));
+	/* go around the ring a few times */
+	for (int x = 0; x < 20; ++x) {
+		QVERIFY(queue.enqueue(x));
+		QVERIFY(queue.enqueue(x + 100));
+		QVERIFY(queue.dequeue(out)); QCOMPARE(out, x);
+		QVERIFY(queue.dequeue(out)); QCOMPARE(out, x + 100);
+	}
+	QVERIFY(!queue.dequeue(out));
+}
+
+void test_pairing::test_queue_bounds()
+{
+	mpmc_queue<int> queue(4);
+	QCOMPARE((int) queue.capacity(), 4);
+	for (int x = 0; x < 4; ++x) {QVERIFY(queue.enqueue(x));}
+	/* full */
+	QVERIFY(!queue.enqueue(4));
+	int out = 0;
+	QVERIFY(queue.dequeue(out)); QCOMPARE(out, 0);
+	QVERIFY(queue.enqueue(4));
+}
+
+void test_pairing::test_queue_threads()
+{
+	const int threads = 4, per_thread = 100000;
+	mpmc_queue<qint64> queue(1024);
+	std::atomic<qint64> sum(0);
+	std::atomic<int> taken(0);
+	std::vector<std::thread> pool;
+	for (int t = 0; t < threads; ++t) {
+		pool.emplace_back([&queue]() {
+			for (qint64 x = 1; x <= per_thread; ++x) {
+				while (!queue.enqueue(x)) {std::this_thread::yield();}
+			}
+		});
+		pool.emplace_back([&queue, &sum, &taken]() {
+			qint64 value;
+			while (taken.load() < threads * per_thread) {
+				if (queue.dequeue(value)) {sum += value; ++taken;}
+			}
+		});
+	}
+	for (std::thread & t : pool) {t.join();}
+	/* every element came out exactly once */
+	QCOMPARE(taken.load(), threads * per_thread);
+	QCOMPARE(sum.load(), (qint64) threads * per_thread * (per_thread + 1) / 2);
+}
+
+void test_pairing::test_connection_state()
+{
+	QString host("localhost");
+	tcp_connection first(host, NULL), second(host, NULL);
+	/* ids tell connections apart without touching the socket */
+	QVERIFY(first.get_id() != second.get_id());
+	QVERIFY(first == first);
+	QVERIFY(!(first == second));
+	/* a connection is claimed once */
+	QVERIFY(first.claim());
+	QVERIFY(!first.claim());
+	/* and a dropped one not at all */
+	second.mark_dropped();
+	QVERIFY(second.is_dropped());
+	QVERIFY(!second.claim());
+}
+
+void test_pairing::test_pair()
+{
+	QTcpSocket * p_worker = connect_worker("localhost:4000");
+	QTcpSocket * p_client = connect_client();
+	/* both sides hear about the pairing */
+	QTRY_VERIFY(p_worker->canReadLine());
+	QCOMPARE(QString(p_worker->readLine()), QString("OK\r\n"));
+	QTRY_VERIFY(p_client->canReadLine());
+	QCOMPARE(QString(p_client->readLine()), QString("localhost:4000\r\n"));
+	delete p_worker; delete p_client;
+}
+
+void test_pairing::test_dropped_client()
+{
+	/* a client that hangs up while queued is never paired */
+	QTcpSocket * p_quitter = connect_client();
+	QTRY_VERIFY(p_quitter->state() == QAbstractSocket::ConnectedState &&
+		!p_quitter->bytesToWrite());
+	QTest::qWait(50);
+	p_quitter->disconnectFromHost();
+	QTRY_VERIFY(p_quitter->state() == QAbstractSocket::UnconnectedState);
+	QTest::qWait(50);
+	/* so the next client gets the worker */
+	QTcpSocket * p_client = connect_client();
+	QTcpSocket * p_worker = connect_worker("localhost:4001");
+	QTRY_VERIFY(p_client->canReadLine());
+	QCOMPARE(QString(p_client->readLine()), QString("localhost:4001\r\n"));
+	delete p_quitter; delete p_client; delete p_worker;
+}
+
+void test_pairing::test_policies()
+{
+	/* three idle workers, oldest first */
+	QList<worker_connection *> workers;
+	for (int x = 0; x < 3; ++x) {
+		QString location = "localhost:" + QString::number(6000 + x);
+		workers.append(new worker_connection(location, NULL));
+	}
+	workers[0]->set_load(5, 100);
+	workers[1]->set_load(1, 900);
+	workers[2]->set_load(1, 300);
+
+	fifo_policy fifo;
+	QCOMPARE(fifo.select(workers), 0);
+	least_outstanding_policy least;
+	QCOMPARE(least.select(workers), 1);
+	latency_policy latency;
+	QCOMPARE(latency.select(workers), 0);
+	/* of any two workers, p2c never takes the busier one */
+	power_of_two_policy p2c(42);
+	for (int x = 0; x < 100; ++x) {QVERIFY(p2c.select(workers) != 0);}
+	QList<worker_connection *> one;
+	one << workers[0];
+	QCOMPARE(p2c.select(one), 0);
+
+	QVERIFY(worker_selection_policy::create("nonsense") == NULL);
+	worker_selection_policy * p_policy = worker_selection_policy::create("p2c");
+	QCOMPARE(QString(p_policy->name()), QString("p2c"));
+	delete p_policy;
+	qDeleteAll(workers);
+}
+
+void test_pairing::test_affinity()
+{
+	consistent_hash_ring ring;
+	QVERIFY(ring.find("alice").isEmpty());
+	ring.add_node("localhost:7000");
+	ring.add_node("localhost:7001");
+	ring.add_node("localhost:7002");
+	QString home = ring.find("alice");
+	QVERIFY(ring.contains_node(home));
+	QCOMPARE(ring.find("alice"), home);
+	/* taking away another node leaves the key where it was */
+	QString other = (home == "localhost:7000") ? "localhost:7001" : "localhost:7000";
+	ring.remove_node(other);
+	QCOMPARE(ring.find("alice"), home);
+	/* and taking away its node moves it */
+	ring.remove_node(home);
+	QCOMPARE(ring.size(), 1);
+	QVERIFY(ring.find("alice") != home);
+
+	QList<worker_connection *> workers;
+	affinity_policy affinity;
+	for (int x = 0; x < 3; ++x) {
+		QString location = "localhost:" + QString::number(7000 + x);
+		workers.append(new worker_connection(location, NULL));
+		affinity.worker_added(workers[x]);
+	}
+	int first = affinity.select_for(workers, "alice");
+	for (int x = 0; x < 10; ++x) {QCOMPARE(affinity.select_for(workers, "alice"), first);}
+	/* a worker well over the average load is passed over */
+	workers[first]->set_load(10, 0);
+	QVERIFY(affinity.select_for(workers, "alice") != first);
+	/* and so is it for clients with no username */
+	QVERIFY(affinity.select_for(workers, QString()) != first);
+	for (worker_connection * w : workers) {affinity.worker_removed(w);}
+	qDeleteAll(workers);
+}
+
+void test_pairing::test_load_report()
+{
+	/* the master is running fifo, so give it one loaded and one idle worker */
+	QTcpSocket * p_busy = new QTcpSocket();
+	p_busy->connectToHost("localhost", 3225, QIODevice::ReadWrite);
+	p_busy->write("REQUEST_CLIENT\r\nlocalhost:4002\r\nLOAD 7:::2500\r\n");
+	QTRY_VERIFY(p_busy->state() == QAbstractSocket::ConnectedState && !p_busy->bytesToWrite());
+	QTest::qWait(50);
+	QTcpSocket * p_idle = connect_worker("localhost:4003");
+	QTRY_VERIFY(p_idle->state() == QAbstractSocket::ConnectedState && !p_idle->bytesToWrite());
+	QTest::qWait(50);
+	/* the load line does not get in the way of pairing */
+	QTcpSocket * p_first = connect_client();
+	QTRY_VERIFY(p_first->canReadLine());
+	QCOMPARE(QString(p_first->readLine()), QString("localhost:4002\r\n"));
+	QTcpSocket * p_second = connect_client();
+	QTRY_VERIFY(p_second->canReadLine());
+	QCOMPARE(QString(p_second->readLine()), QString("localhost:4003\r\n"));
+	delete p_busy; delete p_idle; delete p_first; delete p_second;
+}
+
+void test_pairing::test_control_connection()
+{
+	/* a registered worker with room for two clients */
+	QTcpSocket * p_worker = new QTcpSocket();
+	p_worker->connectToHost("localhost", 3225, QIODevice::ReadWrite);
+	p_worker->write("REGISTER_WORKER\r\nlocalhost:4004\r\nLOAD 0:::0:::2:::0\r\n");
+	QTRY_VERIFY(p_worker->state() == QAbstractSocket::ConnectedState && !p_worker->bytesToWrite());
+	QTest::qWait(50);
+	QTcpSocket * p_first = connect_client();
+	QTRY_VERIFY(p_first->canReadLine());
+	QCOMPARE(QString(p_first->readLine()), QString("localhost:4004\r\n"));
+	QTcpSocket * p_second = connect_client();
+	QTRY_VERIFY(p_second->canReadLine());
+	QCOMPARE(QString(p_second->readLine()), QString("localhost:4004\r\n"));
+	/* the worker hears about both, and stays connected */
+	QTRY_VERIFY(p_worker->bytesAvailable() >= 16);
+	QCOMPARE(QString(p_worker->readAll()), QString("PAIRED\r\nPAIRED\r\n"));
+	QCOMPARE(p_worker->state(), QAbstractSocket::ConnectedState);
+	/* no room left, so the next client waits for a report */
+	QTcpSocket * p_third = connect_client();
+	QTest::qWait(200);
+	QVERIFY(!p_third->canReadLine());
+	p_worker->write("LOAD 1:::100:::1:::2\r\n");
+	QTRY_VERIFY(p_third->canReadLine());
+	QCOMPARE(QString(p_third->readLine()), QString("localhost:4004\r\n"));
+	delete p_third; delete p_second; delete p_first; delete p_worker;
+}
+
+void test_pairing::test_routing_table()
+{
+	QTcpSocket * p_worker = new QTcpSocket();
+	p_worker->connectToHost("localhost", 3225, QIODevice::ReadWrite);
+	p_worker->write("REGISTER_WORKER\r\nlocalhost:4005\r\nLOAD 0:::0:::3:::0\r\n");
+	QTRY_VERIFY(p_worker->state() == QAbstractSocket::ConnectedState && !p_worker->bytesToWrite());
+	QTest::qWait(100);
+
+	QList<QByteArray> table = routing_table();
+	QVERIFY(table.size() >= 2);
+	QList<QByteArray> header = table[0].split(':');
+	header.removeAll(QByteArray());
+	QCOMPARE(header.size(), 2);
+	QCOMPARE(header[1].toInt(), table.size() - 1);
+	QVERIFY(table.contains("localhost:4005:::3"));
+
+	/* a worker that leaves is taken out, and the version moves on */
+	delete p_worker;
+	/* the table is refreshed once a second */
+	QTest::qWait(1500);
+	QList<QByteArray> after = routing_table();
+	QVERIFY(!after.isEmpty());
+	QVERIFY(!after.contains("localhost:4005:::3"));
+	QVERIFY(after[0].split(':')[0].toULongLong() > header[0].toULongLong());
+}
+
+void test_pairing::bench_pairing_storm_data()
+{
+	QTest::addColumn<int>("pairs");
+	QTest::newRow("10 pairs") << 10;
+	QTest::newRow("100 pairs") << 100;
+	QTest::newRow("500 pairs") << 500;
+}
+
+/**
+ * Queue up a batch of workers, then throw a storm of
+ * REQUEST_WORKER connections at the master and time
+ * how long it takes until every client has its worker.
+ */
+void test_pairing::bench_pairing_storm()
+{
+	QFETCH(int, pairs);
+	QList<QTcpSocket *> workers, clients;
+	for (int x = 0; x < pairs; ++x) {
+		workers.append(connect_worker("localhost:" + QString::number(5000 + x)));
+	}
+	for (QTcpSocket * p_worker : workers) {
+		QTRY_VERIFY(p_worker->state() == QAbstractSocket::ConnectedState &&
+			!p_worker->bytesToWrite());
+	}
+
+	QElapsedTimer timer;
+	timer.start();
+	for (int x = 0; x < pairs; ++x) {
+		clients.append(connect_client());
+	}
+	for (QTcpSocket * p_client : clients) {
+		QTRY_VERIFY_WITH_TIMEOUT(p_client->canReadLine(), 30000);
+	}
+	qint64 elapsed = timer.elapsed();
+	std::cout << pairs << " pairings in " << elapsed << " ms (" <<
+		(elapsed ? pairs * 1000 / elapsed : pairs * 1000) << " pairings/second)" << std::endl;
+
+	/* every worker was handed out exactly once */
+	QSet<QString> locations;
+	for (QTcpSocket * p_client : clients) {
+		locations.insert(QString(p_client->readLine()));
+	}
+	QCOMPARE(locations.size(), pairs);
+
+	qDeleteAll(workers); qDeleteAll(clients);
+}
+
+void test_pairing::cleanupTestCase()
+{
+	m_p_master->stop();
+	delete m_p_master;
+}
+
+QTEST_MAIN(test_pairing)
+#include "testpairing.moc"
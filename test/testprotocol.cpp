@@ -0,0 +1,201 @@
+// Copyright 2017 Hunter L. Allen
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <QtTest/QtTest>
+#include "../src/command_table.hpp"
+#include "../src/frame_codec.hpp"
+
+/* every verb the worker understands, in the order the old chain tested them */
+static const char * const verbs[] = {
+	"CREATE_ACCOUNT", "REQUEST_LOGIN", "CREATE_GROUP_EVENT", "CREATE_GROUP",
+	"JOIN_GROUP", "LEAVE_GROUP", "UPDATE_ACCOUNT", "REQUEST_GROUPS",
+	"REQUEST_ACCOUNT", "DELETE_GROUP", "REQUEST_USERS", "CREATE_USER_EVENT",
+	"REQUEST_RESET", "REQUEST_EVENTS", "REQUEST_GROUP_EVENTS",
+	"REQUEST_PERSONAL_MONTH_EVENTS", "REQUEST_GROUP_MONTH_EVENTS",
+	"CREATE_FRIENDSHIP", "ACCEPT_FRIEND", "REQUEST_FRIENDS", "DELETE_FRIEND",
+	"FRIEND_REQUESTS", "ABSENT", "PRESENT", "SUGGEST_TIMES", "REQUEST_TIMES"
+};
+static const int num_verbs = sizeof(verbs) / sizeof(verbs[0]);
+
+/**
+ * The dispatch the worker used before the command table:
+ * walk the verbs with QString::contains until one matches,
+ * then strip the verb off a copy of the line.
+ */
+static int legacy_dispatch(const QByteArray & _line, QString ** _p_payload)
+{
+	QString text(_line);
+	for (int x = 0; x < num_verbs; ++x) {
+		if (text.contains(verbs[x])) {
+			text.replace(QString(verbs[x]) + " ", "");
+			*_p_payload = new QString(text);
+			return x;
+		}
+	}
+	return -1;
+}
+
+class test_protocol: public QObject
+{
+	Q_OBJECT
+public:
+	test_protocol(QObject * _p_parent = NULL)
+		: QObject(_p_parent)
+		{ /* construct the test */ }
+private slots:
+	void initTestCase();
+	void test_dispatch();
+	void test_unknown_verb();
+	void test_frame_round_trip();
+	void test_partial_frame();
+	void test_malformed_frame();
+	void bench_dispatch_data();
+	void bench_dispatch();
+private:
+	command_table m_table;
+	int m_last = -1;
+	QString m_last_payload;
+};
+
+void test_protocol::initTestCase()
+{
+	for (int x = 0; x < num_verbs; ++x) {
+		m_table.register_command(verbs[x], [this, x](QString * _p_text, QTcpSocket *) {
+			m_last = x; m_last_payload = *_p_text; delete _p_text;
+		});
+	}
+	QCOMPARE(m_table.size(), num_verbs);
+}
+
+void test_protocol::test_dispatch()
+{
+	/* CREATE_GROUP is a prefix of CREATE_GROUP_EVENT; make sure they stay apart */
+	QVERIFY(m_table.dispatch("CREATE_GROUP_EVENT bob:::lunch", NULL));
+	QCOMPARE(QString(verbs[m_last]), QString("CREATE_GROUP_EVENT"));
+	QCOMPARE(m_last_payload, QString("bob:::lunch"));
+	QVERIFY(m_table.dispatch("CREATE_GROUP bob:::lunch", NULL));
+	QCOMPARE(QString(verbs[m_last]), QString("CREATE_GROUP"));
+	QCOMPARE(m_last_payload, QString("bob:::lunch"));
+	/* a verb with no payload */
+	QVERIFY(m_table.dispatch("PRESENT", NULL));
+	QCOMPARE(QString(verbs[m_last]), QString("PRESENT"));
+	QVERIFY(m_last_payload.isEmpty());
+}
+
+void test_protocol::test_unknown_verb()
+{
+	m_last = -1;
+	QVERIFY(!m_table.dispatch("NOT_A_VERB foo", NULL));
+	QVERIFY(!m_table.dispatch("", NULL));
+	/* verbs are matched exactly, not as substrings */
+	QVERIFY(!m_table.dispatch("XREQUEST_LOGIN foo:::bar", NULL));
+	QCOMPARE(m_last, -1);
+}
+
+void test_protocol::test_frame_round_trip()
+{
+	QByteArray frame = frame_codec::encode_request("CREATE_USER_EVENT",
+		QVariantList() << QString::fromUtf8("j\u00f6rg") << (qint64) -42 << QString());
+	QBuffer buffer(&frame);
+	buffer.open(QIODevice::ReadOnly);
+	QByteArray verb;
+	QList<QByteArray> fields;
+	QCOMPARE(frame_codec::read_request(&buffer, verb, fields), frame_codec::COMPLETE);
+	QCOMPARE(verb, QByteArray("CREATE_USER_EVENT"));
+	QCOMPARE(fields.size(), 3);
+	QCOMPARE(QString::fromUtf8(fields[0]), QString::fromUtf8("j\u00f6rg"));
+	QCOMPARE(fields[1], QByteArray("-42"));
+	QVERIFY(fields[2].isEmpty());
+	QCOMPARE(buffer.bytesAvailable(), (qint64) 0);
+	/* replies drop the line terminator */
+	QByteArray reply = frame_codec::encode_reply("OK\r\n");
+	QCOMPARE(reply, QByteArray("\0\0\0\2OK", 6));
+}
+
+void test_protocol::test_partial_frame()
+{
+	QByteArray frame = frame_codec::encode_request("REQUEST_LOGIN",
+		QVariantList() << "user" << "pass");
+	QByteArray verb;
+	QList<QByteArray> fields;
+	/* every prefix is incomplete, and nothing is consumed */
+	for (int x = 0; x < frame.size(); ++x) {
+		QByteArray prefix = frame.left(x);
+		QBuffer buffer(&prefix);
+		buffer.open(QIODevice::ReadOnly);
+		QCOMPARE(frame_codec::read_request(&buffer, verb, fields), frame_codec::INCOMPLETE);
+		QCOMPARE(buffer.pos(), (qint64) 0);
+	}
+	/* two frames back to back come out one at a time */
+	QByteArray two = frame + frame;
+	QBuffer buffer(&two);
+	buffer.open(QIODevice::ReadOnly);
+	QCOMPARE(frame_codec::read_request(&buffer, verb, fields), frame_codec::COMPLETE);
+	QCOMPARE(buffer.pos(), (qint64) frame.size());
+	QCOMPARE(frame_codec::read_request(&buffer, verb, fields), frame_codec::COMPLETE);
+	QCOMPARE(fields, QList<QByteArray>() << "user" << "pass");
+	QCOMPARE(frame_codec::read_request(&buffer, verb, fields), frame_codec::INCOMPLETE);
+}
+
+void test_protocol::test_malformed_frame()
+{
+	QByteArray verb;
+	QList<QByteArray> fields;
+	/* a body that claims to be too large */
+	QByteArray huge("\x7f\xff\xff\xff", 4);
+	QBuffer buffer(&huge);
+	buffer.open(QIODevice::ReadOnly);
+	QCOMPARE(frame_codec::read_request(&buffer, verb, fields), frame_codec::MALFORMED);
+	/* a field that runs past the end of the body */
+	QByteArray body = frame_codec::encode_request("PRESENT",
+		QVariantList() << "abc").mid(frame_codec::HEADER_SIZE);
+	QVERIFY(frame_codec::decode_request(body, verb, fields));
+	QVERIFY(!frame_codec::decode_request(body.left(body.size() - 1), verb, fields));
+	/* trailing bytes */
+	QVERIFY(!frame_codec::decode_request(body + 'x', verb, fields));
+	/* unknown field type */
+	body[2 + 7 + 2] = 'q';
+	QVERIFY(!frame_codec::decode_request(body, verb, fields));
+}
+
+void test_protocol::bench_dispatch_data()
+{
+	QTest::addColumn<QByteArray>("line");
+	QTest::addColumn<bool>("table");
+	for (int x = 0; x < num_verbs; ++x) {
+		QByteArray line = QByteArray(verbs[x]) + " some_user:::some_payload:::2017-04-01";
+		QTest::newRow((QByteArray(verbs[x]) + " (legacy)").constData()) << line << false;
+		QTest::newRow((QByteArray(verbs[x]) + " (table)").constData()) << line << true;
+	}
+}
+
+void test_protocol::bench_dispatch()
+{
+	QFETCH(QByteArray, line);
+	QFETCH(bool, table);
+	if (table) {
+		QBENCHMARK {
+			m_table.dispatch(line, NULL);
+		}
+	} else {
+		QBENCHMARK {
+			QString * p_payload = NULL;
+			legacy_dispatch(line, &p_payload);
+			delete p_payload;
+		}
+	}
+}
+
+QTEST_MAIN(test_protocol)
+#include "testprotocol.moc"
@@ -0,0 +1,467 @@
+// Copyright 2017 Hunter L. Allen
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <QtTest/QtTest>
+#include "../src/availability.hpp"
+#include "../src/slot_bitset.hpp"
+#include "../src/slot_counter.hpp"
+#include "../src/interval_timeline.hpp"
+#include "../src/event_struct.hpp"
+
+/* a made up month of everyone's events, the same on every run */
+struct member_events
+{
+	QList<calendar_event> events;
+};
+
+static QVector<member_events> make_group(const int & _members, const QDate & _first, const int & _days)
+{
+	QVector<member_events> group(_members);
+	quint32 seed = 12345;
+	for (int m = 0; m < _members; ++m) {
+		for (int d = 0; d < _days; ++d) {
+			/* three events a day, between 8:00 and 20:00 */
+			for (int e = 0; e < 3; ++e) {
+				seed = seed * 1103515245 + 12345;
+				calendar_event event = calendar_event::from(_first.addDays(d),
+					QTime(8, 0).addSecs(((seed >> 8) % (12 * 12)) * 5 * 60),
+					30 + (seed >> 20) % 4 * 15);
+				group[m].events.append(event);
+			}
+		}
+	}
+	return group;
+}
+
+/* what suggest_event_times used to place between two events of a list */
+static calendar_event list_schedule_between(
+	const QList<calendar_event> & _events,
+	const int & _first,
+	const int & _second,
+	const int & _duration,
+	bool * _ok)
+{
+	calendar_event e1 = _events[_first], e2 = _events[_second], c = {0, 0};
+	qint64 days_between = e1.date().daysTo(e2.date());
+	if (days_between > 1) {
+		*_ok = true;
+		return calendar_event::from(e1.date().addDays(days_between >> 1), QTime(16, 0), _duration);
+	}
+	QTime end1 = e1.time().addSecs(e1.duration * 60);
+	if (end1.secsTo(e2.time()) < _duration * 60) {*_ok = false; return c;}
+	QTime middle = end1.addSecs(end1.secsTo(e2.time()) >> 1);
+	c = calendar_event::from(e1.date(), middle.addSecs(_duration * (-30)), _duration);
+	/* and a scan of every event, per pair */
+	for (int x = 0; x < _events.size(); ++x) {
+		if (c == _events[x]) {*_ok = false; return c;}
+	}
+	*_ok = true;
+	return c;
+}
+
+class test_scheduling: public QObject
+{
+	Q_OBJECT
+public:
+	test_scheduling(QObject * _p_parent = NULL)
+		: QObject(_p_parent)
+		{ /* construct the test */ }
+private slots:
+	void test_event();
+	void test_bitset();
+	void test_counter();
+	void test_merge();
+	void test_window();
+	void test_hours();
+	void test_quorum();
+	void test_timeline();
+	void bench_group_availability_data();
+	void bench_group_availability();
+	void bench_quorum_data();
+	void bench_quorum();
+	void bench_user_suggestions_data();
+	void bench_user_suggestions();
+};
+
+void test_scheduling::test_event()
+{
+	/* the helpers work at compile time */
+	static_assert(calendar_event::minute(calendar_event::EPOCH_DAY + 1, 90) == 24 * 60 + 90, "minute");
+	static_assert(calendar_event{-1, 0}.minute_of_day() == 24 * 60 - 1, "before the epoch");
+	static_assert(calendar_event{0, 30}.overlaps(calendar_event{29, 10}), "overlap");
+	static_assert(!calendar_event{0, 30}.overlaps(calendar_event{30, 10}), "touching");
+
+	QDate day(2017, 4, 10);
+	calendar_event e = calendar_event::from(day, QTime(23, 35), 50);
+	QCOMPARE(e.date(), day);
+	QCOMPARE(e.time(), QTime(23, 35));
+	QCOMPARE((calendar_event{e.end(), 0}.date()), day.addDays(1));
+	QCOMPARE((calendar_event{e.end(), 0}.time()), QTime(0, 25));
+	QCOMPARE(calendar_event::from(QDate(1999, 12, 31), QTime(0, 5), 0).date(), QDate(1999, 12, 31));
+	QCOMPARE(availability::minute(day, QTime(23, 35)), qint64(e.start));
+
+	/* events that start together are equal, and hash alike */
+	calendar_event same = calendar_event::from(day, QTime(23, 35), 10);
+	QVERIFY(e == same);
+	QCOMPARE(qHash(e, 7), qHash(same, 7));
+	QSet<calendar_event> set;
+	set << e << same << calendar_event::from(day, QTime(9, 0), 10);
+	QCOMPARE(set.size(), 2);
+}
+
+void test_scheduling::test_bitset()
+{
+	slot_bitset a(200), b(200);
+	a.set_range(3, 70);
+	a.set_range(128, 129);
+	b.set_range(60, 140);
+	QVERIFY(!a.test(2) && a.test(3) && a.test(69) && !a.test(70));
+	QCOMPARE(a.next_set(0), 3);
+	QCOMPARE(a.next_clear(3), 70);
+	QCOMPARE(a.next_set(70), 128);
+	QCOMPARE(a.next_clear(128), 129);
+	QCOMPARE(a.next_set(129), 200);
+	slot_bitset both = a;
+	both.and_with(b);
+	QCOMPARE(both.next_set(0), 60);
+	QCOMPARE(both.next_clear(60), 70);
+	QCOMPARE(both.next_set(70), 128);
+	a.or_with(b);
+	QCOMPARE(a.next_clear(3), 140);
+	/* a full last word still ends at the size */
+	slot_bitset full(128);
+	full.set_range(-5, 500);
+	QCOMPARE(full.next_clear(0), 128);
+}
+
+void test_scheduling::test_counter()
+{
+	slot_bitset row(100);
+	row.set_range(10, 20);
+	row.spread(5);
+	QCOMPARE(row.next_set(0), 6);
+	QCOMPARE(row.next_clear(6), 20);
+	/* across a word */
+	slot_bitset wide(200);
+	wide.set_range(130, 132);
+	wide.spread(70);
+	QCOMPARE(wide.next_set(0), 61);
+	QCOMPARE(wide.next_clear(61), 132);
+
+	slot_bitset early(100), late(100);
+	early.set_range(0, 50);
+	late.set_range(25, 75);
+	slot_counter counter(100);
+	for (int x = 0; x < 3; ++x) {counter.add(early);}
+	for (int x = 0; x < 2; ++x) {counter.add(late);}
+	QCOMPARE(counter.rows(), 5);
+	QCOMPARE(counter.count(0), 3);
+	QCOMPARE(counter.count(30), 5);
+	QCOMPARE(counter.count(60), 2);
+	QCOMPARE(counter.count(80), 0);
+}
+
+void test_scheduling::test_merge()
+{
+	QDate day(2017, 4, 10);
+	qint64 nine = availability::minute(day, QTime(9, 0));
+	availability group(nine, nine + 8 * 60);
+	/* two members, overlapping, added out of order */
+	group.add_busy(0, nine + 120, nine + 180);
+	group.add_busy(1, nine + 30, nine + 90);
+	group.add_busy(0, nine + 60, nine + 150);
+	group.add_busy(1, nine + 200, nine + 215);
+	QCOMPARE(group.members(), 2);
+	QVector<availability::slot> slots = group.free(30);
+	QCOMPARE(slots.size(), 2);
+	QCOMPARE(slots[0].start, nine);
+	QCOMPARE(slots[0].end, nine + 30);
+	/* 180-200 is too short */
+	QCOMPARE(slots[1].start, nine + 215);
+	QCOMPARE(slots[1].end, nine + 8 * 60);
+	QCOMPARE(availability::date_of(slots[1].start), day);
+	QCOMPARE(availability::time_of(slots[1].start), QTime(12, 35));
+	/* a shorter event fits in more places */
+	QCOMPARE(group.free(20).size(), 3);
+	/* with everyone required, quorum finds the same times */
+	QVector<availability::choice> all = group.quorum(30, 2, 100);
+	QCOMPARE(all.size(), slots.size());
+	for (int x = 0; x < all.size(); ++x) {
+		QCOMPARE(all[x].start, slots[x].start);
+		QCOMPARE(all[x].end, slots[x].end);
+		QCOMPARE(all[x].attendance, 2);
+	}
+}
+
+void test_scheduling::test_window()
+{
+	QDate day(2017, 4, 10);
+	qint64 from = availability::minute(day, QTime(9, 0));
+	availability group(from, from + 60);
+	/* entirely before and after the window */
+	group.add_busy(from - 60, from);
+	group.add_busy(from + 60, from + 120);
+	QCOMPARE(group.busy_count(), 0);
+	/* overlapping its start */
+	group.add_busy(from - 30, from + 10);
+	QVector<availability::slot> slots = group.free(50);
+	QCOMPARE(slots.size(), 1);
+	QCOMPARE(slots[0].start, from + 10);
+	QVERIFY(group.free(51).isEmpty());
+}
+
+void test_scheduling::test_hours()
+{
+	QDate day(2017, 4, 10);
+	/* from Monday noon to Wednesday 10:00 */
+	availability group(availability::minute(day, QTime(12, 0)),
+		availability::minute(day.addDays(2), QTime(10, 0)));
+	group.set_hours(8 * 60, 22 * 60);
+	QVector<availability::slot> slots = group.free(60);
+	QCOMPARE(slots.size(), 3);
+	QCOMPARE(slots[0].end, availability::minute(day, QTime(22, 0)));
+	QCOMPARE(slots[1].start, availability::minute(day.addDays(1), QTime(8, 0)));
+	QCOMPARE(slots[1].end, availability::minute(day.addDays(1), QTime(22, 0)));
+	QCOMPARE(slots[2].start, availability::minute(day.addDays(2), QTime(8, 0)));
+	QCOMPARE(slots[2].end, availability::minute(day.addDays(2), QTime(10, 0)));
+}
+
+void test_scheduling::test_quorum()
+{
+	QDate day(2017, 4, 10);
+	qint64 nine = availability::minute(day, QTime(9, 0));
+	availability group(nine, nine + 3 * 60);
+	group.add_busy(0, nine, nine + 60);
+	group.add_busy(1, nine + 30, nine + 90);
+	group.add_busy(2, nine + 120, nine + 180);
+	/* nobody has the whole hour */
+	QVERIFY(group.free(60).isEmpty());
+	QVERIFY(group.quorum(60, 3, 10).isEmpty());
+
+	QVector<availability::choice> two = group.quorum(60, 2, 10);
+	QCOMPARE(two.size(), 2);
+	QCOMPARE(two[0].start, nine + 60);
+	QCOMPARE(two[0].end, nine + 120);
+	QCOMPARE(two[0].attendance, 2);
+	QCOMPARE(two[1].start, nine + 90);
+	QCOMPARE(two[1].end, nine + 180);
+
+	/* the better times still come first */
+	QVector<availability::choice> one = group.quorum(60, 1, 10);
+	QCOMPARE(one.size(), 4);
+	QCOMPARE(one[1].start, nine + 90);
+	QCOMPARE(one[2].start, nine);
+	QCOMPARE(one[2].end, nine + 115);
+	QCOMPARE(one[2].attendance, 1);
+	QCOMPARE(one[3].start, nine + 65);
+	QCOMPARE(group.quorum(60, 1, 3).size(), 3);
+
+	/* a member with nothing on can always come */
+	group.set_members(4);
+	QCOMPARE(group.quorum(60, 3, 10).size(), 2);
+	QCOMPARE(group.quorum(60, 3, 10)[0].attendance, 3);
+	QVERIFY(group.quorum(60, 5, 10).isEmpty());
+}
+
+void test_scheduling::test_timeline()
+{
+	interval_timeline busy;
+	busy.insert(100, 200);
+	busy.insert(300, 400);
+	/* out of order, and between the two */
+	busy.insert(220, 250);
+	busy.insert(10, 20);
+	QCOMPARE(busy.size(), 4);
+	QCOMPARE(busy.at(1).start, qint64(100));
+	QCOMPARE(busy.at(2).end, qint64(250));
+	/* touching spans merge */
+	busy.insert(200, 220);
+	QCOMPARE(busy.size(), 3);
+	QCOMPARE(busy.at(1).end, qint64(250));
+	/* one span swallowing several */
+	busy.insert(150, 350);
+	QCOMPARE(busy.size(), 2);
+	QCOMPARE(busy.at(1).start, qint64(100));
+	QCOMPARE(busy.at(1).end, qint64(400));
+	/* inside an existing span, and empty */
+	busy.insert(110, 120);
+	busy.insert(500, 500);
+	QCOMPARE(busy.size(), 2);
+
+	QVERIFY(busy.overlaps(0, 11));
+	QVERIFY(!busy.overlaps(0, 10));
+	QVERIFY(!busy.overlaps(20, 100));
+	QVERIFY(busy.overlaps(399, 450));
+	QVERIFY(!busy.overlaps(400, 450));
+	QVERIFY(busy.overlaps(50, 500));
+
+	QVector<interval_timeline::span> free = busy.gaps(0, 450);
+	QCOMPARE(free.size(), 3);
+	QCOMPARE(free[0].start, qint64(0));
+	QCOMPARE(free[0].end, qint64(10));
+	QCOMPARE(free[1].start, qint64(20));
+	QCOMPARE(free[1].end, qint64(100));
+	QCOMPARE(free[2].start, qint64(400));
+	QCOMPARE(free[2].end, qint64(450));
+	/* starting inside a span */
+	free = busy.gaps(150, 420);
+	QCOMPARE(free.size(), 1);
+	QCOMPARE(free[0].start, qint64(400));
+	QVERIFY(busy.gaps(120, 390).isEmpty());
+}
+
+void test_scheduling::bench_group_availability_data()
+{
+	QTest::addColumn<int>("members");
+	QTest::addColumn<bool>("bitset");
+	const int sizes[] = {2, 5, 20, 100, 500};
+	for (int size : sizes) {
+		QTest::newRow((QByteArray::number(size) + " members (pairwise)").constData()) << size << false;
+		QTest::newRow((QByteArray::number(size) + " members (bitset)").constData()) << size << true;
+	}
+}
+
+void test_scheduling::bench_group_availability()
+{
+	QFETCH(int, members);
+	QFETCH(bool, bitset);
+	QDate first(2017, 4, 10);
+	const int days = 14, duration = 60;
+	QVector<member_events> group = make_group(members, first, days);
+	qint64 from = availability::minute(first, QTime(8, 0));
+	qint64 until = availability::minute(first.addDays(days - 1), QTime(22, 0));
+
+	if (bitset) {
+		QBENCHMARK {
+			availability a(from, until);
+			a.set_hours(8 * 60, 22 * 60);
+			for (int m = 0; m < group.size(); ++m) {
+				for (const calendar_event & e : group[m].events) {
+					a.add_busy(m, e.start, e.end());
+				}
+			}
+			QVector<availability::slot> slots = a.free(duration);
+			Q_UNUSED(slots);
+		}
+	} else {
+		/* what suggest_group_events did in memory: test every candidate against every event */
+		QList<calendar_event> candidates;
+		for (int d = 0; d < days; ++d) {
+			for (int h = 8; h < 21; h += 4) {
+				candidates.append(calendar_event::from(first.addDays(d), QTime(h, 0), duration));
+			}
+		}
+		QBENCHMARK {
+			int valid = 0;
+			for (const calendar_event & c : candidates) {
+				bool ok = true;
+				for (int m = 0; m < group.size() && ok; ++m) {
+					for (const calendar_event & e : group[m].events) {
+						if (check_overlap(c, e)) {ok = false; break;}
+					}
+				}
+				valid += ok;
+			}
+			Q_UNUSED(valid);
+		}
+	}
+}
+
+void test_scheduling::bench_quorum_data()
+{
+	QTest::addColumn<int>("members");
+	const int sizes[] = {2, 5, 20, 100, 500};
+	for (int size : sizes) {
+		QTest::newRow((QByteArray::number(size) + " members").constData()) << size;
+	}
+}
+
+void test_scheduling::bench_quorum()
+{
+	QFETCH(int, members);
+	QDate first(2017, 4, 10);
+	const int days = 14, duration = 60;
+	QVector<member_events> group = make_group(members, first, days);
+	qint64 from = availability::minute(first, QTime(8, 0));
+	qint64 until = availability::minute(first.addDays(days - 1), QTime(22, 0));
+
+	QBENCHMARK {
+		availability a(from, until);
+		a.set_hours(8 * 60, 22 * 60);
+		for (int m = 0; m < group.size(); ++m) {
+			for (const calendar_event & e : group[m].events) {
+				a.add_busy(m, e.start, e.end());
+			}
+		}
+		/* half the group */
+		QVector<availability::choice> choices = a.quorum(duration, (members + 1) / 2, 10);
+		Q_UNUSED(choices);
+	}
+}
+
+void test_scheduling::bench_user_suggestions_data()
+{
+	QTest::addColumn<int>("days");
+	QTest::addColumn<bool>("timeline");
+	/* three events a day */
+	const int sizes[] = {30, 300, 3334};
+	for (int days : sizes) {
+		QByteArray events = QByteArray::number(days * 3) + " events";
+		QTest::newRow((events + " (QSet)").constData()) << days << false;
+		QTest::newRow((events + " (timeline)").constData()) << days << true;
+	}
+}
+
+void test_scheduling::bench_user_suggestions()
+{
+	QFETCH(int, days);
+	QFETCH(bool, timeline);
+	QDate first(2017, 4, 10);
+	const int duration = 60;
+	QList<calendar_event> events = make_group(1, first, days)[0].events;
+
+	if (timeline) {
+		QBENCHMARK {
+			interval_timeline busy;
+			busy.reserve(events.size());
+			for (const calendar_event & e : events) {
+				busy.insert(e.start, e.end());
+			}
+			int found = 0;
+			for (const interval_timeline::span & gap : busy.gaps(
+				availability::minute(first, QTime(0, 0)), availability::minute(first.addDays(days), QTime(0, 0))))
+			{
+				found += (gap.end - gap.start >= duration);
+			}
+			Q_UNUSED(found);
+		}
+	} else {
+		QBENCHMARK {
+			QSet<calendar_event> set;
+			for (const calendar_event & e : events) {set.insert(e);}
+			QList<calendar_event> list = set.toList();
+			int found = 0;
+			for (int x = 0; x + 1 < list.size(); ++x) {
+				bool ok;
+				list_schedule_between(list, x, x + 1, duration, &ok);
+				found += ok;
+			}
+			Q_UNUSED(found);
+		}
+	}
+}
+
+QTEST_MAIN(test_scheduling)
+#include "testscheduling.moc"
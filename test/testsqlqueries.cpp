@@ -83,6 +83,36 @@ void test_sql_queries::test_login()
 	QVERIFY(!m_p_worker->try_login("fake", "morefake"));
 	QVERIFY(!m_p_worker->try_login("billy", "morefake"));
 	QVERIFY(!m_p_worker->try_login("fake", "password123!"));
+	/* a session token stands in for the password, for its owner only */
+	QString token = m_p_worker->issue_token("billy");
+	QVERIFY(m_p_worker->try_login("billy", token));
+	QVERIFY(!m_p_worker->try_login("fake", token));
+	QVERIFY(!m_p_worker->try_login("billy", token + "0"));
+	QVERIFY(!m_p_worker->try_login("billy", "TOKEN:1.0"));
+	/* whatever case the name comes in */
+	QVERIFY(m_p_worker->try_login("Billy", token));
+	/* changing the password revokes it */
+	QVERIFY(m_p_worker->update_user("billy", "password123!", "hunter1",
+		"billy", "billy@domain.com", ""));
+	QVERIFY(!m_p_worker->try_login("billy", token));
+	QVERIFY(m_p_worker->try_login("billy", m_p_worker->issue_token("billy")));
+	/* an update needs the current password */
+	QVERIFY(!m_p_worker->update_user("billy", "password123!", "hunter2",
+		"billy", "billy@domain.com", ""));
+	QVERIFY(m_p_worker->update_user("billy", "hunter1", "password123!",
+		"billy", "billy@domain.com", ""));
+	/* a remembered login is forgotten when the password changes */
+	QVERIFY(m_p_worker->try_login("billy", "password123!"));
+	QVERIFY(m_p_worker->update_user("billy", "password123!", "hunter2",
+		"billy", "billy@domain.com", ""));
+	QVERIFY(!m_p_worker->try_login("billy", "password123!"));
+	QVERIFY(m_p_worker->try_login("billy", "hunter2"));
+	/* the database ignores case in user names, and so must the cache */
+	QVERIFY(m_p_worker->try_login("Billy", "hunter2"));
+	QVERIFY(m_p_worker->update_user("billy", "hunter2", "hunter3",
+		"billy", "billy@domain.com", ""));
+	QVERIFY(!m_p_worker->try_login("Billy", "hunter2"));
+	QVERIFY(m_p_worker->try_login("Billy", "hunter3"));
    
 	/* remove user from database */
 	QVERIFY(m_p_worker->cleanup_db_insert());
@@ -124,8 +154,13 @@ void test_sql_queries::test_join_group()
 	QVERIFY(!m_p_worker->join_group("not billy", "billy group"));
 	/* verify a user can't join a non-existing group */
 	QVERIFY(!m_p_worker->join_group("billy", "not billy's group"));
+	/* membership is loaded once, then answered from the cache */
+	QVERIFY(m_p_worker->user_in_group("billy", "billy group"));
+	QVERIFY(m_p_worker->user_in_group("Billy", "billy group"));
+	QVERIFY(!m_p_worker->user_in_group("not billy", "billy group"));
 	/* remove the test group */
 	QVERIFY(m_p_worker->cleanup_user_group_insert());
+	QVERIFY(!m_p_worker->user_in_group("billy", "billy group"));
 }
 QTEST_MAIN(test_sql_queries)
 #include "testsqlqueries.moc"